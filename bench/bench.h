@@ -0,0 +1,139 @@
+#pragma once
+#include "core/common.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+
+namespace infini::bench {
+
+/**
+ * @brief Command line options shared by the benchmarks:
+ * `--min-time <seconds>` per case, `--filter <substring>` of case names and
+ * `--json <path>` to write the results for regression tracking.
+ */
+struct Options {
+    double minTime = 0.2;
+    string filter;
+    string json;
+
+    static Options parse(int argc, char **argv) {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            string arg = argv[i];
+            IT_ASSERT(i + 1 < argc, "Missing value of " + arg);
+            if (arg == "--min-time")
+                options.minTime = std::stod(argv[++i]);
+            else if (arg == "--filter")
+                options.filter = argv[++i];
+            else if (arg == "--json")
+                options.json = argv[++i];
+            else
+                IT_ASSERT(false, "Unknown option " + arg);
+        }
+        return options;
+    }
+
+    bool selected(const string &name) const {
+        return name.find(filter) != string::npos;
+    }
+};
+
+using Clock = std::chrono::steady_clock;
+
+inline double elapsed(Clock::time_point begin) {
+    return std::chrono::duration<double>(Clock::now() - begin).count();
+}
+
+/**
+ * @brief Median time of a call of `fn` in seconds, after a warm-up call.
+ * Calls are repeated until `minTime` seconds have passed, at least 3 times.
+ */
+inline double measure(const std::function<void()> &fn, double minTime) {
+    fn();
+    vector<double> times;
+    auto start = Clock::now();
+    while (times.size() < 3 || elapsed(start) < minTime) {
+        auto begin = Clock::now();
+        fn();
+        times.emplace_back(elapsed(begin));
+    }
+    std::nth_element(times.begin(), times.begin() + times.size() / 2,
+                     times.end());
+    return times[times.size() / 2];
+}
+
+/**
+ * @brief Measured memory bandwidth of `memcpy` in GB/s, counting the bytes
+ * read and written, on buffers larger than the last level caches.
+ */
+inline double memcpyBandwidth(double minTime, size_t bytes = 256 << 20) {
+    vector<char> src(bytes, 1), dst(bytes, 0);
+    auto t = measure([&] { std::memcpy(dst.data(), src.data(), bytes); },
+                     minTime);
+    return 2.0 * bytes / t / 1e9;
+}
+
+/**
+ * @brief Results of the cases of a benchmark, printed as a table and
+ * optionally written as JSON.
+ */
+class Report {
+  public:
+    struct Row {
+        string name;
+        // e.g. the kernel, dtype and shapes of the case
+        std::map<string, string> labels;
+        std::map<string, double> metrics;
+    };
+
+  private:
+    string benchmark;
+    vector<Row> rows;
+    std::map<string, double> globals;
+
+  public:
+    explicit Report(string benchmark) : benchmark(std::move(benchmark)) {}
+
+    void set(const string &key, double value) { globals[key] = value; }
+    void add(Row row) {
+        print(row);
+        rows.emplace_back(std::move(row));
+    }
+
+    static void print(const Row &row) {
+        std::cout << std::left << std::setw(48) << row.name << std::right
+                  << std::fixed << std::setprecision(3);
+        for (const auto &[key, value] : row.metrics)
+            std::cout << "  " << key << "=" << value;
+        std::cout << std::endl;
+    }
+
+    void write(const string &path) const {
+        if (path.empty())
+            return;
+        std::ofstream out(path);
+        IT_ASSERT(out.good(), "Cannot write " + path);
+        out << std::setprecision(9) << "{\"benchmark\":\"" << benchmark
+            << "\"";
+        for (const auto &[key, value] : globals)
+            out << ",\"" << key << "\":" << value;
+        out << ",\"results\":[";
+        for (size_t i = 0; i < rows.size(); ++i) {
+            out << (i ? ",\n" : "\n") << "{\"name\":\"" << rows[i].name
+                << "\"";
+            for (const auto &[key, value] : rows[i].labels)
+                out << ",\"" << key << "\":\"" << value << "\"";
+            for (const auto &[key, value] : rows[i].metrics)
+                out << ",\"" << key << "\":" << value;
+            out << "}";
+        }
+        out << "\n]}\n";
+    }
+};
+
+} // namespace infini::bench
@@ -0,0 +1,143 @@
+#include "bench.h"
+#include "core/graph.h"
+#include "core/kernel.h"
+#include "core/plan.h"
+#include "core/profiler.h"
+#include "core/runtime.h"
+#include "operators/concat.h"
+#include "operators/element_wise.h"
+#include "operators/matmul.h"
+#include "operators/transpose.h"
+#include "operators/unary.h"
+#include "utils/data_generator.h"
+
+using namespace infini;
+using namespace infini::bench;
+
+namespace {
+
+// builds a graph of a single op on new input tensors
+using Builder = std::function<void(GraphObj &, const TensorVec &)>;
+
+struct Case {
+    string kernel, attrs;
+    vector<Shape> inputs;
+    Builder build;
+};
+
+vector<Case> cases() {
+    vector<Case> ret;
+    const auto add = [&](string kernel, string attrs, vector<Shape> inputs,
+                         Builder build) {
+        ret.push_back({kernel, attrs, inputs, build});
+    };
+    const vector<Shape> sizes = {{64, 64}, {8, 64, 32, 32}, {32, 64, 56, 56}};
+    for (const auto &shape : sizes) {
+        auto rank = (int)shape.size();
+        Shape perm(rank);
+        for (int i = 0; i < rank; ++i)
+            perm[i] = (i + 1) % rank;
+        Shape channel = {shape.back()};
+
+        for (int axis : {0, rank - 1})
+            add("Concat", "axis=" + std::to_string(axis), {shape, shape},
+                [=](GraphObj &g, const TensorVec &t) {
+                    g.addOp<ConcatObj>(t, nullptr, axis);
+                });
+        add("Transpose", "perm=" + vecToString(perm), {shape},
+            [=](GraphObj &g, const TensorVec &t) {
+                g.addOp<TransposeObj>(t[0], nullptr, perm);
+            });
+        add("Add", "", {shape, shape}, [](GraphObj &g, const TensorVec &t) {
+            g.addOp<AddObj>(t[0], t[1], nullptr);
+        });
+        add("Add", "broadcast", {shape, channel},
+            [](GraphObj &g, const TensorVec &t) {
+                g.addOp<AddObj>(t[0], t[1], nullptr);
+            });
+        add("Sub", "", {shape, shape}, [](GraphObj &g, const TensorVec &t) {
+            g.addOp<SubObj>(t[0], t[1], nullptr);
+        });
+        add("Mul", "", {shape, shape}, [](GraphObj &g, const TensorVec &t) {
+            g.addOp<MulObj>(t[0], t[1], nullptr);
+        });
+        add("Div", "", {shape, shape}, [](GraphObj &g, const TensorVec &t) {
+            g.addOp<DivObj>(t[0], t[1], nullptr);
+        });
+        add("Relu", "", {shape}, [](GraphObj &g, const TensorVec &t) {
+            g.addOp<ReluObj>(t[0], nullptr);
+        });
+        add("Clip", "min=1,max=100", {shape},
+            [](GraphObj &g, const TensorVec &t) {
+                g.addOp<ClipObj>(t[0], nullptr, 1.f, 100.f);
+            });
+    }
+    for (int size : {64, 256, 512}) {
+        Shape a = {1, size, size}, b = {1, size, size};
+        for (bool transB : {false, true})
+            add("Matmul", transB ? "transB" : "", {a, b},
+                [=](GraphObj &g, const TensorVec &t) {
+                    g.addOp<MatmulObj>(t[0], t[1], nullptr, false, transB);
+                });
+    }
+    return ret;
+}
+
+string shapesToString(const vector<Shape> &shapes) {
+    string ret;
+    for (const auto &shape : shapes)
+        ret += (ret.empty() ? "" : "x") + vecToString(shape);
+    return ret;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    auto options = Options::parse(argc, argv);
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Report report("kernels");
+
+    auto memcpyGBps = memcpyBandwidth(options.minTime);
+    report.set("memcpy_gbps", memcpyGBps);
+    report.set("threads", runtime->getThreadPool().getThreads());
+    std::cout << "memcpy: " << memcpyGBps << " GB/s" << std::endl;
+
+    for (const auto &c : cases()) {
+        for (auto dtype : {DataType::Float32, DataType::UInt32}) {
+            auto name = c.kernel;
+            if (!c.attrs.empty())
+                name += "(" + c.attrs + ")";
+            name += "/" + dtype.toString() + "/" + shapesToString(c.inputs);
+            if (!options.selected(name))
+                continue;
+            Graph g = make_ref<GraphObj>(runtime);
+            TensorVec inputs;
+            for (const auto &shape : c.inputs)
+                inputs.emplace_back(g->addTensor(shape, dtype));
+            c.build(*g, inputs);
+            g->dataMalloc();
+            // no zero divisors
+            for (const auto &t : inputs)
+                t->setData(ValGenerator<3>());
+
+            auto plan = runtime->compile(g);
+            auto seconds =
+                measure([&] { runtime->run(plan); }, options.minTime);
+            const auto &op = g->getOperators()[0];
+            auto bytes = Profiler::estimateBytes(op);
+            auto flops = Profiler::estimateFlops(op);
+            auto gbps = bytes / seconds / 1e9;
+            report.add({name,
+                        {{"kernel", c.kernel},
+                         {"attrs", c.attrs},
+                         {"dtype", dtype.toString()},
+                         {"shapes", shapesToString(c.inputs)}},
+                        {{"us", seconds * 1e6},
+                         {"gbps", gbps},
+                         {"gflops", flops / seconds / 1e9},
+                         {"roofline_pct", 100 * gbps / memcpyGBps}}});
+        }
+    }
+    report.write(options.json);
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include "bench.h"
+#include "core/plan.h"
+#include "core/runtime.h"
+#include "models.h"
+
+using namespace infini;
+using namespace infini::bench;
+
+namespace {
+
+// small values keeping the activations finite through deep graphs
+void fill(void *ptr, size_t size, DataType dtype) {
+    IT_ASSERT(dtype == DataType::Float32);
+    auto data = static_cast<float *>(ptr);
+    for (size_t i = 0; i < size; ++i)
+        data[i] = float(int(i % 13) - 6) / 64;
+}
+
+double percentile(vector<double> v, double p) {
+    auto i = std::min(v.size() - 1, size_t(p / 100 * v.size()));
+    std::nth_element(v.begin(), v.begin() + i, v.end());
+    return v[i];
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    auto options = Options::parse(argc, argv);
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Report report("models");
+    report.set("threads", runtime->getThreadPool().getThreads());
+
+    const vector<Model> models = {
+        mlp(1, 512, 8),
+        mlp(32, 1024, 4),
+        transformer(1, 64, 256, 4, 2),
+        transformer(4, 128, 256, 8, 2),
+        fanOut(16, 8, {1024}),
+        fanOut(1000, 100, {16}),
+    };
+    for (const auto &model : models) {
+        if (!options.selected(model.name))
+            continue;
+        std::map<string, double> metrics;
+        auto begin = Clock::now();
+        const auto phase = [&](const string &name) {
+            metrics[name + "_ms"] = elapsed(begin) * 1e3;
+            begin = Clock::now();
+        };
+
+        Graph g = model.build(runtime);
+        phase("build");
+        g->optimize();
+        phase("optimize");
+        g->dataMalloc();
+        phase("malloc");
+        auto plan = runtime->compile(g);
+        phase("compile");
+        for (const auto &t : g->getInputs())
+            t->setData(fill);
+
+        // latency of every request, at least 10 of them
+        vector<double> latencies;
+        auto start = Clock::now();
+        while (latencies.size() < 10 || elapsed(start) < options.minTime) {
+            auto t = Clock::now();
+            runtime->run(plan);
+            latencies.emplace_back(elapsed(t) * 1e6);
+        }
+        metrics["ops"] = g->getOperators().size();
+        metrics["arena_bytes"] = g->getArenaSize();
+        metrics["weight_bytes"] = g->getWeightsSize();
+        metrics["requests"] = latencies.size();
+        metrics["p50_us"] = percentile(latencies, 50);
+        metrics["p90_us"] = percentile(latencies, 90);
+        metrics["p99_us"] = percentile(latencies, 99);
+        report.add({model.name, {}, metrics});
+    }
+    report.write(options.json);
+    return 0;
+}
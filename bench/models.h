@@ -0,0 +1,133 @@
+#pragma once
+#include "core/graph.h"
+#include "operators/concat.h"
+#include "operators/element_wise.h"
+#include "operators/matmul.h"
+#include "operators/transpose.h"
+#include "operators/unary.h"
+
+namespace infini::bench {
+
+/**
+ * @brief Parametric graphs for the end-to-end benchmarks. Weights are graph
+ * inputs marked with `TensorObj::setWeight`; the other inputs are the
+ * request inputs.
+ */
+struct Model {
+    string name;
+    std::function<Graph(Runtime)> build;
+};
+
+inline Tensor addWeight(GraphObj &g, Shape shape) {
+    auto w = g.addTensor(std::move(shape));
+    w->setWeight();
+    return w;
+}
+
+/**
+ * @brief `layers` of relu(x W + b) on a (batch, width) input.
+ */
+inline Model mlp(int batch, int width, int layers) {
+    return {"mlp/b" + std::to_string(batch) + "/w" + std::to_string(width) +
+                "/l" + std::to_string(layers),
+            [=](Runtime runtime) {
+                Graph g = make_ref<GraphObj>(runtime);
+                auto x = g->addTensor({batch, width});
+                for (int i = 0; i < layers; ++i) {
+                    auto w = addWeight(*g, {width, width});
+                    auto b = addWeight(*g, {width});
+                    x = g->addOp<MatmulObj>(x, w, nullptr)->getOutput();
+                    x = g->addOp<AddObj>(x, b, nullptr)->getOutput();
+                    x = g->addOp<ReluObj>(x, nullptr)->getOutput();
+                }
+                return g;
+            }};
+}
+
+/**
+ * @brief `layers` blocks shaped like a transformer encoder on a
+ * (batch, seq, hidden) input: per-head attention products whose heads are
+ * concatenated, an output projection, a two-layer feed-forward network and
+ * residual additions. Keys are transposed explicitly so that `optimize` can
+ * fold the transposes into the matmuls.
+ */
+inline Model transformer(int batch, int seq, int hidden, int heads,
+                         int layers) {
+    return {"transformer/b" + std::to_string(batch) + "/s" +
+                std::to_string(seq) + "/h" + std::to_string(hidden) + "/n" +
+                std::to_string(heads) + "/l" + std::to_string(layers),
+            [=](Runtime runtime) {
+                IT_ASSERT(hidden % heads == 0);
+                const int head = hidden / heads;
+                Graph g = make_ref<GraphObj>(runtime);
+                auto x = g->addTensor({batch, seq, hidden});
+                auto matmul = [&](Tensor a, Tensor b, bool transB = false) {
+                    return g->addOp<MatmulObj>(a, b, nullptr, false, transB)
+                        ->getOutput();
+                };
+                for (int l = 0; l < layers; ++l) {
+                    TensorVec outputs;
+                    for (int h = 0; h < heads; ++h) {
+                        auto q = matmul(x, addWeight(*g, {1, hidden, head}));
+                        auto k = matmul(x, addWeight(*g, {1, hidden, head}));
+                        auto v = matmul(x, addWeight(*g, {1, hidden, head}));
+                        auto kt = g->addOp<TransposeObj>(k, nullptr,
+                                                         Shape{0, 2, 1})
+                                      ->getOutput();
+                        auto s = matmul(q, kt);
+                        outputs.emplace_back(matmul(s, v));
+                    }
+                    auto a = heads == 1 ? outputs[0]
+                                        : g->addOp<ConcatObj>(outputs,
+                                                              nullptr, 2)
+                                              ->getOutput();
+                    a = matmul(a, addWeight(*g, {1, hidden, hidden}));
+                    x = g->addOp<AddObj>(x, a, nullptr)->getOutput();
+                    auto f = matmul(x, addWeight(*g, {1, hidden, 4 * hidden}));
+                    f = g->addOp<ReluObj>(f, nullptr)->getOutput();
+                    f = matmul(f, addWeight(*g, {1, 4 * hidden, hidden}));
+                    x = g->addOp<AddObj>(x, f, nullptr)->getOutput();
+                }
+                return g;
+            }};
+}
+
+/**
+ * @brief `branches` independent chains of `depth` element-wise ops on one
+ * input, reduced by a tree of additions: branches * depth + branches - 1
+ * ops in total.
+ */
+inline Model fanOut(int branches, int depth, Shape shape) {
+    return {"fanout/b" + std::to_string(branches) + "/d" +
+                std::to_string(depth) + "/" + vecToString(shape),
+            [=](Runtime runtime) {
+                Graph g = make_ref<GraphObj>(runtime);
+                auto x = g->addTensor(shape);
+                auto bias = addWeight(*g, shape);
+                TensorVec ends;
+                for (int b = 0; b < branches; ++b) {
+                    auto t = x;
+                    for (int d = 0; d < depth; ++d) {
+                        if (d % 2 == 0)
+                            t = g->addOp<AddObj>(t, bias, nullptr)
+                                    ->getOutput();
+                        else
+                            t = g->addOp<ReluObj>(t, nullptr)->getOutput();
+                    }
+                    ends.emplace_back(t);
+                }
+                while (ends.size() > 1) {
+                    TensorVec next;
+                    for (size_t i = 0; i + 1 < ends.size(); i += 2)
+                        next.emplace_back(
+                            g->addOp<AddObj>(ends[i], ends[i + 1], nullptr)
+                                ->getOutput());
+                    if (ends.size() % 2)
+                        next.emplace_back(ends.back());
+                    ends = std::move(next);
+                }
+                return g;
+            }};
+}
+
+} // namespace infini::bench
@@ -24,16 +24,29 @@ class Allocator {
     // pointer to the memory actually allocated
     void *ptr;
 
+    // size of the memory actually allocated
+    size_t capacity;
+
+    // whether getPtr() has been called since the last reset()
+    bool materialized;
+
+    // whether the memory is allocated in whole pages, see
+    // RuntimeObj::allocPages
+    bool pages;
+
     struct Block {
         size_t begin, size;
         inline bool operator<(const Block &rhs) const {
             return size != rhs.size ? size < rhs.size : begin < rhs.begin;
         }
     };
-    std::set<Block> frees;
+    // free blocks indexed by size for best-fit allocation, and by address
+    // (begin -> size) for coalescing neighbors; always the same blocks
+    std::set<Block> freesBySize;
+    std::map<size_t, size_t> freesByAddr;
 
   public:
-    Allocator(Runtime runtime);
+    Allocator(Runtime runtime, bool pages = false);
 
     virtual ~Allocator();
 
@@ -49,13 +62,34 @@ class Allocator {
     //     size: size of memory block to be freed
     void free(size_t addr, size_t size);
 
-    // function: perform actual memory allocation
+    // function: perform actual memory allocation, growing the memory
+    //           allocated before if it is smaller than the peak
     // return: pointer to the head address of the allocated memory
     void *getPtr();
 
+    // function: start a new simulation, keeping the memory allocated so that
+    //           it can be reused by the next getPtr()
+    void reset();
+
+    // function: make the peak at least size, so that a memory layout planned
+    //           before can be materialized without simulating it again
+    void reserve(size_t size);
+
+    size_t getPeak() const { return peak; }
+
     void info();
 
+    size_t getUsed() const { return used; }
+
+    size_t getAlignment() const { return alignment; }
+
+    // function: number of free blocks, after coalescing
+    size_t getFreeBlocks() const { return freesBySize.size(); }
+
   private:
+    void insertFree(const Block &blk);
+    void eraseFree(const Block &blk);
+
     // function: memory alignment, rouned up
     // return: size of the aligned memory block
     size_t getAlignedSize(size_t size);
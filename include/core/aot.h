@@ -0,0 +1,24 @@
+#pragma once
+#include "core/graph.h"
+
+namespace infini {
+
+/**
+ * @brief Compile a graph ahead of time into a standalone C++ translation
+ * unit, for fixed shapes. The graph must have been optimized and allocated
+ * with `GraphObj::dataMalloc`, with its weights filled. The unit defines
+ *
+ *     extern "C" void <name>(const void *const *inputs,
+ *                            void *const *outputs);
+ *
+ * which runs the graph on the non-weight tensors of `getInputs` and the
+ * tensors of `getOutputs`, in that order; inputs and outputs must not
+ * overlap. Every op is a call to a function with its shapes and strides
+ * folded to constants, the activations and workspaces live at their
+ * planned offsets in a static arena and the weights are embedded, so the
+ * unit only needs the standard library. The arena is shared by all the
+ * calls, which must not run concurrently.
+ */
+string emitCpp(const Graph &graph, const string &name = "infini_run");
+
+} // namespace infini
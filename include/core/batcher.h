@@ -0,0 +1,91 @@
+#pragma once
+#include "core/graph.h"
+#include "core/runtime.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <thread>
+
+namespace infini {
+
+struct BatcherConfig {
+    // largest number of requests run together
+    size_t maxBatch = 8;
+    // longest time the first request of a batch waits for others
+    std::chrono::microseconds maxDelay{1000};
+};
+
+/**
+ * @brief A graph built for a given batch size. `inputs` and `outputs` are the
+ * per-request tensors, batched along their first axis; other graph inputs
+ * (e.g. weights) are shared by all requests.
+ */
+struct BatchedGraph {
+    Graph graph;
+    TensorVec inputs, outputs;
+};
+
+/**
+ * @brief Coalesces concurrent single-sample requests into one run of a graph
+ * shaped for the batch. Requests are submitted through a lock-free queue;
+ * a batching thread concatenates their inputs, runs the batched graph and
+ * scatters the outputs back to the callers.
+ */
+class Batcher {
+  public:
+    using Buffers = vector<vector<uint8_t>>;
+    /**
+     * @brief Builds the graph for a batch size, with its memory allocated and
+     * its weights filled. Graphs are built lazily and cached.
+     */
+    using Builder = std::function<BatchedGraph(size_t batch)>;
+
+  private:
+    struct Request {
+        Buffers inputs;
+        std::promise<Buffers> promise;
+        Request *next;
+    };
+    struct Entry {
+        BatchedGraph batched;
+        Plan plan;
+    };
+
+    Runtime runtime;
+    Builder builder;
+    BatcherConfig config;
+    std::map<size_t, Entry> entries;
+
+    // lock-free LIFO of submitted requests, reversed by the batching thread
+    std::atomic<Request *> head{nullptr};
+    std::atomic<bool> sleeping{false}, stop{false};
+    std::mutex lock;
+    std::condition_variable wake;
+    std::atomic<size_t> nRequests{0}, nBatches{0};
+    std::thread thread;
+
+  public:
+    Batcher(Runtime runtime, Builder builder, BatcherConfig config = {});
+    ~Batcher();
+    Batcher(const Batcher &) = delete;
+    Batcher &operator=(const Batcher &) = delete;
+
+    /**
+     * @brief Submits one request: a buffer per batched input, holding one
+     * sample. The future is set to a buffer per batched output.
+     */
+    std::future<Buffers> submit(Buffers inputs);
+
+    size_t getRequests() const { return nRequests; }
+    size_t getBatches() const { return nBatches; }
+
+  private:
+    void loop();
+    // moves the submitted requests to `pending` in submission order
+    void drain(std::deque<Request *> &pending);
+    void runBatch(vector<Request *> &batch);
+    Entry &getEntry(size_t batch);
+};
+
+} // namespace infini
@@ -10,14 +10,23 @@ using Runtime = Ref<RuntimeObj>;
 class BlobObj {
     Runtime runtime;
     void *ptr;
+    // keeps alive the memory of blobs pointing outside of the pools of the
+    // graph, e.g. into a mapped model file
+    Ref<void> owner;
 
   public:
-    BlobObj(Runtime runtime, void *ptr) : runtime(runtime), ptr(ptr) {}
+    BlobObj(Runtime runtime, void *ptr, Ref<void> owner = nullptr)
+        : runtime(runtime), ptr(ptr), owner(std::move(owner)) {}
     BlobObj(BlobObj &other) = delete;
     BlobObj &operator=(BlobObj const &) = delete;
     ~BlobObj() {};
 
     template <typename T> T getPtr() const { return reinterpret_cast<T>(ptr); }
+    /**
+     * @brief Whether the memory is owned by something else than the graph,
+     * in which case `GraphObj::dataMalloc` keeps it.
+     */
+    bool isExternal() const { return owner != nullptr; }
 };
 
 } // namespace infini
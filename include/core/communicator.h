@@ -0,0 +1,88 @@
+#pragma once
+#include "core/data_type.h"
+#include "core/object.h"
+
+namespace infini {
+
+/**
+ * @brief Collectives between the processes of one machine, through a POSIX
+ * shared memory segment. Every process attaches to the segment with its
+ * rank; a collective must be called by all the ranks, in the same order.
+ *
+ * The segment holds one slot of `capacity` bytes per rank and a result slot
+ * of the same size. Larger collectives are run in chunks. Ranks wait for
+ * each other in a barrier spinning on atomics in the segment, which fails
+ * once the segment is marked aborted, e.g. by `launchWorkers` when a worker
+ * dies, instead of hanging.
+ */
+class CommunicatorObj : public Object {
+    int worldSize, rank;
+    size_t capacity;
+    string name;
+    void *segment;
+    size_t segmentSize;
+
+  public:
+    static constexpr size_t defaultCapacity = 4 << 20;
+
+    /**
+     * @brief Attach to the segment `name`, creating it if needed. The
+     * segment must be fresh, i.e. not used by an earlier group, and all the
+     * ranks must agree on `capacity`.
+     */
+    CommunicatorObj(const string &name, int worldSize, int rank,
+                    size_t capacity = defaultCapacity);
+    ~CommunicatorObj();
+    CommunicatorObj(const CommunicatorObj &) = delete;
+    CommunicatorObj &operator=(const CommunicatorObj &) = delete;
+
+    /**
+     * @brief The communicator of a process started by `launchWorkers`, from
+     * the INFINI_SHM, INFINI_SHM_CAPACITY, INFINI_WORLD_SIZE and
+     * INFINI_RANK environment variables; null if they are not set.
+     */
+    static Ref<CommunicatorObj> fromEnvironment();
+
+    /**
+     * @brief The bytes of the segment of a group.
+     */
+    static size_t getSegmentSize(int worldSize, size_t capacity);
+
+    int getWorldSize() const { return worldSize; }
+    int getRank() const { return rank; }
+
+    void barrier();
+    /**
+     * @brief Replace `data`, `n` elements of `dtype`, by their sum over all
+     * the ranks. The sum is taken in rank order, so that all the ranks get
+     * the same bits.
+     */
+    void allReduceSum(void *data, size_t n, DataType dtype);
+    /**
+     * @brief Gather the `bytes` of `input` of every rank into `output`, in
+     * rank order.
+     */
+    void allGather(const void *input, void *output, size_t bytes);
+
+    string toString() const override;
+
+  private:
+    char *getSlot(int i) const;
+    char *getResult() const;
+};
+using Communicator = Ref<CommunicatorObj>;
+
+/**
+ * @brief Run `argv` as `worldSize` processes of one group, with the
+ * environment `CommunicatorObj::fromEnvironment` reads, and wait for them.
+ * The segment is created before and removed after the workers, and marked
+ * aborted as soon as one of them fails. With `bindNuma`, worker `i` is
+ * pinned to the CPUs of NUMA node `i` modulo the number of nodes, so that
+ * the memory it touches first, e.g. its shard of the weights, is local.
+ * Returns whether all the workers exited with 0.
+ */
+bool launchWorkers(int worldSize, const vector<string> &argv,
+                   bool bindNuma = true,
+                   size_t capacity = CommunicatorObj::defaultCapacity);
+
+} // namespace infini
@@ -0,0 +1,94 @@
+#pragma once
+#include "core/plan.h"
+#include "core/tensor.h"
+#include <future>
+
+namespace infini {
+
+/**
+ * @brief The state of one request running a compiled plan: a private copy of
+ * the activation arena of the graph and the data table pointing into it.
+ * Weights are read in place from the weight pool of the graph, which is
+ * shared by all the contexts. Several contexts of the same plan can be in
+ * flight at the same time.
+ */
+class ContextObj : public Object {
+    Plan plan;
+    Runtime runtime;
+    void *arena;
+    vector<void *> data;
+
+  public:
+    /**
+     * @brief Creates a context whose arena starts as a copy of the activation
+     * arena of the graph, so inputs filled in the graph are visible.
+     */
+    explicit ContextObj(const Plan &plan);
+    ~ContextObj();
+    ContextObj(const ContextObj &) = delete;
+    ContextObj &operator=(const ContextObj &) = delete;
+    string toString() const override;
+
+    Plan getPlan() const { return plan; }
+    const vector<void *> &getData() const { return data; }
+
+    /**
+     * @brief The raw data pointer of a tensor of the graph in this context.
+     */
+    template <typename T> T getRawDataPtr(const Tensor &tensor) const {
+        static_assert(std::is_pointer_v<T>,
+                      "Raw data pointer has a type of pointer");
+        if (tensor->isBound())
+            return reinterpret_cast<T>(data[plan->getSlots(tensor).front()]);
+        return reinterpret_cast<T>(relocate(tensor->getRawDataPtr<void *>()));
+    }
+
+    /**
+     * @brief Point a bound tensor, see `GraphObj::setBound`, to memory of the
+     * caller for the next runs of this context: an input is read in place
+     * and an output written in place. `ptr` must hold the bytes of the
+     * tensor, be aligned to `RuntimeObj::alignment` and stay valid while
+     * the context runs.
+     */
+    void bind(const Tensor &tensor, void *ptr);
+
+    void setData(const Tensor &tensor,
+                 std::function<void(void *, size_t, DataType)> const
+                     &generator) const;
+
+  private:
+    void *relocate(void *ptr) const;
+};
+
+/**
+ * @brief Keeps up to `depth` requests of a plan in flight, each in its own
+ * context: the inputs of a request are prepared on the calling thread while
+ * the previous requests are computed by the runtime.
+ */
+class Pipeline {
+    using Stage = std::function<void(ContextObj &)>;
+
+    Runtime runtime;
+    vector<Context> contexts;
+    std::mutex lock;
+    std::condition_variable freed;
+    vector<Context> idle;
+
+  public:
+    Pipeline(const Plan &plan, size_t depth);
+    ~Pipeline();
+
+    /**
+     * @brief Waits for an idle context, fills it with `prepare` on the calling
+     * thread and runs it asynchronously. `finish` is called on the runtime
+     * thread once the outputs are ready, before the context is reused.
+     */
+    std::future<void> submit(const Stage &prepare, Stage finish = nullptr);
+
+    /**
+     * @brief Waits until no request is in flight.
+     */
+    void wait();
+};
+
+} // namespace infini
@@ -0,0 +1,39 @@
+#pragma once
+#include "core/common.h"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace infini {
+
+/**
+ * @brief A thread running submitted tasks one after another, in submission
+ * order. Pending tasks are finished before the executor is destroyed.
+ */
+class Executor {
+    // shared with the thread, as a task may release the last reference to
+    // the owner of the executor and destroy it from the thread itself
+    struct State {
+        std::mutex lock;
+        std::condition_variable wake;
+        std::deque<std::function<void()>> tasks;
+        bool stop = false;
+    };
+    std::shared_ptr<State> state;
+    std::thread thread;
+
+  public:
+    Executor();
+    ~Executor();
+    Executor(const Executor &) = delete;
+    Executor &operator=(const Executor &) = delete;
+
+    void submit(std::function<void()> task);
+
+  private:
+    static void loop(std::shared_ptr<State> state);
+};
+
+} // namespace infini
@@ -1,9 +1,11 @@
 #pragma once
 #include "core/allocator.h"
+#include "core/memory_planner.h"
 #include "core/operator.h"
 #include "core/tensor.h"
 #include <algorithm>
 #include <cstdint>
+#include <map>
 
 namespace infini {
 
@@ -13,10 +15,12 @@ class GraphObj : public Object {
     TensorVec tensors;
     OpVec ops;
     Allocator allocator;
+    Allocator weightAllocator;
 
   public:
     explicit GraphObj(Runtime runtime)
-        : runtime(runtime), allocator(runtime), sorted(false) {};
+        : runtime(runtime), allocator(runtime), weightAllocator(runtime, true),
+          sorted(false) {};
     string toString() const override;
     Runtime getRuntime() const { return runtime; }
 
@@ -65,6 +69,10 @@ class GraphObj : public Object {
      * It returns true if the sorting is successful.
      * Otherwise false is returned, means that there are rings in the
      * graph, so the topological sorting fails.
+     *
+     * Once sorted, the order is maintained incrementally: removing an op
+     * keeps it valid and a newly added op is placed before its first
+     * consumer, so local rewrites do not trigger a full re-sort.
      */
     bool topo_sort();
 
@@ -72,8 +80,113 @@ class GraphObj : public Object {
 
     void shape_infer();
 
+    /**
+     * @brief Where the activations and the workspaces are placed in the
+     * arena.
+     */
+    struct MemoryLayout {
+        // arena offsets and sizes of the tensors but the weights
+        std::unordered_map<TensorObj *, size_t> offsets, bytes;
+        // arena offsets and sizes of the workspaces of the ops needing one
+        std::unordered_map<OperatorObj *, size_t> workspaceOffsets,
+            workspaceBytes;
+        size_t peak;
+        MemoryStrategy strategy;
+    };
+
     void dataMalloc();
 
+    /**
+     * @brief Same as `dataMalloc`, placing the activations and the
+     * workspaces with a layout planned before, e.g. loaded by
+     * `loadCompiled`, instead of planning it.
+     */
+    void dataMalloc(const MemoryLayout &layout);
+
+    /**
+     * @brief The layout the tensors are currently bound to. Only valid after
+     * `dataMalloc` or `resize`.
+     */
+    MemoryLayout getMemoryLayout() const;
+
+    /**
+     * @brief Reorder the ops to lower the peak memory of the activations,
+     * see `MemoryScheduler`. The order is only changed if it lowers the
+     * planned arena, and with a non-zero `budget`, only if the current
+     * arena does not fit in it. Prints the planned arena before and after,
+     * and returns whether it fits in the budget. It must be followed by
+     * `dataMalloc`.
+     */
+    bool scheduleMemory(size_t budget = 0);
+
+    /**
+     * @brief Select how `dataMalloc` and `resize` assign arena offsets to the
+     * activations. Defaults to `MemoryStrategy::Simulation`.
+     */
+    void setMemoryStrategy(MemoryStrategy strategy);
+    MemoryStrategy getMemoryStrategy() const { return memoryStrategy; }
+    /**
+     * @brief The strategy which produced the current layout, i.e. the best
+     * one if `MemoryStrategy::BestOf` is selected.
+     */
+    MemoryStrategy getPlannedStrategy() const { return plannedStrategy; }
+    /**
+     * @brief The peak of every strategy for the current shapes, compared to
+     * the largest number of bytes alive at the same time.
+     */
+    string memoryReport();
+
+    /**
+     * @brief Round `axis` of the graph input `input` up to a multiple of
+     * `granularity`, or to the next power of two if it is 0, when looking up
+     * the memory layout for new input shapes, so that close shapes (e.g.
+     * sequence lengths) share one layout.
+     */
+    void setShapeBucket(const Tensor &input, int axis, int granularity = 0);
+
+    /**
+     * @brief Rebind the shapes of some graph inputs and re-infer all the
+     * other shapes.
+     * Tensors are placed with the memory layout cached for the bucket of the
+     * new input shapes, planned at the largest shapes of the bucket on first
+     * use, and the arena is reused unless it has to grow. Graph inputs which
+     * keep their shape keep their data; the others must be filled again.
+     */
+    void resize(const std::map<Tensor, Shape> &shapes);
+
+    /**
+     * @brief The memory pool holding the activations of this graph and its
+     * size. Only valid after `dataMalloc`.
+     */
+    void *getArena() { return allocator.getPtr(); }
+    size_t getArenaSize() const { return allocator.getPeak(); }
+
+    /**
+     * @brief The memory pool holding the weights and constants of this
+     * graph, see `TensorType`, and its size. It is placed once by
+     * `dataMalloc`, never moves afterwards and is shared by all the contexts
+     * running the graph. Only valid after `dataMalloc`.
+     */
+    void *getWeights() { return weightAllocator.getPtr(); }
+    size_t getWeightsSize() const { return weightAllocator.getPeak(); }
+
+    /**
+     * @brief Declare that the memory of a graph input or output is provided
+     * by the caller at every run, e.g. a request or response buffer, with
+     * `ContextObj::bind` or `TensorObj::setDataBlob`, so that the data is
+     * used in place instead of being copied in or out of the arena. Bound
+     * tensors are left out of the arena; they hold no data until bound. It
+     * must be followed by `dataMalloc`.
+     */
+    void setBound(const Tensor &tensor, bool bound = true);
+
+    /**
+     * @brief Make the weight pool read-only once the weights are loaded, so
+     * that a kernel writing a weight crashes instead of corrupting it, or
+     * writable again. `dataMalloc` makes it writable.
+     */
+    void protectWeights(bool readOnly = true);
+
     /**
      * @brief Add an operator and create its outputs. Output tensor
      * arguments should be empty Refs (e.g., nullptr).
@@ -94,6 +207,17 @@ class GraphObj : public Object {
         return op;
     }
 
+    /**
+     * @brief Add a copy of `op`, which may belong to another graph, reading
+     * `inputs` and writing `outputs` of this graph instead.
+     */
+    Operator cloneOperator(const Operator &op, const TensorVec &inputs,
+                           const TensorVec &outputs) {
+        auto ret = op->clone(inputs, outputs);
+        addOperatorAndConnect(ret);
+        return ret;
+    }
+
     /**
      * @brief Gets input tensors of this graph.
      */
@@ -119,15 +243,75 @@ class GraphObj : public Object {
     bool checkValid() const;
 
   private:
+    /**
+     * @brief Place the weights, then the activations with `layout`, or
+     * with a new layout if it is null.
+     */
+    void allocate(const MemoryLayout *layout);
+
+    /**
+     * @brief Bytes of scratch memory the kernel of an op needs with its
+     * current shapes, 0 if the op has no kernel.
+     */
+    size_t getWorkspaceSize(const Operator &op) const;
+
+    /**
+     * @brief The lifetimes of all the tensors but the weights, listed in
+     * `planned`, followed by the workspaces of the ops listed in
+     * `workspaces` with their sizes, in the current op order. A workspace
+     * only lives during its op.
+     */
+    MemoryPlanner
+    makePlanner(vector<TensorObj *> &planned,
+                vector<pair<OperatorObj *, size_t>> &workspaces) const;
+
+    /**
+     * @brief Assign an arena offset to every tensor but the weights, and to
+     * every workspace, with the current shapes, using the selected strategy.
+     */
+    MemoryLayout planMemory();
+
+    /**
+     * @brief The arena size the selected strategy needs for the current op
+     * order.
+     */
+    size_t planPeak() const;
+
+    /**
+     * @brief Point every tensor but the weights, and every op with a
+     * workspace, to its offset in the arena.
+     */
+    void bindMemory(const MemoryLayout &layout);
+
+    Shape bucketShape(const Tensor &input, Shape shape) const;
+
     /**
      * @brief Add reverse connections and Op relationship in ctor.
      */
     void addOperatorAndConnect(const Operator &op);
 
+    /**
+     * @brief Insert a connected op into the sorted op list. Returns false if
+     * the resulting order is no longer topological.
+     */
+    bool insertSorted(const Operator &op);
+
     /**
      * @brief If the nodes is sorted in topological order.
      */
     bool sorted;
+
+    MemoryStrategy memoryStrategy = MemoryStrategy::Simulation;
+    MemoryStrategy plannedStrategy = MemoryStrategy::Simulation;
+
+    // bucketing rules of the graph inputs, axis -> granularity
+    std::map<TensorObj *, std::map<int, int>> buckets;
+    // memory layouts keyed by the bucketed shapes of the graph inputs
+    std::map<vector<Shape>, MemoryLayout> layouts;
+    // the layout and arena the tensors are currently bound to
+    vector<Shape> boundKey;
+    void *boundArena = nullptr;
+    bool weightsReadOnly = false;
 };
 
 } // namespace infini
@@ -0,0 +1,85 @@
+#pragma once
+#include "core/common.h"
+
+namespace infini {
+
+/**
+ * @brief Instruction set extensions a kernel variant is compiled for, in
+ * increasing order, each one implying the previous ones.
+ */
+enum class Isa {
+    Baseline,
+    // SSE4.2 and POPCNT
+    SSE42,
+    // AVX2 and FMA
+    AVX2,
+    // AVX-512 F, BW, DQ and VL
+    AVX512,
+};
+
+/**
+ * @brief The name of an ISA, as accepted by `parseIsa`: baseline, sse4.2,
+ * avx2 or avx512.
+ */
+const char *toString(Isa isa);
+std::optional<Isa> parseIsa(const string &name);
+
+/**
+ * @brief The best ISA the host CPU supports, detected with CPUID.
+ */
+Isa getHostIsa();
+
+/**
+ * @brief The best ISA kernels are selected for. This is the host ISA, lowered
+ * by the `INFINI_ISA` environment variable if it names a lower one, so that
+ * tests can run the variants of a lower ISA.
+ */
+Isa getIsa();
+
+} // namespace infini
+
+// Kernel sources are compiled once per ISA on x86, with `KERNEL_ISA` set to
+// the name of the variant. The kernels between `KERNEL_ISA_BEGIN` and
+// `KERNEL_ISA_END` are compiled for that ISA, so that the compiler
+// vectorizes their loops with its registers. The region must come after all
+// includes: code from headers stays baseline, because its inline functions
+// are shared between the variants.
+#ifndef KERNEL_ISA
+#define KERNEL_ISA Baseline
+#endif
+
+#define _ISA_CAT(A, B) _CAT(A, B)
+#define KERNEL_ISA_VALUE ::infini::Isa::KERNEL_ISA
+// the kernels of each variant live in their own namespace, to keep the
+// variants of a class apart, which is used by the rest of the source
+#define KERNEL_ISA_NAMESPACE _ISA_CAT(isa_, KERNEL_ISA)
+
+#define _ISA_BEGIN_Baseline
+#define _ISA_END_Baseline
+// clang-format off
+#if defined(__clang__)
+#define _ISA_BEGIN_SSE42 _Pragma("clang attribute push(__attribute__((target(\"sse4.2,popcnt\"))), apply_to = function)")
+#define _ISA_BEGIN_AVX2 _Pragma("clang attribute push(__attribute__((target(\"avx2,fma\"))), apply_to = function)")
+#define _ISA_BEGIN_AVX512 _Pragma("clang attribute push(__attribute__((target(\"avx2,fma,avx512f,avx512bw,avx512dq,avx512vl\"))), apply_to = function)")
+#define _ISA_END_SSE42 _Pragma("clang attribute pop")
+#define _ISA_END_AVX2 _Pragma("clang attribute pop")
+#define _ISA_END_AVX512 _Pragma("clang attribute pop")
+#else
+#define _ISA_BEGIN_SSE42                                                       \
+    _Pragma("GCC push_options") _Pragma("GCC target(\"sse4.2,popcnt\")")
+#define _ISA_BEGIN_AVX2                                                        \
+    _Pragma("GCC push_options") _Pragma("GCC target(\"avx2,fma\")")
+#define _ISA_BEGIN_AVX512 _Pragma("GCC push_options") _Pragma("GCC target(\"avx2,fma,avx512f,avx512bw,avx512dq,avx512vl\")")
+#define _ISA_END_SSE42 _Pragma("GCC pop_options")
+#define _ISA_END_AVX2 _Pragma("GCC pop_options")
+#define _ISA_END_AVX512 _Pragma("GCC pop_options")
+#endif
+// clang-format on
+
+#define KERNEL_ISA_BEGIN                                                       \
+    namespace KERNEL_ISA_NAMESPACE {                                           \
+    _ISA_CAT(_ISA_BEGIN_, KERNEL_ISA)
+#define KERNEL_ISA_END                                                         \
+    _ISA_CAT(_ISA_END_, KERNEL_ISA)                                            \
+    }                                                                          \
+    using namespace KERNEL_ISA_NAMESPACE;
@@ -1,5 +1,6 @@
 #pragma once
 #include "core/common.h"
+#include "core/isa.h"
 #include "core/operator.h"
 #include "core/tensor.h"
 #include "utils/operator_utils.h"
@@ -9,6 +10,23 @@ namespace infini {
 
 class RuntimeObj;
 
+/**
+ * @brief Kernel specific arguments (shapes, strides, attributes) resolved once
+ * for an op, so that launching the kernel does not touch the op again.
+ */
+struct KernelArgs {
+    virtual ~KernelArgs() {}
+};
+
+/**
+ * @brief Entry of a prepared kernel. `data` holds the raw pointers of the
+ * inputs of the op followed by the raw pointers of its outputs and the
+ * workspace of the op, null if it has none.
+ */
+using KernelFunc = void (*)(const KernelArgs *args, void *const *data,
+                            const RuntimeObj *context);
+using PreparedKernel = pair<KernelFunc, Ref<KernelArgs>>;
+
 class Kernel {
   public:
     Kernel() {}
@@ -19,12 +37,30 @@ class Kernel {
      */
     virtual void compute(const Operator &op,
                          const RuntimeObj *context) const = 0;
+
+    /**
+     * @brief Resolves the entry and the arguments of this kernel for an op.
+     * Kernels which cannot be prepared return an empty entry and are
+     * executed through `compute`.
+     */
+    virtual PreparedKernel prepare(const Operator &op,
+                                   const RuntimeObj *context) const {
+        return {nullptr, nullptr};
+    }
+
+    /**
+     * @brief Bytes of scratch memory the kernel needs for an op with its
+     * current shapes. `GraphObj::dataMalloc` places the workspace in the
+     * arena, where it only lives while the op runs, so kernels never
+     * allocate memory while running.
+     */
+    virtual size_t getWorkspaceSize(const Operator &op) const { return 0; }
 };
 
 class KernelRegistry {
   public:
-    using KernelRecord =
-        tuple<Kernel *const, const string, const int>; // Kernel, name, ID
+    // Kernel, name, ID, ISA of the variant
+    using KernelRecord = tuple<Kernel *const, const string, const int, Isa>;
 
   private:
     std::map<KernelAttrs, KernelRecord> kernels;
@@ -39,18 +75,44 @@ class KernelRegistry {
         static KernelRegistry instance;
         return instance;
     }
-    bool registerKernel(const KernelAttrs &key, Kernel *kernel, string name) {
-        IT_ASSERT(kernels.find(key) == kernels.end(),
-                  "Kernel already registered");
-        kernels.emplace(key, KernelRecord{kernel, name, ++nKernels});
+    /**
+     * @brief Registers the variant of a kernel compiled for `isa`. Of the
+     * variants of a kernel, the registry keeps the one of the best ISA not
+     * above `getIsa()`, whatever the registration order; the others are
+     * never constructed. The names of variants above the baseline end with
+     * their ISA.
+     */
+    bool registerKernel(const KernelAttrs &key, Isa isa, Kernel *(*make)(),
+                        string name) {
+        if (isa > getIsa())
+            return false;
+        auto it = kernels.find(key);
+        if (it != kernels.end()) {
+            auto current = std::get<3>(it->second);
+            IT_ASSERT(current != isa, "Kernel already registered");
+            if (current > isa)
+                return false;
+            delete std::get<0>(it->second);
+            kernels.erase(it);
+        }
+        if (isa != Isa::Baseline)
+            name = name + "_" + toString(isa);
+        kernels.emplace(key, KernelRecord{make(), name, ++nKernels, isa});
         return true;
     }
     Kernel *getKernel(const KernelAttrs &kernelAttrs) const {
+        auto kernel = findKernel(kernelAttrs);
+        IT_ASSERT(kernel != nullptr, "Kernel not found for key {" +
+                                         get_kernel_attrs_str(kernelAttrs) +
+                                         "}");
+        return kernel;
+    }
+    /**
+     * @brief Same as `getKernel`, returning nullptr if there is no kernel.
+     */
+    Kernel *findKernel(const KernelAttrs &kernelAttrs) const {
         auto it = kernels.find(kernelAttrs);
-        IT_ASSERT(it != kernels.end(), "Kernel not found for key {" +
-                                           get_kernel_attrs_str(kernelAttrs) +
-                                           "}");
-        return std::get<0>(it->second);
+        return it == kernels.end() ? nullptr : std::get<0>(it->second);
     }
     const KernelRecord &getKernelItem(const KernelAttrs &kernelAttrs) const {
         return kernels.at(kernelAttrs);
@@ -59,8 +121,21 @@ class KernelRegistry {
 
 class CpuKernelWithoutConfig : public Kernel {
   public:
-    virtual void compute(const Operator &op,
-                         const RuntimeObj *context) const = 0;
+    void compute(const Operator &op, const RuntimeObj *context) const override {
+        IT_ASSERT(getWorkspaceSize(op) <= op->getWorkspaceSize(),
+                  "The workspace of the op is not allocated");
+        auto [func, args] = prepare(op, context);
+        vector<void *> data;
+        for (auto &input : op->getInputs())
+            data.emplace_back(input->getRawDataPtr<void *>());
+        for (auto &output : op->getOutputs())
+            data.emplace_back(output->getRawDataPtr<void *>());
+        data.emplace_back(op->getWorkspace());
+        func(args.get(), data.data(), context);
+    }
+
+    virtual PreparedKernel prepare(const Operator &op,
+                                   const RuntimeObj *context) const = 0;
 };
 
 } // namespace infini
@@ -68,9 +143,9 @@ class CpuKernelWithoutConfig : public Kernel {
 #define _REGISTER_KERNEL_1(device, opType, kernel, name, cnt)                  \
     namespace infini {                                                         \
     static const bool _CAT(_register_kernel_, cnt) =                           \
-        KernelRegistry::getInstance().registerKernel(KernelAttrs{device,       \
-                                                                 opType},      \
-                                                     new kernel(), name);      \
+        KernelRegistry::getInstance().registerKernel(                          \
+            KernelAttrs{device, opType}, KERNEL_ISA_VALUE,                     \
+            []() -> Kernel * { return new kernel(); }, name);                  \
     }
 
 #define REGISTER_KERNEL(device, opType, kernel, name)                          \
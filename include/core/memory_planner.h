@@ -0,0 +1,133 @@
+#pragma once
+#include "core/common.h"
+
+namespace infini {
+
+/**
+ * @brief How the arena offsets of the tensors of a graph are assigned.
+ */
+enum class MemoryStrategy {
+    // replays the ops in order, allocating outputs and freeing inputs after
+    // their last use with a best-fit allocator
+    Simulation,
+    // places buffers from the largest to the smallest, each in the best
+    // fitting gap left by the buffers already placed whose lifetimes overlap
+    GreedyBySize,
+    // places the buffers of the ops using the most memory first
+    GreedyByBreadth,
+    // runs all the strategies above and keeps the lowest peak
+    BestOf,
+};
+
+const char *toString(MemoryStrategy strategy);
+
+/**
+ * @brief Offline assignment of offsets to buffers with known lifetimes.
+ * Lifetimes are given in steps, i.e. positions of the ops in execution
+ * order; two buffers may share memory if their lifetimes are disjoint.
+ */
+class MemoryPlanner {
+  public:
+    struct Buffer {
+        size_t size;
+        // the step defining the buffer and the last step using it, both
+        // included; buffers alive during the whole run span [0, steps]
+        size_t first, last;
+    };
+
+    struct Result {
+        // the strategy which produced the offsets, never BestOf
+        MemoryStrategy strategy;
+        vector<size_t> offsets;
+        size_t peak;
+    };
+
+  private:
+    vector<Buffer> buffers;
+    // buffers read or written by every step
+    vector<vector<size_t>> steps;
+    size_t alignment;
+
+  public:
+    /**
+     * @param buffers Sizes are rounded up to `alignment`.
+     * @param steps The buffers read or written by every step.
+     */
+    MemoryPlanner(vector<Buffer> buffers, vector<vector<size_t>> steps,
+                  size_t alignment);
+
+    Result plan(MemoryStrategy strategy) const;
+
+    /**
+     * @brief The largest number of bytes alive at the same step, a lower
+     * bound of the peak of any strategy.
+     */
+    size_t lowerBound() const;
+
+    /**
+     * @brief A table of the peak of every strategy against the lower bound.
+     */
+    string report() const;
+
+  private:
+    Result simulate() const;
+    Result greedyBySize() const;
+    Result greedyByBreadth() const;
+    // places buffers in the given order, see `GreedyBySize`
+    Result greedy(MemoryStrategy strategy, const vector<size_t> &order) const;
+};
+
+/**
+ * @brief Chooses an execution order of a DAG of ops lowering the peak of
+ * live bytes. A buffer is live from the op writing it, or from the start if
+ * no op writes it, until its last reader; buffers read by no op stay live
+ * until the end. An op depends on the writers of the buffers it reads.
+ */
+class MemoryScheduler {
+  public:
+    struct Op {
+        vector<size_t> inputs, outputs;
+        // scratch memory only live while the op runs
+        size_t workspace = 0;
+    };
+
+    // graphs with at most this many ops are scheduled optimally
+    static constexpr size_t maxExactOps = 16;
+
+  private:
+    vector<size_t> sizes;
+    vector<Op> ops;
+    // the op writing every buffer, or ops.size(), and the ops reading it
+    vector<size_t> writer;
+    vector<vector<size_t>> readers;
+
+  public:
+    /**
+     * @param sizes The size of every buffer.
+     * @param ops Buffers are written by at most one op; duplicated inputs
+     * are ignored.
+     */
+    MemoryScheduler(vector<size_t> sizes, vector<Op> ops);
+
+    /**
+     * @brief The largest number of bytes live while an op runs, following
+     * `order`.
+     */
+    size_t peak(const vector<size_t> &order) const;
+
+    /**
+     * @brief A topological order of the ops: the optimal one by dynamic
+     * programming over the sets of executed ops for small graphs, otherwise
+     * a greedy one running first the ready op which increases the live bytes
+     * the least.
+     */
+    vector<size_t> schedule() const;
+
+  private:
+    vector<size_t> exact() const;
+    vector<size_t> greedy() const;
+    // the bytes an op allocates, including its workspace
+    size_t allocated(size_t op) const;
+};
+
+} // namespace infini
@@ -0,0 +1,90 @@
+#pragma once
+#include "core/graph.h"
+
+namespace infini {
+
+/**
+ * @brief A read-only file mapped in memory. Pages are loaded lazily by the
+ * kernel and shared with the page cache; they are copied only if written.
+ */
+class MappedFile {
+    void *ptr;
+    size_t size;
+
+  public:
+    explicit MappedFile(const string &path);
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *data() const { return static_cast<const char *>(ptr); }
+    char *data() { return static_cast<char *>(ptr); }
+    size_t getSize() const { return size; }
+};
+
+/**
+ * @brief The binary model format, version `modelVersion`. All the integers
+ * are little-endian:
+ *
+ * - a header: the magic "ITMODEL\0", the version and byte order marks, then
+ *   the offset and size of the metadata and of the data sections and, since
+ *   version 2, of the plan section, with the key and engine version of the
+ *   plan;
+ * - the metadata: the tensors (dtype, type, shape, offset of their data in
+ *   the data section or -1) followed by the ops in topological order (type,
+ *   input and output tensor indices, attributes);
+ * - the plan, empty unless written by `saveCompiled`: the arena size and
+ *   memory strategy, the arena offset of every tensor (-1 for the weights
+ *   and the tensors bound by the caller), and the kernel name and workspace
+ *   of every op;
+ * - the data: the content of the weights and constants, every blob aligned
+ *   to `modelAlignment` bytes.
+ */
+constexpr uint32_t modelVersion = 2;
+constexpr size_t modelAlignment = 64;
+
+/**
+ * @brief Version of the planner and kernels a compiled model is valid for.
+ * Bump it whenever they change in a way that invalidates saved plans.
+ */
+constexpr uint32_t engineVersion = 1;
+
+/**
+ * @brief Write a graph to `path`. Weights and constants must hold their
+ * data, i.e. the graph must have been allocated with `GraphObj::dataMalloc`
+ * and the weights filled.
+ */
+void saveModel(const Graph &graph, const string &path);
+
+/**
+ * @brief Read a graph written by `saveModel`. The file is mapped in memory
+ * and the weights and constants point straight into the mapping, which
+ * lives as long as they do, so nothing is read or copied up front.
+ * `GraphObj::dataMalloc` must still be called to place the activations.
+ */
+Graph loadModel(const string &path, Runtime runtime);
+
+/**
+ * @brief A hash of the structure, attributes and weights of a graph, to key
+ * its compiled form by.
+ */
+uint64_t hashGraph(const Graph &graph);
+
+/**
+ * @brief Write a graph after `optimize` and `dataMalloc`, with its memory
+ * layout and the kernels chosen for its ops, so that `loadCompiled` can
+ * serve it without planning anything. `key` identifies the source graph,
+ * e.g. `hashGraph` of the graph before optimization.
+ */
+void saveCompiled(const Graph &graph, const string &path, uint64_t key);
+
+/**
+ * @brief Read a graph written by `saveCompiled` and allocate it with the
+ * saved layout, like `loadModel` then `GraphObj::dataMalloc`. Returns
+ * nullptr if the file is missing or was compiled from another source graph,
+ * by another engine version or for other kernels, in which case the caller
+ * compiles the graph and saves it again.
+ */
+Graph loadCompiled(const string &path, Runtime runtime, uint64_t key);
+
+} // namespace infini
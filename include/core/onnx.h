@@ -0,0 +1,34 @@
+#pragma once
+#include "core/graph.h"
+#include <map>
+
+namespace infini {
+
+/**
+ * @brief A graph imported from an ONNX model, with the ONNX names of its
+ * tensors.
+ */
+struct OnnxModel {
+    Graph graph;
+    // graph inputs and outputs in the order of the model; initializers are
+    // not inputs
+    TensorVec inputs, outputs;
+    std::unordered_map<string, Tensor> tensors;
+};
+
+/**
+ * @brief Import an ONNX model. The protobuf encoding is parsed directly,
+ * without the ONNX or protobuf libraries.
+ *
+ * Supported nodes: Add, Sub, Mul, Div, Relu, MatMul, Gemm (alpha = beta =
+ * 1), Transpose, Concat, Clip and Cast. Initializers become weights; their
+ * data is mapped in memory without copy when it is aligned to
+ * `RuntimeObj::alignment`, either in the model or in its external data
+ * files, and copied otherwise.
+ *
+ * @param dims Values of the symbolic dimensions of the graph inputs.
+ */
+OnnxModel loadOnnx(const string &path, Runtime runtime,
+                   const std::map<string, int> &dims = {});
+
+} // namespace infini
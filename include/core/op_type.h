@@ -21,6 +21,10 @@ struct OpType {
         Relu,
         Sub,
         Transpose,
+        // appended, so that the values of the ops above stay those saved by
+        // `saveModel`
+        AllGather,
+        AllReduceSum,
 
     } type;
 
@@ -16,6 +16,10 @@ class OperatorObj : public Object {
     TensorVec outputs;
     vector<WRef<OperatorObj>> predecessors;
     vector<WRef<OperatorObj>> successors;
+    // scratch memory of the kernel of this op in the arena of the graph,
+    // bound by `GraphObj::dataMalloc`
+    Blob workspace;
+    size_t workspaceSize = 0;
 
   public:
     OperatorObj(OpType opType, TensorVec inputs, TensorVec outputs);
@@ -48,6 +52,14 @@ class OperatorObj : public Object {
     // HACK: set correct data type
     DataType getDType() const { return getInputs(0)->getDType(); }
     DataType getOutDType() const { return getOutput()->getDType(); }
+    /**
+     * @brief The workspace bound to this op, null if it has none. See
+     * `Kernel::getWorkspaceSize`.
+     */
+    void *getWorkspace() const {
+        return workspace ? workspace->getPtr<void *>() : nullptr;
+    }
+    size_t getWorkspaceSize() const { return workspaceSize; }
     virtual int numInputs() const = 0;
     virtual int numOutputs() const = 0;
 
@@ -0,0 +1,133 @@
+#pragma once
+#include "core/kernel.h"
+#include "core/object.h"
+#include "core/profiler.h"
+#include "core/runtime.h"
+#include <map>
+
+namespace infini {
+
+/**
+ * @brief An immutable execution plan of a graph. Kernels, their arguments and
+ * the raw data pointers of every op are resolved once at compile time, so
+ * running the plan is a loop of plain function calls.
+ */
+class PlanObj : public Object {
+  public:
+    struct Step {
+        KernelFunc func;
+        const KernelArgs *args;
+        // position of the raw pointers of the inputs followed by the outputs
+        // and the workspace in the data table
+        size_t offset;
+    };
+
+  private:
+    Graph graph;
+    void *arena;
+    size_t arenaSize;
+    bool relocatable;
+    OpVec ops;
+    vector<Ref<KernelArgs>> args;
+    vector<void *> data;
+    // positions of the bound tensors in the data table
+    std::unordered_map<TensorObj *, vector<size_t>> slots;
+    vector<Step> steps;
+    // dependencies between steps, including the ones caused by buffers
+    // which are reused in the arena
+    vector<vector<size_t>> successors;
+    vector<size_t> dependencies;
+    size_t width;
+
+  public:
+    /**
+     * @brief Compiles a graph whose memory has been allocated with
+     * `GraphObj::dataMalloc`.
+     */
+    PlanObj(const Graph &graph, const RuntimeObj *context);
+    string toString() const override;
+
+    Graph getGraph() const { return graph; }
+    const OpVec &getOperators() const { return ops; }
+    const vector<Step> &getSteps() const { return steps; }
+    /**
+     * @brief The data table: raw pointers of every step, pointing into the
+     * arena of the graph.
+     */
+    const vector<void *> &getData() const { return data; }
+    /**
+     * @brief Positions of a bound tensor, see `GraphObj::setBound`, in the
+     * data table. They hold null unless the tensor was given data before
+     * compiling.
+     */
+    const vector<size_t> &getSlots(const Tensor &tensor) const;
+    /**
+     * @brief Asserts that every bound tensor has data in a data table.
+     */
+    void checkBound(void *const *data) const;
+    void *getArena() const { return arena; }
+    size_t getArenaSize() const { return arenaSize; }
+    /**
+     * @brief Whether the plan can run on another data table. Steps falling
+     * back to `Kernel::compute` read the tensors of the graph directly.
+     */
+    bool isRelocatable() const { return relocatable; }
+    const vector<size_t> &getSuccessors(size_t i) const {
+        return successors[i];
+    }
+    size_t getDependencies(size_t i) const { return dependencies[i]; }
+    /**
+     * @brief The largest number of steps at the same depth of the dependency
+     * graph, i.e. an estimation of the available inter-op parallelism.
+     */
+    size_t getWidth() const { return width; }
+
+    void run(const RuntimeObj *context) const { run(context, data.data()); }
+    void run(const RuntimeObj *context, void *const *data,
+             Profiler *profiler = nullptr) const {
+        for (size_t i = 0; i < steps.size(); ++i)
+            runStep(i, context, data, profiler);
+    }
+    /**
+     * @brief Runs one step, timing it if a profiler is given.
+     */
+    void runStep(size_t i, const RuntimeObj *context, void *const *data,
+                 Profiler *profiler) const {
+        const auto &step = steps[i];
+        if (profiler == nullptr)
+            step.func(step.args, data + step.offset, context);
+        else
+            runProfiled(i, context, data, *profiler);
+    }
+
+  private:
+    void buildDependencies();
+    void runProfiled(size_t i, const RuntimeObj *context, void *const *data,
+                     Profiler &profiler) const;
+};
+
+/**
+ * @brief Compiled plans of a graph with dynamic input shapes, keyed by the
+ * shapes of the graph inputs. The memory of the graph is managed by
+ * `GraphObj::resize`, so shapes of one bucket share the arena layout.
+ */
+class PlanCache {
+    Graph graph;
+    const RuntimeObj *context;
+    std::map<vector<Shape>, Plan> plans;
+
+  public:
+    PlanCache(const Graph &graph, const RuntimeObj *context)
+        : graph(graph), context(context) {}
+
+    /**
+     * @brief Resize the graph inputs and return the plan for the new shapes,
+     * compiling it on first use. Inputs which are resized must be filled
+     * again before running the plan.
+     */
+    Plan get(const std::map<Tensor, Shape> &shapes);
+
+    size_t size() const { return plans.size(); }
+};
+
+} // namespace infini
@@ -0,0 +1,71 @@
+#pragma once
+#include "core/operator.h"
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace infini {
+
+/**
+ * @brief Collects per-op timings of the runs of a runtime in profiling mode,
+ * see `NativeCpuRuntimeObj::setProfiler`. Records can be aggregated per op
+ * type or exported as a Chrome trace (chrome://tracing, Perfetto).
+ */
+class Profiler {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Record {
+        OpType type = OpType::Unknown;
+        UidBaseType guid;
+        string inputs, outputs;
+        // bytes read and written, and the estimated floating point operations
+        size_t bytes, flops;
+        // index of the thread in the order threads were first seen
+        int thread;
+        // in microseconds since the creation of the profiler
+        double start, duration;
+    };
+
+  private:
+    Clock::time_point origin;
+    mutable std::mutex lock;
+    vector<Record> records;
+    std::unordered_map<std::thread::id, int> threads;
+
+  public:
+    Profiler() : origin(Clock::now()) {}
+
+    /**
+     * @brief Records a run of `op` on the calling thread. Thread safe.
+     */
+    void record(const Operator &op, Clock::time_point begin,
+                Clock::time_point end);
+
+    vector<Record> getRecords() const;
+    void clear();
+
+    /**
+     * @brief A table of the time, bandwidth and throughput per op type,
+     * sorted by decreasing total time.
+     */
+    string summary() const;
+
+    /**
+     * @brief The records in the Chrome trace event format.
+     */
+    string toChromeTrace() const;
+
+    /**
+     * @brief Floating point operations of an op for its current shapes, or 0
+     * for ops which only move data.
+     */
+    static size_t estimateFlops(const Operator &op);
+    /**
+     * @brief Bytes of the inputs and outputs of an op.
+     */
+    static size_t estimateBytes(const Operator &op);
+};
+
+} // namespace infini
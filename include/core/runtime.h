@@ -1,7 +1,14 @@
 #pragma once
 #include "core/common.h"
 #include "core/op_type.h"
+#include "core/executor.h"
 #include "core/ref.h"
+#include "core/scheduler.h"
+#include "core/thread_pool.h"
+#include <exception>
+#include <future>
+#include <mutex>
+#include <unordered_map>
 
 namespace infini {
 class TensorObj;
@@ -9,40 +16,150 @@ class OperatorObj;
 class GraphObj;
 class RuntimeObj;
 class BlobObj;
+class PlanObj;
+class ContextObj;
+class Profiler;
 
 using Tensor = Ref<TensorObj>;
 using Operator = Ref<OperatorObj>;
 using Graph = Ref<GraphObj>;
 using Runtime = Ref<RuntimeObj>;
 using Blob = Ref<BlobObj>;
+using Plan = Ref<PlanObj>;
+using Context = Ref<ContextObj>;
 
 using TensorVec = vector<Tensor>;
 using OpVec = vector<Operator>;
 
 enum class Device { CPU = 1 };
 
+/**
+ * @brief How a runtime obtains the memory of arenas and weight pools.
+ */
+struct MemoryConfig {
+    // blocks of at least this many bytes are mapped with mmap, smaller ones
+    // come from the heap
+    size_t mmapThreshold = 1 << 20;
+    // asks for transparent huge pages on mapped blocks, which are then
+    // aligned to the huge page size
+    bool hugePages = true;
+    // maps blocks with explicit huge pages (MAP_HUGETLB) when the system has
+    // some reserved, falling back to regular pages otherwise
+    bool explicitHugePages = false;
+    // touches every page of mapped blocks with the thread pool, so that page
+    // faults are taken before the first run and every page is placed on the
+    // NUMA node of the thread which will compute on it
+    bool prefault = false;
+};
+
 class RuntimeObj : public std::enable_shared_from_this<RuntimeObj> {
   protected:
     Device device;
+    Ref<ThreadPool> threadPool;
+
+  private:
+    mutable std::mutex executorLock;
+    mutable std::unique_ptr<Executor> executor;
 
   public:
-    explicit RuntimeObj(Device device) : device(device) {}
+    explicit RuntimeObj(Device device)
+        : device(device), threadPool(make_ref<ThreadPool>(ThreadPoolConfig{})) {
+    }
     RuntimeObj(RuntimeObj &other) = delete;
     RuntimeObj &operator=(RuntimeObj const &) = delete;
     virtual ~RuntimeObj() {}
 
+    // alignment of the blocks returned by `alloc` and of the tensors placed
+    // in them: one cache line, or one AVX-512 register
+    static constexpr size_t alignment = 64;
+
     virtual void run(const Graph &graph) const = 0;
+    virtual void run(const Plan &plan) const = 0;
+    /**
+     * @brief Runs the plan of a context on the data of the context.
+     */
+    virtual void run(const Context &context) const = 0;
+
+    /**
+     * @brief Queues a context to be run on the thread of this runtime.
+     * Requests are run one after another in submission order, so the caller
+     * can prepare the next request while the previous one is computed.
+     */
+    std::future<void> runAsync(const Context &context) const;
+    /**
+     * @brief Same as above, calling `callback` on the thread of the runtime
+     * once the request is finished, with the error it raised if any.
+     */
+    void runAsync(const Context &context,
+                  std::function<void(std::exception_ptr)> callback) const;
+
+    /**
+     * @brief Resolves the kernels and data pointers of a graph into a plan
+     * that can be run many times.
+     */
+    Plan compile(const Graph &graph) const;
+    /**
+     * @brief Returns a block of at least `size` bytes aligned to `alignment`.
+     * Its content is unspecified.
+     */
     virtual void *alloc(size_t size) = 0;
+    /**
+     * @brief Same as `alloc`, but the block spans whole pages so that it can
+     * be protected with `protect`.
+     */
+    virtual void *allocPages(size_t size) = 0;
     virtual void dealloc(void *ptr) = 0;
+    /**
+     * @brief Makes a block returned by `allocPages` read-only, so that
+     * writing it crashes, or writable again.
+     */
+    virtual void protect(void *ptr, bool readOnly) = 0;
 
     bool isCpu() const { return true; }
+    Device getDevice() const { return device; }
+
+    /**
+     * @brief Replaces the thread pool used by kernels of this runtime. It must
+     * not be called while the runtime is running a graph.
+     */
+    void setThreadPool(const ThreadPoolConfig &config) {
+        threadPool = make_ref<ThreadPool>(config);
+    }
+    ThreadPool &getThreadPool() const { return *threadPool; }
+
+    /**
+     * @brief Runs `body` on sub-ranges of [begin, end) with the threads of
+     * this runtime. See `ThreadPool::parallelFor`.
+     */
+    void parallelFor(size_t begin, size_t end, size_t grain,
+                     const ThreadPool::Body &body) const {
+        threadPool->parallelFor(begin, end, grain, body);
+    }
 
     virtual string toString() const = 0;
+
+  protected:
+    /**
+     * @brief Finishes the pending asynchronous requests. Derived runtimes
+     * call it in their destructor, while they can still run requests.
+     */
+    void stopAsync();
 };
 
 class NativeCpuRuntimeObj : public RuntimeObj {
+    ParallelConfig parallelConfig;
+    mutable std::mutex schedulerLock;
+    mutable Ref<Scheduler> scheduler;
+    Ref<Profiler> profiler;
+    MemoryConfig memoryConfig;
+    // size of the mapping of every block returned by `alloc` and
+    // `allocPages`, 0 for blocks from the heap
+    std::mutex blocksLock;
+    std::unordered_map<void *, size_t> blocks;
+
   public:
     NativeCpuRuntimeObj() : RuntimeObj(Device::CPU) {}
+    ~NativeCpuRuntimeObj() { stopAsync(); }
 
     static Ref<NativeCpuRuntimeObj> &getInstance() {
         static Ref<NativeCpuRuntimeObj> instance =
@@ -51,8 +168,42 @@ class NativeCpuRuntimeObj : public RuntimeObj {
     }
     void dealloc(void *ptr) override;
     void run(const Graph &graph) const override;
+    void run(const Plan &plan) const override;
+    void run(const Context &context) const override;
     void *alloc(size_t size) override;
+    void *allocPages(size_t size) override;
+    void protect(void *ptr, bool readOnly) override;
     string toString() const override;
+
+    /**
+     * @brief Sets how many ops of a plan may run concurrently and how many
+     * threads each of them may use. Plans run sequentially by default.
+     */
+    void setParallelConfig(const ParallelConfig &config);
+    ParallelConfig getParallelConfig() const { return parallelConfig; }
+
+    /**
+     * @brief Enables profiling: every op run by this runtime is timed and
+     * recorded in `profiler`. Pass nullptr to disable it. It must not be
+     * called while the runtime is running a graph.
+     */
+    void setProfiler(Ref<Profiler> profiler_) {
+        profiler = std::move(profiler_);
+    }
+    Ref<Profiler> getProfiler() const { return profiler; }
+
+    /**
+     * @brief Applies to the blocks allocated afterwards.
+     */
+    void setMemoryConfig(const MemoryConfig &config) { memoryConfig = config; }
+    const MemoryConfig &getMemoryConfig() const { return memoryConfig; }
+
+  private:
+    void run(const PlanObj &plan, void *const *data) const;
+    Ref<Scheduler> getScheduler(const ParallelConfig &config) const;
+    void *map(size_t &size);
+    void *record(void *ptr, size_t size);
+    void prefault(void *ptr, size_t size) const;
 };
 
 } // namespace infini
@@ -0,0 +1,91 @@
+#pragma once
+#include "core/common.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace infini {
+
+class PlanObj;
+class RuntimeObj;
+class Profiler;
+
+/**
+ * @brief How the cores are split between ops running concurrently (inter-op)
+ * and the threads used inside a single op (intra-op).
+ */
+struct ParallelConfig {
+    // number of ops running concurrently, 0 to derive it from the core count
+    // and the width of the graph
+    int interOp = 1;
+    // size of the thread pool of the runtime, 0 to keep the current one
+    int intraOp = 0;
+
+    /**
+     * @brief Gives as many cores to inter-op parallelism as the graph is
+     * wide, and splits the remaining ones evenly between concurrent ops.
+     */
+    static ParallelConfig split(int cores, int width);
+};
+
+/**
+ * @brief Executes the steps of a plan on a set of threads, following the
+ * dependencies between steps. Each thread owns a deque of ready steps, pops
+ * its own work from the back and steals from the front of the others.
+ */
+class Scheduler {
+    struct Queue {
+        std::mutex lock;
+        std::deque<size_t> steps;
+    };
+
+    vector<std::thread> threads;
+    vector<std::unique_ptr<Queue>> queues;
+
+    std::mutex lock, runLock;
+    std::condition_variable wake;
+    bool stop = false;
+
+    // state of the current run
+    const PlanObj *plan = nullptr;
+    void *const *data = nullptr;
+    const RuntimeObj *context = nullptr;
+    Profiler *profiler = nullptr;
+    std::unique_ptr<std::atomic<size_t>[]> pending;
+    std::atomic<size_t> remaining{0}, queued{0}, active{0};
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+
+  public:
+    /**
+     * @param nThreads Number of threads running steps, including the thread
+     * calling `run`.
+     */
+    explicit Scheduler(int nThreads);
+    ~Scheduler();
+    Scheduler(const Scheduler &) = delete;
+    Scheduler &operator=(const Scheduler &) = delete;
+
+    int getThreads() const { return queues.size(); }
+
+    /**
+     * @brief Runs a plan on a data table, see `PlanObj::getData`, timing the
+     * steps if a profiler is given.
+     */
+    void run(const PlanObj &plan, void *const *data,
+             const RuntimeObj *context, Profiler *profiler = nullptr);
+
+  private:
+    void workerLoop(int id);
+    // runs ready steps until the current run is finished
+    void work(int id);
+    bool pop(int id, size_t &step);
+    void push(int id, size_t step);
+    void execute(int id, size_t step);
+};
+
+} // namespace infini
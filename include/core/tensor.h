@@ -11,6 +11,28 @@ namespace infini {
 class GraphObj;
 using ShapeElem = int;
 using Shape = vector<ShapeElem>;
+
+/**
+ * @brief The role of a tensor in a graph, which decides where its memory
+ * lives.
+ */
+enum class TensorType {
+    // produced and consumed during a run, planned into the reusable arena
+    Activation,
+    // graph inputs, filled before every run and kept in the arena for the
+    // whole run
+    Input,
+    // graph outputs, kept in the arena for the whole run to be read after it
+    Output,
+    // parameters loaded once, placed in the persistent weight pool and
+    // shared by all the contexts running the graph
+    Weight,
+    // values fixed when the graph is built, placed with the weights
+    Constant,
+};
+
+const char *toString(TensorType type);
+
 class TensorObj : public Object {
     friend class GraphObj;
 
@@ -22,6 +44,11 @@ class TensorObj : public Object {
     WRef<OperatorObj> source;
     Blob data;
     Runtime runtime;
+    // Weight or Constant if declared so, otherwise Activation and the type
+    // follows the position of the tensor in the graph
+    TensorType type = TensorType::Activation;
+    // a graph input or output provided by the caller at every run
+    bool bound = false;
 
   private:
     Shape shape;
@@ -41,11 +68,43 @@ class TensorObj : public Object {
     void setShape(Shape shape_);
     size_t getRank() const { return shape.size(); }
     UidBaseType getFuid() const { return fuid; }
+    /**
+     * @brief Weight and Constant are declared, the other types follow from
+     * the source and targets of the tensor.
+     */
+    TensorType getTensorType() const;
+    /**
+     * @brief Declare a tensor as a graph input holding a Weight or a
+     * Constant, or reset it with Activation.
+     */
+    void setTensorType(TensorType type_);
+    /**
+     * @brief Whether the tensor lives in the weight pool rather than in the
+     * arena, i.e. is a Weight or a Constant. Such tensors are read-only
+     * during runs.
+     */
+    bool isWeight() const {
+        return type == TensorType::Weight || type == TensorType::Constant;
+    }
+    void setWeight(bool weight = true) {
+        setTensorType(weight ? TensorType::Weight : TensorType::Activation);
+    }
+    /**
+     * @brief Whether the memory of the tensor is provided by the caller at
+     * every run, see `GraphObj::setBound`.
+     */
+    bool isBound() const { return bound; }
+    /**
+     * @brief Whether the tensor is placed in the activation arena, i.e. is
+     * neither a weight nor bound.
+     */
+    bool inArena() const { return !isWeight() && !bound; }
 
     void setData(
         std::function<void(void *, size_t, DataType)> const &generator) const;
 
     void setDataBlob(const Blob &blob);
+    bool hasData() const { return data != nullptr; }
 
     void printData() const;
     bool equalData(const Tensor &rhs, double relativeError = 1e-6) const;
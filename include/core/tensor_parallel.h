@@ -0,0 +1,36 @@
+#pragma once
+#include "core/communicator.h"
+#include "core/graph.h"
+
+namespace infini {
+
+/**
+ * @brief The part of a graph run by one process, see `shardGraph`.
+ */
+struct ShardedGraph {
+    Graph graph;
+    // the tensors standing for the inputs but the weights, and for the
+    // outputs of the source graph, in the same order
+    TensorVec inputs, outputs;
+};
+
+/**
+ * @brief Split the MatMuls of `graph` with a weight as the right operand
+ * over the processes of `comm`, Megatron style: a MatMul is
+ * column-parallel, each process computing the columns of the output matching
+ * its slice of the weight columns, and its output stays sharded along the
+ * last axis through the element-wise ops following it. A MatMul reading
+ * such a sharded tensor is row-parallel, each process multiplying with its
+ * slice of the weight rows, and the partial products are summed by an
+ * AllReduceSum. An op that cannot read a shard, and every output, get the
+ * whole tensor through an AllGather. Every process must shard the same
+ * graph, and run the ops of its part in graph order, since the collectives
+ * of all the processes pair up in that order.
+ *
+ * The weights of `graph` must be filled. The slices are copied, while the
+ * weights every process needs whole are shared with `graph`, which is kept
+ * alive. The returned graph must be allocated by `dataMalloc`.
+ */
+ShardedGraph shardGraph(const Graph &graph, const Communicator &comm);
+
+} // namespace infini
@@ -0,0 +1,98 @@
+#pragma once
+#include "core/common.h"
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+namespace infini {
+
+struct ThreadPoolConfig {
+    // number of threads including the caller, 0 for one per hardware thread
+    int threads = 0;
+    // cpus the worker threads are pinned to, round-robin; empty disables
+    // pinning
+    vector<int> cpus;
+    // number of polls an idle worker spins before blocking, trading cpu time
+    // for wake-up latency
+    int spin = 0;
+    // least number of iterations per chunk when the caller gives no grain
+    size_t grain = 4096;
+};
+
+/**
+ * @brief A fork-join pool of threads owned by a runtime. Only one parallel
+ * region runs at a time: nested calls, or calls made while the pool is
+ * busy, run inline on the calling thread.
+ */
+class ThreadPool {
+  public:
+    /**
+     * @brief A reference to a callable over a sub-range, which does not own
+     * or copy it, so that calling `parallelFor` with a lambda allocates
+     * nothing. It must not outlive the callable.
+     */
+    class Body {
+        const void *callable;
+        void (*invoke)(const void *, size_t, size_t);
+
+      public:
+        template <typename F,
+                  typename = std::enable_if_t<
+                      !std::is_same_v<std::decay_t<F>, Body>>>
+        Body(const F &f)
+            : callable(&f), invoke([](const void *callable, size_t begin,
+                                      size_t end) {
+                  (*static_cast<const F *>(callable))(begin, end);
+              }) {}
+
+        void operator()(size_t begin, size_t end) const {
+            invoke(callable, begin, end);
+        }
+    };
+
+  private:
+    ThreadPoolConfig config;
+    int nThreads;
+    vector<std::thread> workers;
+
+    std::mutex regionLock, lock;
+    std::condition_variable wake;
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> generation{0};
+    // workers inside the current region: incremented under `lock` when a
+    // worker joins, decremented without it when the worker is done, the
+    // caller spinning until it drops to 0 before starting another region
+    std::atomic<int> active{0};
+
+    // the current region, written under `lock` while no worker is active
+    const Body *body = nullptr;
+    size_t begin = 0, end = 0, chunk = 0, nChunks = 0;
+    std::atomic<size_t> next{0}, finished{0};
+    std::exception_ptr error;
+
+  public:
+    explicit ThreadPool(const ThreadPoolConfig &config);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    const ThreadPoolConfig &getConfig() const { return config; }
+    int getThreads() const { return nThreads; }
+
+    /**
+     * @brief Calls `body` on disjoint sub-ranges covering [begin, end). The
+     * range is split in at most one chunk per thread, each of at least
+     * `grain` iterations (the pool default if 0), so small ranges use fewer
+     * threads and ranges below the grain do not leave the calling thread.
+     */
+    void parallelFor(size_t begin, size_t end, size_t grain, const Body &body);
+
+  private:
+    void workerLoop(int id);
+    void runChunks();
+};
+
+} // namespace infini
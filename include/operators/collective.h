@@ -0,0 +1,45 @@
+#pragma once
+#include "core/communicator.h"
+#include "core/operator.h"
+
+namespace infini {
+/**
+ * @brief Sum the input over all the processes of a communicator. Every
+ * process gets the sum.
+ */
+class AllReduceSumObj : public OperatorObj {
+    Communicator comm;
+
+  public:
+    AllReduceSumObj(GraphObj *graph, Tensor input, Tensor output,
+                    Communicator comm);
+    OP_CLONE(AllReduceSumObj);
+    optional<vector<Shape>> inferShape(const TensorVec &inputs) override;
+
+    std::string toString() const override;
+    int numInputs() const override { return 1; }
+    int numOutputs() const override { return 1; }
+    const Communicator &getCommunicator() const { return comm; }
+};
+
+/**
+ * @brief Concatenate the inputs of all the processes of a communicator
+ * along `dim`, in rank order. Every process gets the whole tensor.
+ */
+class AllGatherObj : public OperatorObj {
+    Communicator comm;
+    int dim;
+
+  public:
+    AllGatherObj(GraphObj *graph, Tensor input, Tensor output,
+                 Communicator comm, int dim);
+    OP_CLONE(AllGatherObj);
+    optional<vector<Shape>> inferShape(const TensorVec &inputs) override;
+
+    std::string toString() const override;
+    int numInputs() const override { return 1; }
+    int numOutputs() const override { return 1; }
+    const Communicator &getCommunicator() const { return comm; }
+    int getDim() const { return dim; }
+};
+} // namespace infini
@@ -1,15 +1,18 @@
 #include "core/allocator.h"
 
 namespace infini {
-Allocator::Allocator(Runtime runtime) : runtime(runtime) {
+Allocator::Allocator(Runtime runtime, bool pages)
+    : runtime(runtime), pages(pages) {
     used = 0;
     peak = 0;
     ptr = nullptr;
+    capacity = 0;
+    materialized = false;
 
-    // 'alignment' defaults to sizeof(uint64_t), because it is the length of
-    // the longest data type currently supported by the DataType field of
-    // the tensor
-    alignment = sizeof(uint64_t);
+    // every offset is aligned like the base pointer given by the runtime, so
+    // that each tensor starts on its own cache line and vector loads of its
+    // first elements are aligned
+    alignment = RuntimeObj::alignment;
 }
 
 Allocator::~Allocator() {
@@ -19,7 +22,7 @@ Allocator::~Allocator() {
 }
 
 size_t Allocator::alloc(size_t size) {
-    IT_ASSERT(this->ptr == nullptr);
+    IT_ASSERT(!this->materialized);
     // pad the size to the multiple of alignment
     size = this->getAlignedSize(size);
 
@@ -31,32 +34,24 @@ size_t Allocator::alloc(size_t size) {
     // v[i]=(pos, sz) < (0, k) := (sz /= k and sz < k) or (sz = k and pos < 0)
     // v[i]=(pos, sz) < (0, k) := sz < k
     // v[i]=(pos, sz) >= (0, k) := sz >= k
-    auto i = frees.lower_bound(Block{0, size});
-    if (i != frees.end()) {
+    auto i = freesBySize.lower_bound(Block{0, size});
+    if (i != freesBySize.end()) {
         auto blk = *i;
         pos = blk.begin;
-        frees.erase(i);
+        eraseFree(blk);
 
         // still got some space available
-        if (blk.size < size) {
-            blk.begin += size;
-            blk.size -= size;
-            frees.insert(blk);
+        if (blk.size > size) {
+            insertFree(Block{blk.begin + size, blk.size - size});
         }
-
-    } else if (!frees.empty()) {
-        // extend the last free block
-        auto k = frees.begin();
-        for (auto i = frees.begin(); i != frees.end(); i++) {
-            if (k->begin < i->begin) {
-                k = i;
-            }
-        }
-        const auto blk = *k;
-        frees.erase(k);
-        pos = blk.begin;
-
-        peak = std::max(peak, pos + size - blk.size);
+    } else if (auto tail = freesByAddr.rbegin();
+               tail != freesByAddr.rend() &&
+               tail->first + tail->second == peak) {
+        // extend the free block at the end of the pool
+        pos = tail->first;
+        eraseFree(Block{tail->first, tail->second});
+
+        peak = pos + size;
     } else {
         // cannot fit in a free block
         // so we allocate a separate consecutive block
@@ -68,21 +63,70 @@ size_t Allocator::alloc(size_t size) {
 }
 
 void Allocator::free(size_t addr, size_t size) {
-    IT_ASSERT(this->ptr == nullptr);
+    IT_ASSERT(!this->materialized);
     size = getAlignedSize(size);
 
     used -= size;
 
-    frees.insert(Block{addr, size});
+    // coalesce with the adjacent free blocks, so that free space is not
+    // fragmented into blocks too small to be reused
+    Block blk{addr, size};
+    auto next = freesByAddr.lower_bound(addr);
+    if (next != freesByAddr.begin()) {
+        auto prev = std::prev(next);
+        IT_ASSERT(prev->first + prev->second <= addr, "Double free");
+        if (prev->first + prev->second == addr) {
+            blk.begin = prev->first;
+            blk.size += prev->second;
+            eraseFree(Block{prev->first, prev->second});
+        }
+    }
+    if (next != freesByAddr.end()) {
+        IT_ASSERT(addr + size <= next->first, "Double free");
+        if (addr + size == next->first) {
+            blk.size += next->second;
+            eraseFree(Block{next->first, next->second});
+        }
+    }
+    insertFree(blk);
+}
+
+void Allocator::insertFree(const Block &blk) {
+    freesBySize.insert(blk);
+    freesByAddr.emplace(blk.begin, blk.size);
+}
+
+void Allocator::eraseFree(const Block &blk) {
+    freesBySize.erase(blk);
+    freesByAddr.erase(blk.begin);
 }
 
 void *Allocator::getPtr() {
-    if (this->ptr == nullptr) {
-        this->ptr = runtime->alloc(this->peak);
+    if (this->ptr == nullptr || this->capacity < this->peak) {
+        if (this->ptr != nullptr) {
+            runtime->dealloc(this->ptr);
+        }
+        this->ptr = pages ? runtime->allocPages(this->peak)
+                          : runtime->alloc(this->peak);
+        this->capacity = this->peak;
     }
+    this->materialized = true;
     return this->ptr;
 }
 
+void Allocator::reset() {
+    used = 0;
+    peak = 0;
+    freesBySize.clear();
+    freesByAddr.clear();
+    materialized = false;
+}
+
+void Allocator::reserve(size_t size) {
+    IT_ASSERT(!this->materialized);
+    peak = std::max(peak, size);
+}
+
 size_t Allocator::getAlignedSize(size_t size) {
     return ((size - 1) / this->alignment + 1) * this->alignment;
 }
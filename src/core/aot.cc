@@ -0,0 +1,415 @@
+#include "core/aot.h"
+#include "operators/concat.h"
+#include "operators/element_wise.h"
+#include "operators/matmul.h"
+#include "operators/transpose.h"
+#include "operators/unary.h"
+#include <cmath>
+
+namespace infini {
+
+namespace {
+
+const char *cType(DataType dtype) {
+    if (dtype == DataType::Float32)
+        return "float";
+    if (dtype == DataType::UInt32)
+        return "uint32_t";
+    IT_TODO_HALT_MSG("Unsupported data type for AOT: " + dtype.toString());
+}
+
+// float literals are written in hexadecimal, so that they are exact
+string literal(float value) {
+    if (std::isnan(value))
+        return "std::numeric_limits<float>::quiet_NaN()";
+    if (std::isinf(value))
+        return string(value < 0 ? "-" : "") +
+               "std::numeric_limits<float>::infinity()";
+    std::ostringstream os;
+    os << std::hexfloat << value << 'f';
+    return os.str();
+}
+
+string literal(uint32_t value) { return std::to_string(value) + "u"; }
+
+vector<size_t> sizes(const Shape &dims) {
+    return vector<size_t>(dims.begin(), dims.end());
+}
+
+// `offset + i0 * strides[0] + i1 * strides[1] + ...` over the indices of
+// the loops opened by `Source::loops`, leaving out zero strides
+string address(const vector<size_t> &strides, size_t offset = 0) {
+    string ret = offset ? std::to_string(offset) : "";
+    for (size_t j = 0; j < strides.size(); ++j) {
+        if (strides[j] == 0)
+            continue;
+        if (!ret.empty())
+            ret += " + ";
+        ret += "i" + std::to_string(j);
+        if (strides[j] != 1)
+            ret += " * " + std::to_string(strides[j]);
+    }
+    return ret.empty() ? "0" : ret;
+}
+
+// the strides of a contiguous tensor of shape `dims`, 0 on dimensions of 1
+// so that a shape padded with ones reads it with broadcast
+vector<size_t> strides(const Shape &dims) {
+    vector<size_t> ret(dims.size());
+    for (size_t j = dims.size(), p = 1; j > 0; --j) {
+        ret[j - 1] = dims[j - 1] == 1 ? 0 : p;
+        p *= dims[j - 1];
+    }
+    return ret;
+}
+
+class Source {
+    std::ostringstream os;
+    int depth = 0;
+
+  public:
+    void line(const string &text) {
+        os << string(depth * 4, ' ') << text << '\n';
+    }
+    void open(const string &text) {
+        line(text + " {");
+        ++depth;
+    }
+    void close(int n = 1, const string &suffix = "") {
+        for (; n > 0; --n) {
+            --depth;
+            line(n > 1 ? "}" : "}" + suffix);
+        }
+    }
+    // opens one loop per dimension, with the indices i0, i1, ...
+    void loops(const vector<size_t> &dims) {
+        for (size_t j = 0; j < dims.size(); ++j) {
+            auto i = "i" + std::to_string(j);
+            open("for (size_t " + i + " = 0; " + i + " < " +
+                 std::to_string(dims[j]) + "; ++" + i + ")");
+        }
+    }
+    string str() const { return os.str(); }
+};
+
+class Emitter {
+    Source src;
+    // the op functions, before the entry which calls them
+    Source ops;
+    int nOps = 0, nWeights = 0;
+
+    void emitElementWise(const Operator &op, const string &t) {
+        static const std::map<OpType::underlying_t, const char *> symbols = {
+            {OpType::Add, "+"},
+            {OpType::Sub, "-"},
+            {OpType::Mul, "*"},
+            {OpType::Div, "/"}};
+        const auto shapeA = op->getInputs(0)->getDims();
+        const auto shapeB = op->getInputs(1)->getDims();
+        const auto shapeC = op->getOutput()->getDims();
+        const auto rank = shapeC.size();
+        Shape a(rank, 1), b(rank, 1);
+        std::copy(shapeA.begin(), shapeA.end(),
+                  a.begin() + (rank - shapeA.size()));
+        std::copy(shapeB.begin(), shapeB.end(),
+                  b.begin() + (rank - shapeB.size()));
+        auto dims = sizes(shapeC);
+        auto sA = strides(a), sB = strides(b), sC = strides(shapeC);
+        // without broadcast, one loop over all the elements
+        if (a == shapeC && b == shapeC) {
+            dims = {op->getOutput()->size()};
+            sA = sB = sC = {1};
+        }
+        ops.loops(dims);
+        ops.line("y0[" + address(sC) + "] = " + t + "(x0[" + address(sA) +
+                 "] " + symbols.at(op->getOpType().underlying()) + " x1[" +
+                 address(sB) + "]);");
+        ops.close(dims.size());
+    }
+
+    void emitClip(const Ref<ClipObj> &op, const string &t) {
+        auto value = string("v");
+        if (auto max = op->getMax())
+            value = "v > " + literal(*max) + " ? " + literal(*max) + " : " +
+                    value;
+        if (auto min = op->getMin())
+            value = "v < " + literal(*min) + " ? " + literal(*min) + " : " +
+                    value;
+        ops.loops({op->getOutput()->size()});
+        // the bounds are floats, so is the comparison
+        ops.line("const float v = static_cast<float>(x0[i0]);");
+        ops.line("y0[i0] = static_cast<" + t + ">(" + value + ");");
+        ops.close();
+    }
+
+    void emitTranspose(const Ref<TransposeObj> &op) {
+        const auto inDim = op->getInputs(0)->getDims();
+        const auto perm = op->getPermute();
+        vector<size_t> outStride(perm.size()), inStride(perm.size());
+        for (size_t j = perm.size(), p = 1, q = 1; j > 0; --j) {
+            outStride[perm[j - 1]] = p;
+            p *= inDim[perm[j - 1]];
+            inStride[j - 1] = q;
+            q *= inDim[j - 1];
+        }
+        ops.loops(sizes(inDim));
+        ops.line("y0[" + address(outStride) + "] = x0[" + address(inStride) +
+                 "];");
+        ops.close(inDim.size());
+    }
+
+    void emitConcat(const Ref<ConcatObj> &op) {
+        const auto dim = op->getDim();
+        const auto outDim = op->getOutput()->getDims();
+        size_t inner = 1, offset = 0;
+        for (size_t j = dim + 1; j < outDim.size(); ++j)
+            inner *= outDim[j];
+        // every input is a sequence of blocks, placed `outDim[dim] * inner`
+        // elements apart in the output
+        for (size_t i = 0; i < op->getInputs().size(); ++i) {
+            const auto input = op->getInputs(i);
+            const size_t block = input->getDims()[dim] * inner;
+            const size_t n = input->size() / std::max<size_t>(1, block);
+            ops.loops({n, block});
+            ops.line("y0[" + address({outDim[dim] * inner, 1}, offset) +
+                     "] = x" + std::to_string(i) + "[" + address({block, 1}) +
+                     "];");
+            ops.close(2);
+            offset += block;
+        }
+    }
+
+    void emitMatmul(const Ref<MatmulObj> &op, const string &t) {
+        const auto shapeA = op->getInputs(0)->getDims();
+        const auto shapeB = op->getInputs(1)->getDims();
+        const auto shapeC = op->getOutput()->getDims();
+        const auto rank = shapeC.size();
+        IT_ASSERT(shapeA.size() == rank && shapeB.size() == rank);
+        const size_t m = op->getM(), n = op->getN(), k = op->getK();
+        const size_t rowA = op->getTransA() ? 1 : n;
+        const size_t colA = op->getTransA() ? m : 1;
+
+        // the offsets of A and B for every batch, 0 on broadcast dims
+        size_t batch = 1;
+        for (size_t j = 0; j + 2 < rank; ++j)
+            batch *= shapeC[j];
+        vector<size_t> offsetA(batch), offsetB(batch);
+        for (size_t b = 0; b < batch; ++b) {
+            size_t pA = m * n, pB = n * k;
+            for (size_t j = rank - 2, rest = b; j > 0; --j) {
+                auto pos = rest % shapeC[j - 1];
+                rest /= shapeC[j - 1];
+                offsetA[b] += shapeA[j - 1] == 1 ? 0 : pos * pA;
+                offsetB[b] += shapeB[j - 1] == 1 ? 0 : pos * pB;
+                pA *= shapeA[j - 1];
+                pB *= shapeB[j - 1];
+            }
+        }
+        const auto table = [&](const string &name, const vector<size_t> &v) {
+            string values;
+            for (auto offset : v)
+                values += (values.empty() ? "" : ", ") + std::to_string(offset);
+            ops.line("static const size_t " + name + "[] = {" + values + "};");
+        };
+        string bA = "0", bB = "0";
+        if (batch > 1) {
+            table("offsetA", offsetA);
+            table("offsetB", offsetB);
+            bA = "offsetA[i0]";
+            bB = "offsetB[i0]";
+        }
+
+        // a transposed B is packed into the workspace as n x k matrices, so
+        // that the inner loop reads contiguous rows
+        string B = "x1";
+        if (op->getTransB()) {
+            const size_t matrices = op->getInputs(1)->size() / (n * k);
+            ops.loops({matrices, n, k});
+            ops.line("w[" + address({n * k, k, 1}) + "] = x1[" +
+                     address({n * k, 1, n}) + "];");
+            ops.close(3);
+            B = "w";
+        }
+
+        ops.loops({batch, m});
+        ops.line("const " + t + " *a = x0 + " + bA + " + i1 * " +
+                 std::to_string(rowA) + ";");
+        ops.line("const " + t + " *b = " + B + " + " + bB + ";");
+        ops.line(t + " *c = y0 + (i0 * " + std::to_string(m) + " + i1) * " +
+                 std::to_string(k) + ";");
+        ops.open("for (size_t j = 0; j < " + std::to_string(k) + "; ++j)");
+        ops.line("c[j] = " + t + "(0);");
+        ops.close();
+        ops.open("for (size_t p = 0; p < " + std::to_string(n) + "; ++p)");
+        ops.line("const " + t + " x = a[p * " + std::to_string(colA) + "];");
+        ops.line("const " + t + " *row = b + p * " + std::to_string(k) + ";");
+        ops.open("for (size_t j = 0; j < " + std::to_string(k) + "; ++j)");
+        ops.line("c[j] += x * row[j];");
+        ops.close(4);
+    }
+
+    // the function of an op, named `op<index>`, taking its inputs x0, x1,
+    // ..., its outputs y0, ... and its workspace w
+    string emitOp(const Operator &op) {
+        const string t = cType(op->getDType());
+        auto name = "op" + std::to_string(nOps++);
+        string params;
+        for (size_t i = 0; i < op->getInputs().size(); ++i)
+            params += "const " + t + " *__restrict x" + std::to_string(i) +
+                      ", ";
+        for (size_t i = 0; i < op->getOutputs().size(); ++i)
+            params += t + " *__restrict y" + std::to_string(i) + ", ";
+        if (op->getWorkspaceSize() > 0)
+            params += t + " *__restrict w, ";
+        params.resize(params.size() - 2);
+
+        ops.line("// " + op->toString());
+        ops.open("void " + name + "(" + params + ")");
+        switch (op->getOpType().underlying()) {
+        case OpType::Add:
+        case OpType::Sub:
+        case OpType::Mul:
+        case OpType::Div:
+            emitElementWise(op, t);
+            break;
+        case OpType::Relu:
+            ops.loops({op->getOutput()->size()});
+            ops.line("y0[i0] = " + t + "(0) < x0[i0] ? x0[i0] : " + t +
+                     "(0);");
+            ops.close();
+            break;
+        case OpType::Clip:
+            emitClip(as<ClipObj>(op), t);
+            break;
+        case OpType::Transpose:
+            emitTranspose(as<TransposeObj>(op));
+            break;
+        case OpType::Concat:
+            emitConcat(as<ConcatObj>(op));
+            break;
+        case OpType::MatMul:
+            emitMatmul(as<MatmulObj>(op), t);
+            break;
+        default:
+            IT_TODO_HALT_MSG(string("Unsupported op for AOT: ") +
+                             op->getOpType().toString());
+        }
+        ops.close();
+        ops.line("");
+        return name;
+    }
+
+    template <typename T> string emitWeight(const Tensor &tensor) {
+        auto name = "weight" + std::to_string(nWeights++);
+        auto data = tensor->getRawDataPtr<const T *>();
+        IT_ASSERT(data != nullptr, "The weights of the graph hold no data");
+        src.open("alignas(64) const " + string(cType(tensor->getDType())) +
+                 " " + name + "[] =");
+        for (size_t i = 0; i < tensor->size(); i += 4) {
+            string values;
+            for (size_t j = i; j < std::min(i + 4, tensor->size()); ++j)
+                values += (j > i ? " " : "") + literal(data[j]) + ",";
+            src.line(values);
+        }
+        src.close(1, ";");
+        return name;
+    }
+
+  public:
+    string emit(const Graph &graph, const string &name) {
+        auto layout = graph->getMemoryLayout();
+        TensorVec inputs, outputs = graph->getOutputs();
+        for (const auto &t : graph->getInputs())
+            if (!t->isWeight())
+                inputs.emplace_back(t);
+
+        src.line("// Generated by InfiniTensor, do not edit.");
+        for (const auto &[list, title] : {pair{&inputs, "inputs"},
+                                          pair{&outputs, "outputs"}})
+            for (size_t i = 0; i < list->size(); ++i)
+                src.line("// " + string(title) + "[" + std::to_string(i) +
+                         "]: " + (*list)[i]->getDType().toString() + " " +
+                         vecToString((*list)[i]->getDims()));
+        src.line("#include <cstddef>");
+        src.line("#include <cstdint>");
+        src.line("#include <cstring>");
+        src.line("#include <limits>");
+        src.line("");
+        src.line("namespace {");
+        src.line("");
+        src.line("alignas(64) unsigned char arena[" +
+                 std::to_string(std::max<size_t>(1, layout.peak)) + "];");
+        src.line("");
+
+        // the expression of the data of every tensor, a pointer which is
+        // cast to the type of the tensor
+        std::unordered_map<TensorObj *, string> data;
+        for (size_t i = 0; i < inputs.size(); ++i)
+            data[inputs[i].get()] = "inputs[" + std::to_string(i) + "]";
+        for (size_t i = 0; i < outputs.size(); ++i)
+            if (outputs[i]->getSource())
+                data[outputs[i].get()] = "outputs[" + std::to_string(i) + "]";
+        for (const auto &t : graph->getTensors()) {
+            if (data.count(t.get()))
+                continue;
+            if (t->isWeight()) {
+                data[t.get()] = t->getDType() == DataType::Float32
+                                    ? emitWeight<float>(t)
+                                    : emitWeight<uint32_t>(t);
+            } else {
+                IT_ASSERT(layout.offsets.count(t.get()),
+                          "The graph is not allocated");
+                data[t.get()] = "arena + " +
+                                std::to_string(layout.offsets.at(t.get()));
+            }
+        }
+
+        Source calls;
+        for (const auto &op : graph->getOperators()) {
+            const string t = cType(op->getDType());
+            auto fn = emitOp(op);
+            vector<string> args;
+            for (const auto &input : op->getInputs())
+                args.emplace_back("reinterpret_cast<const " + t + " *>(" +
+                                  data.at(input.get()) + ")");
+            for (const auto &output : op->getOutputs())
+                args.emplace_back("reinterpret_cast<" + t + " *>(" +
+                                  data.at(output.get()) + ")");
+            if (op->getWorkspaceSize() > 0)
+                args.emplace_back(
+                    "reinterpret_cast<" + t + " *>(arena + " +
+                    std::to_string(layout.workspaceOffsets.at(op.get())) +
+                    ")");
+            // one argument per line, aligned after the parenthesis
+            const string indent(fn.size() + 1, ' ');
+            for (size_t i = 0; i < args.size(); ++i)
+                calls.line((i ? indent : fn + "(") + args[i] +
+                           (i + 1 < args.size() ? "," : ");"));
+        }
+        // outputs which are not computed, i.e. graph inputs or weights
+        for (size_t i = 0; i < outputs.size(); ++i)
+            if (!outputs[i]->getSource())
+                calls.line("std::memcpy(outputs[" + std::to_string(i) +
+                           "], " + data.at(outputs[i].get()) + ", " +
+                           std::to_string(outputs[i]->getBytes()) + ");");
+
+        std::ostringstream os;
+        os << src.str() << '\n'
+           << ops.str() << "} // namespace\n\n"
+           << "extern \"C\" void " << name
+           << "(const void *const *inputs, void *const *outputs) {\n";
+        std::istringstream body(calls.str());
+        for (string line; std::getline(body, line);)
+            os << "    " << line << '\n';
+        os << "}\n";
+        return os.str();
+    }
+};
+
+} // namespace
+
+string emitCpp(const Graph &graph, const string &name) {
+    return Emitter().emit(graph, name);
+}
+
+} // namespace infini
@@ -0,0 +1,132 @@
+#include "core/batcher.h"
+#include "core/plan.h"
+
+namespace infini {
+
+Batcher::Batcher(Runtime runtime, Builder builder, BatcherConfig config)
+    : runtime(std::move(runtime)), builder(std::move(builder)),
+      config(config) {
+    IT_ASSERT(config.maxBatch >= 1);
+    thread = std::thread([this] { loop(); });
+}
+
+Batcher::~Batcher() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stop = true;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+std::future<Batcher::Buffers> Batcher::submit(Buffers inputs) {
+    auto request = new Request{std::move(inputs), {}, nullptr};
+    auto future = request->promise.get_future();
+    request->next = head.load(std::memory_order_relaxed);
+    while (!head.compare_exchange_weak(request->next, request))
+        ;
+    nRequests++;
+    // only take the lock when the batching thread may be waiting
+    if (sleeping) {
+        { std::lock_guard<std::mutex> guard(lock); }
+        wake.notify_one();
+    }
+    return future;
+}
+
+void Batcher::drain(std::deque<Request *> &pending) {
+    auto list = head.exchange(nullptr);
+    vector<Request *> reversed;
+    for (; list; list = list->next)
+        reversed.emplace_back(list);
+    pending.insert(pending.end(), reversed.rbegin(), reversed.rend());
+}
+
+void Batcher::loop() {
+    std::deque<Request *> pending;
+    // waits until a request arrives, the deadline passes or stop is set
+    const auto waitUntil = [this](auto deadline) {
+        std::unique_lock<std::mutex> guard(lock);
+        sleeping = true;
+        const auto ready = [this] { return stop || head != nullptr; };
+        if (deadline)
+            wake.wait_until(guard, *deadline, ready);
+        else
+            wake.wait(guard, ready);
+        sleeping = false;
+    };
+
+    while (true) {
+        drain(pending);
+        if (pending.empty()) {
+            if (stop)
+                return;
+            waitUntil(std::optional<std::chrono::steady_clock::time_point>{});
+            continue;
+        }
+        // give the first request up to `maxDelay` to be joined by others
+        auto deadline = std::chrono::steady_clock::now() + config.maxDelay;
+        while (pending.size() < config.maxBatch && !stop &&
+               std::chrono::steady_clock::now() < deadline) {
+            waitUntil(std::optional{deadline});
+            drain(pending);
+        }
+        auto n = std::min(pending.size(), config.maxBatch);
+        vector<Request *> batch(pending.begin(), pending.begin() + n);
+        pending.erase(pending.begin(), pending.begin() + n);
+        runBatch(batch);
+        for (auto request : batch)
+            delete request;
+    }
+}
+
+Batcher::Entry &Batcher::getEntry(size_t batch) {
+    auto it = entries.find(batch);
+    if (it == entries.end()) {
+        auto batched = builder(batch);
+        auto plan = runtime->compile(batched.graph);
+        it = entries.emplace(batch, Entry{batched, plan}).first;
+    }
+    return it->second;
+}
+
+void Batcher::runBatch(vector<Request *> &batch) {
+    const auto n = batch.size();
+    try {
+        auto &entry = getEntry(n);
+        const auto &inputs = entry.batched.inputs;
+        const auto &outputs = entry.batched.outputs;
+        // concatenate the inputs along the batch axis
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            IT_ASSERT(inputs[i]->getDims()[0] == (int)n);
+            auto bytes = inputs[i]->getBytes() / n;
+            auto dst = inputs[i]->getRawDataPtr<uint8_t *>();
+            for (size_t k = 0; k < n; ++k) {
+                const auto &buffer = batch[k]->inputs.at(i);
+                IT_ASSERT(buffer.size() == bytes,
+                          "Request input " + std::to_string(i) + " has " +
+                              std::to_string(buffer.size()) +
+                              " bytes, expected " + std::to_string(bytes));
+                std::memcpy(dst + k * bytes, buffer.data(), bytes);
+            }
+        }
+        runtime->run(entry.plan);
+        nBatches++;
+        // scatter the outputs back to the requests
+        for (size_t k = 0; k < n; ++k) {
+            Buffers results;
+            for (auto &output : outputs) {
+                auto bytes = output->getBytes() / n;
+                auto src = output->getRawDataPtr<uint8_t *>() + k * bytes;
+                results.emplace_back(src, src + bytes);
+            }
+            batch[k]->promise.set_value(std::move(results));
+        }
+    } catch (...) {
+        auto error = std::current_exception();
+        for (auto request : batch)
+            request->promise.set_exception(error);
+    }
+}
+
+} // namespace infini
@@ -0,0 +1,277 @@
+#include "core/communicator.h"
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sched.h>
+#include <set>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+extern char **environ;
+
+namespace infini {
+
+// the start of the segment
+struct Header {
+    // ranks arrived at the current barrier, and barriers passed so far
+    std::atomic<uint32_t> arrived;
+    std::atomic<uint32_t> generation;
+    std::atomic<uint32_t> aborted;
+};
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+              "Barriers need lock-free atomics to work across processes");
+
+// the header takes one cache line, and so does every slot
+static constexpr size_t lineSize = 64;
+
+static size_t roundUp(size_t bytes) {
+    return (bytes + lineSize - 1) / lineSize * lineSize;
+}
+
+size_t CommunicatorObj::getSegmentSize(int worldSize, size_t capacity) {
+    return lineSize + roundUp(capacity) * (worldSize + 1);
+}
+
+// maps the segment `name`, created if needed
+static void *mapSegment(const string &name, size_t size) {
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0600);
+    IT_ASSERT(fd >= 0, "Cannot open the shared memory segment " + name);
+    struct stat st;
+    // a new segment is empty, filled with zeros once truncated
+    if (fstat(fd, &st) != 0 || (size_t(st.st_size) < size &&
+                                ftruncate(fd, off_t(size)) != 0)) {
+        close(fd);
+        IT_TODO_HALT_MSG("Cannot size the shared memory segment " + name);
+    }
+    auto ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    IT_ASSERT(ptr != MAP_FAILED, "Cannot map the shared memory segment " +
+                                     name);
+    return ptr;
+}
+
+CommunicatorObj::CommunicatorObj(const string &name, int worldSize, int rank,
+                                 size_t capacity)
+    : worldSize(worldSize), rank(rank), capacity(roundUp(capacity)),
+      name(name), segmentSize(getSegmentSize(worldSize, capacity)) {
+    IT_ASSERT(worldSize > 0 && rank >= 0 && rank < worldSize,
+              "Bad rank " + std::to_string(rank) + " of " +
+                  std::to_string(worldSize));
+    IT_ASSERT(capacity > 0);
+    segment = mapSegment(name, segmentSize);
+}
+
+CommunicatorObj::~CommunicatorObj() { munmap(segment, segmentSize); }
+
+Ref<CommunicatorObj> CommunicatorObj::fromEnvironment() {
+    auto name = std::getenv("INFINI_SHM");
+    auto worldSize = std::getenv("INFINI_WORLD_SIZE");
+    auto rank = std::getenv("INFINI_RANK");
+    auto capacity = std::getenv("INFINI_SHM_CAPACITY");
+    if (!name || !worldSize || !rank)
+        return nullptr;
+    return make_ref<CommunicatorObj>(
+        name, std::atoi(worldSize), std::atoi(rank),
+        capacity ? std::strtoull(capacity, nullptr, 10) : defaultCapacity);
+}
+
+char *CommunicatorObj::getResult() const {
+    return static_cast<char *>(segment) + lineSize;
+}
+
+char *CommunicatorObj::getSlot(int i) const {
+    return getResult() + capacity * (i + 1);
+}
+
+void CommunicatorObj::barrier() {
+    auto header = static_cast<Header *>(segment);
+    auto generation = header->generation.load(std::memory_order_acquire);
+    if (header->arrived.fetch_add(1, std::memory_order_acq_rel) + 1 ==
+        uint32_t(worldSize)) {
+        header->arrived.store(0, std::memory_order_relaxed);
+        header->generation.fetch_add(1, std::memory_order_release);
+        return;
+    }
+    while (header->generation.load(std::memory_order_acquire) == generation) {
+        IT_ASSERT(!header->aborted.load(std::memory_order_relaxed),
+                  "A process of the group failed");
+        sched_yield();
+    }
+}
+
+template <typename T>
+static void sum(T *result, char *const *slots, int n, size_t begin,
+                size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+        T value = reinterpret_cast<const T *>(slots[0])[i];
+        for (int r = 1; r < n; ++r)
+            value += reinterpret_cast<const T *>(slots[r])[i];
+        result[i] = value;
+    }
+}
+
+void CommunicatorObj::allReduceSum(void *data, size_t n, DataType dtype) {
+    const auto elementSize = dtype.getSize();
+    const auto chunk = capacity / elementSize;
+    vector<char *> slots(worldSize);
+    for (int r = 0; r < worldSize; ++r)
+        slots[r] = getSlot(r);
+    auto bytes = static_cast<char *>(data);
+    for (size_t offset = 0; offset < n; offset += chunk) {
+        auto count = std::min(chunk, n - offset);
+        std::memcpy(getSlot(rank), bytes + offset * elementSize,
+                    count * elementSize);
+        barrier();
+        // every rank sums its share of the chunk
+        auto begin = count * rank / worldSize,
+             end = count * (rank + 1) / worldSize;
+        if (dtype == DataType::Float32)
+            sum(reinterpret_cast<float *>(getResult()), slots.data(),
+                worldSize, begin, end);
+        else if (dtype == DataType::UInt32)
+            sum(reinterpret_cast<uint32_t *>(getResult()), slots.data(),
+                worldSize, begin, end);
+        else
+            IT_TODO_HALT_MSG("AllReduceSum of " + dtype.toString());
+        barrier();
+        // the next chunk overwrites the result only after the next barrier,
+        // which every rank reaches once it has copied this one
+        std::memcpy(bytes + offset * elementSize, getResult(),
+                    count * elementSize);
+    }
+}
+
+void CommunicatorObj::allGather(const void *input, void *output,
+                                size_t bytes) {
+    auto in = static_cast<const char *>(input);
+    auto out = static_cast<char *>(output);
+    for (size_t offset = 0; offset < bytes; offset += capacity) {
+        auto count = std::min(capacity, bytes - offset);
+        std::memcpy(getSlot(rank), in + offset, count);
+        barrier();
+        for (int r = 0; r < worldSize; ++r)
+            std::memcpy(out + r * bytes + offset, getSlot(r), count);
+        barrier();
+    }
+}
+
+string CommunicatorObj::toString() const {
+    return "Communicator(" + name + ", rank " + std::to_string(rank) +
+           " of " + std::to_string(worldSize) + ")";
+}
+
+// the CPUs of every NUMA node, empty if the topology is unknown
+static vector<cpu_set_t> numaNodes() {
+    vector<cpu_set_t> ret;
+    for (int node = 0;; ++node) {
+        std::ifstream in("/sys/devices/system/node/node" +
+                         std::to_string(node) + "/cpulist");
+        string list;
+        if (!std::getline(in, list))
+            break;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        // e.g. 0-3,8-11
+        std::istringstream ranges(list);
+        for (string range; std::getline(ranges, range, ',');) {
+            auto dash = range.find('-');
+            int first = std::stoi(range.substr(0, dash));
+            int last = dash == string::npos ? first
+                                            : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu)
+                CPU_SET(cpu, &set);
+        }
+        ret.emplace_back(set);
+    }
+    return ret;
+}
+
+bool launchWorkers(int worldSize, const vector<string> &argv, bool bindNuma,
+                   size_t capacity) {
+    IT_ASSERT(worldSize > 0 && !argv.empty());
+    static std::atomic<int> groups{0};
+    const auto name = "/infini-" + std::to_string(getpid()) + "-" +
+                      std::to_string(groups++);
+    shm_unlink(name.c_str());
+    auto size = CommunicatorObj::getSegmentSize(worldSize, capacity);
+    auto segment = mapSegment(name, size);
+
+    const auto nodes = bindNuma ? numaNodes() : vector<cpu_set_t>();
+    // everything the children need is prepared before forking
+    vector<char *> args;
+    for (const auto &arg : argv)
+        args.emplace_back(const_cast<char *>(arg.c_str()));
+    args.emplace_back(nullptr);
+    vector<string> common = {"INFINI_SHM=" + name,
+                             "INFINI_SHM_CAPACITY=" + std::to_string(capacity),
+                             "INFINI_WORLD_SIZE=" + std::to_string(worldSize)};
+    vector<vector<string>> variables(worldSize, common);
+    vector<vector<char *>> environments(worldSize);
+    for (int rank = 0; rank < worldSize; ++rank) {
+        variables[rank].emplace_back("INFINI_RANK=" + std::to_string(rank));
+        for (char **env = environ; *env; ++env) {
+            string variable(*env);
+            variable = variable.substr(0, variable.find('='));
+            if (variable != "INFINI_SHM" && variable != "INFINI_RANK" &&
+                variable != "INFINI_SHM_CAPACITY" &&
+                variable != "INFINI_WORLD_SIZE")
+                environments[rank].emplace_back(*env);
+        }
+        for (auto &variable : variables[rank])
+            environments[rank].emplace_back(variable.data());
+        environments[rank].emplace_back(nullptr);
+    }
+
+    vector<pid_t> workers;
+    bool ok = true;
+    for (int rank = 0; rank < worldSize && ok; ++rank) {
+        auto pid = fork();
+        if (pid == 0) {
+            if (!nodes.empty())
+                sched_setaffinity(0, sizeof(cpu_set_t),
+                                  &nodes[rank % nodes.size()]);
+            execve(args[0], args.data(), environments[rank].data());
+            _exit(127);
+        }
+        if (pid < 0)
+            ok = false;
+        else
+            workers.emplace_back(pid);
+    }
+    auto header = static_cast<Header *>(segment);
+    std::set<pid_t> running(workers.begin(), workers.end());
+    while (!running.empty()) {
+        // the others would wait forever for a dead peer
+        if (!ok)
+            header->aborted.store(1);
+        // only reap the workers: other children belong to the application
+        bool reaped = false;
+        for (auto it = running.begin(); it != running.end();) {
+            int status = 0;
+            auto pid = waitpid(*it, &status, WNOHANG);
+            if (pid == 0 || (pid < 0 && errno == EINTR)) {
+                ++it;
+                continue;
+            }
+            if (pid < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+                ok = false;
+            it = running.erase(it);
+            reaped = true;
+        }
+        if (!reaped && !running.empty())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    munmap(segment, size);
+    shm_unlink(name.c_str());
+    return ok;
+}
+
+} // namespace infini
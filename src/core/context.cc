@@ -0,0 +1,111 @@
+#include "core/context.h"
+#include "core/graph.h"
+
+namespace infini {
+
+ContextObj::ContextObj(const Plan &plan)
+    : plan(plan), runtime(plan->getGraph()->getRuntime()), arena(nullptr),
+      data(plan->getData()) {
+    IT_ASSERT(plan->isRelocatable(),
+              "Plans with unprepared kernels cannot run in a context");
+    if (auto size = plan->getArenaSize()) {
+        arena = runtime->alloc(size);
+        std::memcpy(arena, plan->getArena(), size);
+    }
+    for (auto &ptr : data)
+        ptr = relocate(ptr);
+}
+
+ContextObj::~ContextObj() {
+    if (arena != nullptr)
+        runtime->dealloc(arena);
+}
+
+string ContextObj::toString() const {
+    std::ostringstream oss;
+    oss << "Context " << guid << " of plan " << plan->getGuid() << ", arena "
+        << arena;
+    return oss.str();
+}
+
+void ContextObj::setData(
+    const Tensor &tensor,
+    const std::function<void(void *, size_t, DataType)> &generator) const {
+    generator(getRawDataPtr<void *>(tensor), tensor->size(),
+              tensor->getDType());
+}
+
+void ContextObj::bind(const Tensor &tensor, void *ptr) {
+    IT_ASSERT(reinterpret_cast<uintptr_t>(ptr) % RuntimeObj::alignment == 0,
+              "Bound memory must be aligned to the runtime alignment");
+    for (auto slot : plan->getSlots(tensor))
+        data[slot] = ptr;
+}
+
+void *ContextObj::relocate(void *ptr) const {
+    auto base = reinterpret_cast<char *>(plan->getArena());
+    auto p = reinterpret_cast<char *>(ptr);
+    // pointers outside of the arena of the graph are shared
+    if (p < base || p >= base + plan->getArenaSize())
+        return ptr;
+    return reinterpret_cast<char *>(arena) + (p - base);
+}
+
+Pipeline::Pipeline(const Plan &plan, size_t depth)
+    : runtime(plan->getGraph()->getRuntime()) {
+    IT_ASSERT(depth >= 1);
+    for (size_t i = 0; i < depth; ++i)
+        contexts.emplace_back(make_ref<ContextObj>(plan));
+    idle = contexts;
+}
+
+Pipeline::~Pipeline() { wait(); }
+
+std::future<void> Pipeline::submit(const Stage &prepare, Stage finish) {
+    Context context;
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        freed.wait(guard, [this] { return !idle.empty(); });
+        context = idle.back();
+        idle.pop_back();
+    }
+    // notify under the lock: once it is released `wait` may return and the
+    // pipeline be destroyed
+    const auto release = [this, context] {
+        std::lock_guard<std::mutex> guard(lock);
+        idle.emplace_back(context);
+        freed.notify_all();
+    };
+    try {
+        prepare(*context);
+    } catch (...) {
+        release();
+        throw;
+    }
+
+    auto promise = std::make_shared<std::promise<void>>();
+    auto future = promise->get_future();
+    runtime->runAsync(context, [context, finish = std::move(finish), promise,
+                                release](std::exception_ptr error) {
+        if (!error && finish) {
+            try {
+                finish(*context);
+            } catch (...) {
+                error = std::current_exception();
+            }
+        }
+        release();
+        if (error)
+            promise->set_exception(error);
+        else
+            promise->set_value();
+    });
+    return future;
+}
+
+void Pipeline::wait() {
+    std::unique_lock<std::mutex> guard(lock);
+    freed.wait(guard, [this] { return idle.size() == contexts.size(); });
+}
+
+} // namespace infini
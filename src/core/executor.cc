@@ -0,0 +1,45 @@
+#include "core/executor.h"
+
+namespace infini {
+
+Executor::Executor()
+    : state(std::make_shared<State>()), thread(loop, state) {}
+
+Executor::~Executor() {
+    {
+        std::lock_guard<std::mutex> guard(state->lock);
+        state->stop = true;
+    }
+    state->wake.notify_one();
+    if (thread.get_id() == std::this_thread::get_id())
+        thread.detach();
+    else
+        thread.join();
+}
+
+void Executor::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> guard(state->lock);
+        IT_ASSERT(!state->stop, "Executor has been stopped");
+        state->tasks.emplace_back(std::move(task));
+    }
+    state->wake.notify_one();
+}
+
+void Executor::loop(std::shared_ptr<State> state) {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> guard(state->lock);
+            state->wake.wait(
+                guard, [&] { return state->stop || !state->tasks.empty(); });
+            if (state->tasks.empty())
+                return;
+            task = std::move(state->tasks.front());
+            state->tasks.pop_front();
+        }
+        task();
+    }
+}
+
+} // namespace infini
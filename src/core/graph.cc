@@ -1,6 +1,7 @@
 #include "core/graph.h"
 #include "core/blob.h"
 #include "core/common.h"
+#include "core/kernel.h"
 #include "core/object.h"
 #include "core/op_type.h"
 #include "core/ref.h"
@@ -8,17 +9,18 @@
 #include "core/tensor.h"
 #include "operators/matmul.h"
 #include "operators/transpose.h"
+#include "utils/operator_utils.h"
 #include <algorithm>
 #include <cstdio>
+#include <cstring>
 #include <memory>
+#include <numeric>
 #include <unordered_map>
 #include <utility>
 
 namespace infini {
 
 void GraphObj::addOperatorAndConnect(const Operator &op) {
-    sorted = false;
-    ops.push_back(op);
     for (auto &input : op->getInputs()) {
         if (input) {
             input->addTarget(op);
@@ -37,6 +39,45 @@ void GraphObj::addOperatorAndConnect(const Operator &op) {
             }
         }
     }
+    if (sorted)
+        sorted = insertSorted(op);
+    else
+        ops.push_back(op);
+}
+
+bool GraphObj::insertSorted(const Operator &op) {
+    // producers of the inputs and consumers of the outputs of the new op
+    vector<OperatorObj *> preds, succs;
+    for (auto &input : op->getInputs())
+        if (input)
+            if (auto pred = input->getSource(); pred && pred != op)
+                preds.emplace_back(pred.get());
+    for (auto &output : op->getOutputs())
+        if (output)
+            for (auto &succ : output->getTargets())
+                if (succ != op)
+                    succs.emplace_back(succ.get());
+
+    const auto contains = [](const auto &vec, auto x) {
+        return std::find(vec.begin(), vec.end(), x) != vec.end();
+    };
+    size_t lastPred = 0, firstSucc = ops.size();
+    for (size_t i = 0; i < ops.size(); ++i) {
+        auto ptr = ops[i].get();
+        if (contains(preds, ptr))
+            lastPred = i + 1;
+        if (firstSucc == ops.size() && contains(succs, ptr))
+            firstSucc = i;
+    }
+    if (firstSucc == ops.size()) {
+        // nobody consumes the outputs yet, appending keeps the order valid
+        ops.push_back(op);
+        return true;
+    }
+    // place the op right before its first consumer, which is only valid when
+    // every producer has already been scheduled
+    ops.insert(ops.begin() + firstSucc, op);
+    return lastPred <= firstSucc;
 }
 
 string GraphObj::toString() const {
@@ -64,30 +105,61 @@ bool GraphObj::topo_sort() {
     if (this->sorted) {
         return true;
     }
-    std::vector<Operator> sorted;
-    std::unordered_set<OperatorObj *> flags;
-    sorted.reserve(ops.size());
-    flags.reserve(ops.size());
-    while (sorted.size() < ops.size()) {
-        // Any node is move to sorted in this loop.
-        auto modified = false;
-        for (auto const &op : ops) {
-            if (auto const &inputs = op->getInputs();
-                flags.find(op.get()) == flags.end() &&
-                std::all_of(inputs.begin(), inputs.end(),
-                            [&flags](auto const &input) {
-                                auto ptr = input->getSource().get();
-                                return !ptr || flags.find(ptr) != flags.end();
-                            })) {
-                modified = true;
-                sorted.emplace_back(op);
-                flags.insert(op.get());
+    // Kahn's algorithm: an op becomes ready once every op producing one of
+    // its inputs has been emitted, which takes O(V + E) time.
+    const auto n = ops.size();
+    std::unordered_map<OperatorObj *, size_t> index;
+    index.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        index.emplace(ops[i].get(), i);
+    }
+    vector<size_t> indegree(n, 0), mark(n, n);
+    vector<vector<size_t>> succs(n);
+    for (size_t i = 0; i < n; ++i) {
+        for (auto const &input : ops[i]->getInputs()) {
+            auto src = input->getSource();
+            if (!src) {
+                continue;
+            }
+            auto it = index.find(src.get());
+            if (it == index.end()) {
+                // produced by an op that is not in this graph
+                return false;
+            }
+            // an op reading several outputs of the same producer only
+            // depends on it once
+            if (auto p = it->second; mark[p] != i) {
+                mark[p] = i;
+                succs[p].emplace_back(i);
+                indegree[i]++;
             }
         }
-        if (!modified) {
-            return false;
+    }
+
+    // the result vector doubles as the FIFO queue of ready ops
+    vector<size_t> order;
+    order.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        if (indegree[i] == 0) {
+            order.emplace_back(i);
         }
     }
+    for (size_t head = 0; head < order.size(); ++head) {
+        for (auto s : succs[order[head]]) {
+            if (--indegree[s] == 0) {
+                order.emplace_back(s);
+            }
+        }
+    }
+    if (order.size() < n) {
+        return false;
+    }
+
+    std::vector<Operator> sorted;
+    sorted.reserve(n);
+    for (auto i : order) {
+        sorted.emplace_back(std::move(ops[i]));
+    }
     this->ops = std::move(sorted);
     return this->sorted = true;
 }
@@ -275,70 +347,388 @@ void GraphObj::shape_infer() {
     }
 }
 
-void GraphObj::dataMalloc() {
+void GraphObj::dataMalloc() { allocate(nullptr); }
+
+void GraphObj::dataMalloc(const MemoryLayout &layout) { allocate(&layout); }
+
+void GraphObj::allocate(const MemoryLayout *layout) {
     // topological sorting first
     IT_ASSERT(topo_sort() == true);
 
+    // the graph may have changed, so cached layouts are stale
+    layouts.clear();
+    boundKey.clear();
+
+    // weights are never released, so they are placed one after another in
+    // their own pool; the offsets are the same when the graph is allocated
+    // again, so the pool and its content are kept. Weights pointing to
+    // external memory, e.g. a mapped model file, stay there.
+    std::unordered_map<TensorObj *, size_t> weightOff;
+    protectWeights(false);
+    weightAllocator.reset();
+    for (auto &t : getTensors()) {
+        if (t->isWeight() && !(t->data && t->data->isExternal())) {
+            IT_ASSERT(!t->getSource(), "Weights must be graph inputs");
+            weightOff[t.get()] = weightAllocator.alloc(t->getBytes());
+        }
+    }
+    auto weights = reinterpret_cast<char *>(weightAllocator.getPtr());
+    for (auto &[t, offset] : weightOff) {
+        t->setDataBlob(make_ref<BlobObj>(runtime, weights + offset));
+    }
+
+    if (layout) {
+        for (const auto &t : tensors) {
+            IT_ASSERT(!t->inArena() ||
+                          t->getBytes() <= layout->bytes.at(t.get()),
+                      "The layout does not fit the tensors");
+        }
+        for (const auto &op : ops) {
+            auto it = layout->workspaceBytes.find(op.get());
+            IT_ASSERT(getWorkspaceSize(op) <=
+                          (it == layout->workspaceBytes.end() ? 0 : it->second),
+                      "The layout does not fit the workspaces");
+        }
+        plannedStrategy = layout->strategy;
+        allocator.reset();
+        allocator.reserve(layout->peak);
+        bindMemory(*layout);
+    } else {
+        bindMemory(planMemory());
+    }
+    boundArena = allocator.getPtr();
+
+    // print memory usage
+    std::cout << "Memory plan: " << infini::toString(plannedStrategy)
+              << ", peak memory: " << getArenaSize()
+              << ", weights: " << getWeightsSize() << std::endl;
+}
+
+GraphObj::MemoryLayout GraphObj::getMemoryLayout() const {
+    auto arena = reinterpret_cast<const char *>(boundArena);
+    IT_ASSERT(arena != nullptr, "The graph is not allocated");
+    MemoryLayout layout;
+    for (const auto &t : tensors) {
+        if (t->inArena()) {
+            layout.offsets[t.get()] = t->getRawDataPtr<const char *>() - arena;
+            layout.bytes[t.get()] = t->getBytes();
+        }
+    }
+    for (const auto &op : ops) {
+        if (op->getWorkspaceSize() > 0) {
+            layout.workspaceOffsets[op.get()] =
+                reinterpret_cast<const char *>(op->getWorkspace()) - arena;
+            layout.workspaceBytes[op.get()] = op->getWorkspaceSize();
+        }
+    }
+    layout.peak = getArenaSize();
+    layout.strategy = plannedStrategy;
+    return layout;
+}
+
+void GraphObj::setBound(const Tensor &tensor, bool bound) {
+    IT_ASSERT(std::find(tensors.begin(), tensors.end(), tensor) !=
+                  tensors.end(),
+              "The tensor is not in the graph");
+    IT_ASSERT(!tensor->isWeight() &&
+                  (!tensor->getSource() || tensor->getTargets().empty()),
+              "Only graph inputs and outputs can be bound");
+    if (tensor->bound != bound) {
+        tensor->bound = bound;
+        // bound tensors do not point into the arena any more, and unbound
+        // ones get a place at the next allocation
+        tensor->data = nullptr;
+        layouts.clear();
+        boundKey.clear();
+    }
+}
+
+void GraphObj::protectWeights(bool readOnly) {
+    if (readOnly != weightsReadOnly) {
+        runtime->protect(weightAllocator.getPtr(), readOnly);
+        weightsReadOnly = readOnly;
+    }
+}
+
+size_t GraphObj::getWorkspaceSize(const Operator &op) const {
+    auto kernel = KernelRegistry::getInstance().findKernel(
+        KernelAttrs{runtime->getDevice(), op->getOpType().underlying()});
+    return kernel ? kernel->getWorkspaceSize(op) : 0;
+}
+
+MemoryPlanner
+GraphObj::makePlanner(vector<TensorObj *> &planned,
+                      vector<pair<OperatorObj *, size_t>> &workspaces) const {
     // consider this example computation graph:
     // t1 (op-x) t2 (op-y) t3 (op-z) t4 (op-w) t5
     //
-    // 1. run op-x, active [t1 t2] (alloc t1 t2)
-    // 2. run op-y, active [t2 t3] (free t1, alloc t3)
-    // 3. run op-z, active [t3 t4] (free t2, alloc t4)
-    // 4. run op-w, active [t4 t5] (free t3, alloc t5)
+    // op-x is step 0, and so on; t2 lives from step 0 to step 1, i.e. from
+    // its definition to its last use. Graph inputs and outputs live during
+    // the whole run, so that the graph can be run again and its outputs
+    // read afterwards.
+    const auto n = ops.size();
+    std::unordered_map<const OperatorObj *, size_t> step;
+    for (size_t i = 0; i < n; ++i) {
+        step[ops[i].get()] = i;
+    }
 
-    std::unordered_map<TensorObj *, size_t> ref;
-    std::unordered_map<TensorObj *, size_t> off;
-#if 1
-    // all input tensors have to be allocated
-    for (const auto &in : getInputs()) {
-        off[in.get()] = allocator.alloc(in->getBytes());
+    std::unordered_map<TensorObj *, size_t> index;
+    vector<MemoryPlanner::Buffer> buffers;
+    for (const auto &t : tensors) {
+        if (!t->inArena()) {
+            continue;
+        }
+        MemoryPlanner::Buffer b{t->getBytes(), 0, n};
+        auto source = t->getSource();
+        auto targets = t->getTargets();
+        if (source) {
+            b.first = step.at(source.get());
+        }
+        if (source && !targets.empty()) {
+            b.last = b.first;
+            for (const auto &target : targets) {
+                b.last = std::max(b.last, step.at(target.get()));
+            }
+        }
+        index[t.get()] = buffers.size();
+        buffers.emplace_back(b);
+        planned.emplace_back(t.get());
     }
 
-    // in/out degree counting
-    for (const auto &op : ops) {
-        for (auto &in : op->getInputs()) {
-            ref[in.get()]++;
+    vector<vector<size_t>> steps(n);
+    for (size_t i = 0; i < n; ++i) {
+        for (const auto &t : ops[i]->getInputs()) {
+            if (t->inArena()) {
+                steps[i].emplace_back(index.at(t.get()));
+            }
+        }
+        for (const auto &t : ops[i]->getOutputs()) {
+            if (t->inArena()) {
+                steps[i].emplace_back(index.at(t.get()));
+            }
+        }
+        if (auto size = getWorkspaceSize(ops[i])) {
+            steps[i].emplace_back(buffers.size());
+            buffers.push_back({size, i, i});
+            workspaces.emplace_back(ops[i].get(), size);
         }
     }
+    return MemoryPlanner(std::move(buffers), std::move(steps),
+                         allocator.getAlignment());
+}
 
-    // membership testing
-    const auto mem = [](const auto &set, const auto &x) {
-        return set.find(x) != set.end();
-    };
+GraphObj::MemoryLayout GraphObj::planMemory() {
+    vector<TensorObj *> planned;
+    vector<pair<OperatorObj *, size_t>> workspaces;
+    auto result = makePlanner(planned, workspaces).plan(memoryStrategy);
+    plannedStrategy = result.strategy;
+
+    allocator.reset();
+    allocator.reserve(result.peak);
+    MemoryLayout layout;
+    for (size_t i = 0; i < planned.size(); ++i) {
+        layout.offsets[planned[i]] = result.offsets[i];
+        layout.bytes[planned[i]] = planned[i]->getBytes();
+    }
+    for (size_t i = 0; i < workspaces.size(); ++i) {
+        auto [op, size] = workspaces[i];
+        layout.workspaceOffsets[op] = result.offsets[planned.size() + i];
+        layout.workspaceBytes[op] = size;
+    }
+    layout.peak = result.peak;
+    layout.strategy = result.strategy;
+    return layout;
+}
 
-    // execute kernels in topological order
-    for (const auto &op : ops) {
-        // allocate if need
-        for (auto &out : op->getOutputs()) {
-            const auto outPtr = out.get();
-            if (!mem(off, outPtr)) {
-                off[outPtr] = allocator.alloc(out->getBytes());
+size_t GraphObj::planPeak() const {
+    vector<TensorObj *> planned;
+    vector<pair<OperatorObj *, size_t>> workspaces;
+    return makePlanner(planned, workspaces).plan(memoryStrategy).peak;
+}
+
+bool GraphObj::scheduleMemory(size_t budget) {
+    IT_ASSERT(topo_sort() == true);
+    const auto before = planPeak();
+    auto after = before;
+    if (budget == 0 || before > budget) {
+        // the activations as buffers, graph inputs and outputs included
+        std::unordered_map<TensorObj *, size_t> index;
+        vector<size_t> sizes;
+        for (const auto &t : tensors) {
+            if (t->inArena()) {
+                index[t.get()] = sizes.size();
+                sizes.emplace_back(t->getBytes());
             }
         }
-        // deallocate if ref count = 0
-        for (auto &in : op->getInputs()) {
-            const auto inPtr = in.get();
-            ref[inPtr]--;
-            if (ref[inPtr] == 0) {
-                allocator.free(off[inPtr], in->getBytes());
+        vector<MemoryScheduler::Op> steps(ops.size());
+        for (size_t i = 0; i < ops.size(); ++i) {
+            for (const auto &t : ops[i]->getInputs()) {
+                if (t->inArena()) {
+                    steps[i].inputs.emplace_back(index.at(t.get()));
+                }
+            }
+            for (const auto &t : ops[i]->getOutputs()) {
+                if (t->inArena()) {
+                    steps[i].outputs.emplace_back(index.at(t.get()));
+                }
+            }
+            steps[i].workspace = getWorkspaceSize(ops[i]);
+        }
+        MemoryScheduler scheduler(std::move(sizes), std::move(steps));
+        auto order = scheduler.schedule();
+
+        vector<size_t> current(ops.size());
+        std::iota(current.begin(), current.end(), 0);
+        if (scheduler.peak(order) < scheduler.peak(current)) {
+            OpVec reordered;
+            for (auto i : order) {
+                reordered.emplace_back(ops[i]);
+            }
+            std::swap(ops, reordered);
+            // fewer live bytes may still be harder to pack
+            if ((after = planPeak()) >= before) {
+                std::swap(ops, reordered);
+                after = before;
             }
         }
     }
-#else
-    for (auto &t : getTensors()) {
-        off[t.get()] = allocator.alloc(t->getBytes());
-    }
-#endif
 
+    // the order changed, so cached layouts are stale
+    layouts.clear();
+    boundKey.clear();
+    std::cout << "Memory schedule: peak memory: " << before << " -> "
+              << after << std::endl;
+    return budget == 0 || after <= budget;
+}
+
+string GraphObj::memoryReport() {
+    IT_ASSERT(topo_sort() == true);
+    vector<TensorObj *> planned;
+    vector<pair<OperatorObj *, size_t>> workspaces;
+    return makePlanner(planned, workspaces).report();
+}
+
+void GraphObj::setMemoryStrategy(MemoryStrategy strategy) {
+    memoryStrategy = strategy;
+    layouts.clear();
+}
+
+void GraphObj::bindMemory(const MemoryLayout &layout) {
     // add offset to pool pointer
+    auto ptr = reinterpret_cast<char *>(allocator.getPtr());
     for (auto &t : getTensors()) {
-        auto ptr = reinterpret_cast<char *>(allocator.getPtr());
-        t->setDataBlob(make_ref<BlobObj>(runtime, ptr + off[t.get()]));
+        if (t->inArena()) {
+            t->setDataBlob(
+                make_ref<BlobObj>(runtime, ptr + layout.offsets.at(t.get())));
+        }
+    }
+    for (auto &op : ops) {
+        auto it = layout.workspaceOffsets.find(op.get());
+        if (it == layout.workspaceOffsets.end()) {
+            op->workspace = nullptr;
+            op->workspaceSize = 0;
+        } else {
+            op->workspace = make_ref<BlobObj>(runtime, ptr + it->second);
+            op->workspaceSize = layout.workspaceBytes.at(op.get());
+        }
     }
+}
 
-    // print memory usage
-    allocator.info();
+void GraphObj::setShapeBucket(const Tensor &input, int axis,
+                              int granularity) {
+    IT_ASSERT(!input->getSource(), "Only graph inputs can be bucketed");
+    IT_ASSERT(granularity >= 0);
+    buckets[input.get()][get_real_axis(axis, input->getRank())] = granularity;
+    layouts.clear();
+}
+
+Shape GraphObj::bucketShape(const Tensor &input, Shape shape) const {
+    auto it = buckets.find(input.get());
+    if (it == buckets.end())
+        return shape;
+    for (const auto &[axis, granularity] : it->second) {
+        IT_ASSERT(axis < (int)shape.size());
+        auto &d = shape[axis];
+        if (granularity > 0) {
+            d = (d + granularity - 1) / granularity * granularity;
+        } else {
+            int p = 1;
+            while (p < d)
+                p *= 2;
+            d = p;
+        }
+    }
+    return shape;
+}
+
+void GraphObj::resize(const std::map<Tensor, Shape> &shapes) {
+    IT_ASSERT(topo_sort() == true);
+    for (const auto &[tensor, shape] : shapes) {
+        IT_ASSERT(!tensor->getSource(), "Only graph inputs can be resized");
+        IT_ASSERT(!tensor->isWeight(), "Weights cannot be resized");
+    }
+
+    // new shapes of the graph inputs and the key of their layout
+    const auto inputs = getInputs();
+    vector<Shape> dims, key;
+    for (const auto &in : inputs) {
+        auto it = shapes.find(in);
+        dims.emplace_back(it == shapes.end() ? in->getDims() : it->second);
+        key.emplace_back(bucketShape(in, dims.back()));
+    }
+
+    // save the data of the inputs keeping their shape if they may move
+    vector<std::pair<TensorObj *, vector<char>>> saved;
+    if (key != boundKey) {
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            const auto &in = inputs[i];
+            if (in->inArena() && in->data != nullptr &&
+                in->getDims() == dims[i]) {
+                auto ptr = in->getRawDataPtr<char *>();
+                saved.emplace_back(in.get(),
+                                   vector<char>(ptr, ptr + in->getBytes()));
+            }
+        }
+    }
+
+    auto layout = layouts.find(key);
+    if (layout == layouts.end()) {
+        // plan for the largest shapes of the bucket, so that all the shapes
+        // of the bucket fit in
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            inputs[i]->setShape(key[i]);
+        }
+        shape_infer();
+        layout = layouts.emplace(key, planMemory()).first;
+    }
+
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        inputs[i]->setShape(dims[i]);
+    }
+    shape_infer();
+    const auto &planned = layout->second;
+    for (const auto &t : tensors) {
+        IT_ASSERT(!t->inArena() || t->getBytes() <= planned.bytes.at(t.get()),
+                  "Tensor shapes must grow with the graph inputs");
+    }
+    for (const auto &op : ops) {
+        auto it = planned.workspaceBytes.find(op.get());
+        IT_ASSERT(getWorkspaceSize(op) <=
+                      (it == planned.workspaceBytes.end() ? 0 : it->second),
+                  "Workspaces must grow with the graph inputs");
+    }
+
+    // the arena is only reallocated if the layout needs more memory
+    allocator.reset();
+    allocator.reserve(planned.peak);
+    if (key != boundKey || allocator.getPtr() != boundArena) {
+        bindMemory(planned);
+        boundKey = key;
+        boundArena = allocator.getPtr();
+    }
+    for (const auto &[tensor, data] : saved) {
+        std::memcpy(tensor->getRawDataPtr<void *>(), data.data(), data.size());
+    }
 }
 
 Tensor GraphObj::addTensor(Shape dim, DataType dtype) {
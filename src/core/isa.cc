@@ -0,0 +1,62 @@
+#include "core/isa.h"
+#include <cstdlib>
+
+namespace infini {
+
+const char *toString(Isa isa) {
+    switch (isa) {
+    case Isa::Baseline:
+        return "baseline";
+    case Isa::SSE42:
+        return "sse4.2";
+    case Isa::AVX2:
+        return "avx2";
+    case Isa::AVX512:
+        return "avx512";
+    }
+    IT_TODO_HALT();
+}
+
+std::optional<Isa> parseIsa(const string &name) {
+    for (auto isa : {Isa::Baseline, Isa::SSE42, Isa::AVX2, Isa::AVX512})
+        if (name == toString(isa))
+            return isa;
+    return std::nullopt;
+}
+
+Isa getHostIsa() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") &&
+        __builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512dq") &&
+        __builtin_cpu_supports("avx512vl"))
+        return Isa::AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return Isa::AVX2;
+    if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt"))
+        return Isa::SSE42;
+#endif
+    return Isa::Baseline;
+}
+
+Isa getIsa() {
+    static const Isa isa = [] {
+        auto host = getHostIsa();
+        auto env = std::getenv("INFINI_ISA");
+        if (!env)
+            return host;
+        auto requested = parseIsa(env);
+        if (!requested) {
+            std::cerr << "INFINI_ISA: unknown ISA " << env
+                      << ", expected baseline, sse4.2, avx2 or avx512"
+                      << std::endl;
+            return host;
+        }
+        // the variants of a higher ISA would not run on this host
+        return std::min(*requested, host);
+    }();
+    return isa;
+}
+
+} // namespace infini
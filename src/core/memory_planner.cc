@@ -0,0 +1,328 @@
+#include "core/memory_planner.h"
+#include "core/allocator.h"
+#include <iomanip>
+#include <numeric>
+#include <queue>
+
+namespace infini {
+
+const char *toString(MemoryStrategy strategy) {
+    switch (strategy) {
+    case MemoryStrategy::Simulation:
+        return "Simulation";
+    case MemoryStrategy::GreedyBySize:
+        return "GreedyBySize";
+    case MemoryStrategy::GreedyByBreadth:
+        return "GreedyByBreadth";
+    case MemoryStrategy::BestOf:
+        return "BestOf";
+    }
+    IT_TODO_HALT();
+}
+
+MemoryPlanner::MemoryPlanner(vector<Buffer> buffers_,
+                             vector<vector<size_t>> steps_, size_t alignment)
+    : buffers(std::move(buffers_)), steps(std::move(steps_)),
+      alignment(alignment) {
+    for (auto &b : buffers) {
+        IT_ASSERT(b.first <= b.last && b.last <= steps.size());
+        b.size = (b.size + alignment - 1) / alignment * alignment;
+    }
+}
+
+MemoryPlanner::Result MemoryPlanner::plan(MemoryStrategy strategy) const {
+    switch (strategy) {
+    case MemoryStrategy::Simulation:
+        return simulate();
+    case MemoryStrategy::GreedyBySize:
+        return greedyBySize();
+    case MemoryStrategy::GreedyByBreadth:
+        return greedyByBreadth();
+    case MemoryStrategy::BestOf: {
+        auto best = simulate();
+        for (auto candidate : {greedyBySize(), greedyByBreadth()})
+            if (candidate.peak < best.peak)
+                best = std::move(candidate);
+        return best;
+    }
+    }
+    IT_TODO_HALT();
+}
+
+MemoryPlanner::Result MemoryPlanner::simulate() const {
+    const auto n = steps.size();
+    vector<vector<size_t>> allocs(n + 1), frees(n + 1);
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        allocs[buffers[i].first].emplace_back(i);
+        // buffers alive until the end are never released
+        if (buffers[i].last < n)
+            frees[buffers[i].last].emplace_back(i);
+    }
+
+    // only simulates, so the allocator never needs a runtime
+    Allocator allocator(nullptr);
+    Result result{MemoryStrategy::Simulation, vector<size_t>(buffers.size()),
+                  0};
+    for (size_t s = 0; s <= n; ++s) {
+        for (auto i : allocs[s])
+            result.offsets[i] = allocator.alloc(buffers[i].size);
+        for (auto i : frees[s])
+            allocator.free(result.offsets[i], buffers[i].size);
+    }
+    result.peak = allocator.getPeak();
+    return result;
+}
+
+MemoryPlanner::Result MemoryPlanner::greedyBySize() const {
+    vector<size_t> order(buffers.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return buffers[a].size > buffers[b].size;
+    });
+    return greedy(MemoryStrategy::GreedyBySize, order);
+}
+
+MemoryPlanner::Result MemoryPlanner::greedyByBreadth() const {
+    // the breadth of a step is the size of the buffers it reads or writes
+    vector<size_t> breadth(steps.size(), 0), byBreadth(steps.size());
+    for (size_t s = 0; s < steps.size(); ++s)
+        for (auto i : steps[s])
+            breadth[s] += buffers[i].size;
+    std::iota(byBreadth.begin(), byBreadth.end(), 0);
+    std::stable_sort(
+        byBreadth.begin(), byBreadth.end(),
+        [&](size_t a, size_t b) { return breadth[a] > breadth[b]; });
+
+    const auto bySize = [&](size_t a, size_t b) {
+        return buffers[a].size > buffers[b].size;
+    };
+    vector<size_t> order;
+    vector<bool> queued(buffers.size(), false);
+    for (auto s : byBreadth) {
+        auto touched = steps[s];
+        std::stable_sort(touched.begin(), touched.end(), bySize);
+        for (auto i : touched)
+            if (!queued[i]) {
+                queued[i] = true;
+                order.emplace_back(i);
+            }
+    }
+    // buffers used by no step
+    auto rest = order.size();
+    for (size_t i = 0; i < buffers.size(); ++i)
+        if (!queued[i])
+            order.emplace_back(i);
+    std::stable_sort(order.begin() + rest, order.end(), bySize);
+    return greedy(MemoryStrategy::GreedyByBreadth, order);
+}
+
+MemoryPlanner::Result
+MemoryPlanner::greedy(MemoryStrategy strategy,
+                      const vector<size_t> &order) const {
+    // buffers already placed, sorted by offset
+    vector<size_t> placed;
+    Result result{strategy, vector<size_t>(buffers.size()), 0};
+    const auto &offsets = result.offsets;
+    for (auto i : order) {
+        const auto &b = buffers[i];
+        // the smallest gap between the buffers alive at the same time which
+        // is large enough, or the end of the highest of them
+        size_t best = SIZE_MAX, bestGap = SIZE_MAX, end = 0;
+        for (auto j : placed) {
+            const auto &p = buffers[j];
+            if (p.last < b.first || b.last < p.first)
+                continue;
+            if (offsets[j] >= end + b.size && offsets[j] - end < bestGap) {
+                best = end;
+                bestGap = offsets[j] - end;
+            }
+            end = std::max(end, offsets[j] + p.size);
+        }
+        result.offsets[i] = best == SIZE_MAX ? end : best;
+        result.peak = std::max(result.peak, result.offsets[i] + b.size);
+        auto pos = std::upper_bound(
+            placed.begin(), placed.end(), result.offsets[i],
+            [&](size_t offset, size_t j) { return offset < offsets[j]; });
+        placed.insert(pos, i);
+    }
+    return result;
+}
+
+size_t MemoryPlanner::lowerBound() const {
+    vector<long long> diff(steps.size() + 2, 0);
+    for (const auto &b : buffers) {
+        diff[b.first] += b.size;
+        diff[b.last + 1] -= b.size;
+    }
+    long long live = 0, ret = 0;
+    for (auto d : diff)
+        ret = std::max(ret, live += d);
+    return ret;
+}
+
+string MemoryPlanner::report() const {
+    const auto bound = lowerBound();
+    std::ostringstream oss;
+    oss << std::left << std::setw(18) << "Strategy" << std::right
+        << std::setw(14) << "Peak" << std::setw(10) << "/Bound" << "\n";
+    oss << std::fixed << std::setprecision(3);
+    for (auto strategy :
+         {MemoryStrategy::Simulation, MemoryStrategy::GreedyBySize,
+          MemoryStrategy::GreedyByBreadth, MemoryStrategy::BestOf}) {
+        auto peak = plan(strategy).peak;
+        oss << std::left << std::setw(18) << toString(strategy) << std::right
+            << std::setw(14) << peak << std::setw(10)
+            << (bound ? double(peak) / bound : 1.0) << "\n";
+    }
+    oss << std::left << std::setw(18) << "LowerBound" << std::right
+        << std::setw(14) << bound << "\n";
+    return oss.str();
+}
+
+MemoryScheduler::MemoryScheduler(vector<size_t> sizes_, vector<Op> ops_)
+    : sizes(std::move(sizes_)), ops(std::move(ops_)),
+      writer(sizes.size(), ops.size()), readers(sizes.size()) {
+    for (size_t i = 0; i < ops.size(); ++i) {
+        auto &inputs = ops[i].inputs;
+        std::sort(inputs.begin(), inputs.end());
+        inputs.erase(std::unique(inputs.begin(), inputs.end()), inputs.end());
+        for (auto b : inputs)
+            readers[b].emplace_back(i);
+        for (auto b : ops[i].outputs) {
+            IT_ASSERT(writer[b] == ops.size(), "Buffer written twice");
+            writer[b] = i;
+        }
+    }
+}
+
+size_t MemoryScheduler::allocated(size_t op) const {
+    size_t ret = ops[op].workspace;
+    for (auto b : ops[op].outputs)
+        ret += sizes[b];
+    return ret;
+}
+
+size_t MemoryScheduler::peak(const vector<size_t> &order) const {
+    IT_ASSERT(order.size() == ops.size());
+    size_t live = 0, ret = 0;
+    vector<size_t> remaining(sizes.size());
+    for (size_t b = 0; b < sizes.size(); ++b) {
+        remaining[b] = readers[b].size();
+        if (writer[b] == ops.size())
+            live += sizes[b];
+    }
+    ret = live;
+    for (auto i : order) {
+        ret = std::max(ret, live + allocated(i));
+        live += allocated(i) - ops[i].workspace;
+        for (auto b : ops[i].inputs)
+            if (--remaining[b] == 0 && writer[b] != ops.size())
+                live -= sizes[b];
+    }
+    return ret;
+}
+
+vector<size_t> MemoryScheduler::schedule() const {
+    return ops.size() <= maxExactOps ? exact() : greedy();
+}
+
+vector<size_t> MemoryScheduler::exact() const {
+    // the live bytes only depend on the set of executed ops, so the best
+    // peak of every set is the best peak of the sets one op smaller
+    const size_t n = ops.size(), full = (size_t(1) << n) - 1;
+    vector<size_t> deps(n, 0), readMask(sizes.size(), 0);
+    for (size_t i = 0; i < n; ++i)
+        for (auto b : ops[i].inputs) {
+            readMask[b] |= size_t(1) << i;
+            if (writer[b] != n)
+                deps[i] |= size_t(1) << writer[b];
+        }
+    size_t initial = 0;
+    for (size_t b = 0; b < sizes.size(); ++b)
+        if (writer[b] == n)
+            initial += sizes[b];
+
+    vector<size_t> best(full + 1, SIZE_MAX), live(full + 1, 0);
+    vector<uint8_t> last(full + 1, 0);
+    best[0] = initial;
+    live[0] = initial;
+    for (size_t mask = 0; mask < full; ++mask) {
+        if (best[mask] == SIZE_MAX)
+            continue;
+        for (size_t i = 0; i < n; ++i) {
+            const auto bit = size_t(1) << i;
+            if ((mask & bit) || (deps[i] & ~mask))
+                continue;
+            const auto next = mask | bit;
+            auto peak = std::max(best[mask], live[mask] + allocated(i));
+            if (peak >= best[next])
+                continue;
+            best[next] = peak;
+            last[next] = i;
+            live[next] = live[mask] + allocated(i) - ops[i].workspace;
+            for (auto b : ops[i].inputs)
+                if (writer[b] != n && (readMask[b] & ~next) == 0)
+                    live[next] -= sizes[b];
+        }
+    }
+
+    vector<size_t> order(n);
+    for (size_t mask = full, k = n; k > 0; mask &= ~(size_t(1) << last[mask]))
+        order[--k] = last[mask];
+    return order;
+}
+
+vector<size_t> MemoryScheduler::greedy() const {
+    // the increase of the live bytes caused by an op, which only decreases
+    // as the other readers of its inputs run
+    const auto n = ops.size();
+    vector<size_t> remaining(sizes.size()), pending(n, 0);
+    for (size_t b = 0; b < sizes.size(); ++b)
+        remaining[b] = readers[b].size();
+    vector<vector<size_t>> successors(n);
+    for (size_t i = 0; i < n; ++i)
+        for (auto b : ops[i].inputs)
+            if (writer[b] != n) {
+                successors[writer[b]].emplace_back(i);
+                pending[i]++;
+            }
+    const auto delta = [&](size_t i) {
+        auto ret = (long long)allocated(i) - (long long)ops[i].workspace;
+        for (auto b : ops[i].inputs)
+            if (writer[b] != n && remaining[b] == 1)
+                ret -= sizes[b];
+        return ret;
+    };
+
+    // ready ops by increasing delta then position; entries whose delta is
+    // outdated are skipped
+    using Entry = pair<long long, size_t>;
+    std::priority_queue<Entry, vector<Entry>, std::greater<Entry>> ready;
+    for (size_t i = 0; i < n; ++i)
+        if (pending[i] == 0)
+            ready.emplace(delta(i), i);
+    vector<bool> done(n, false);
+    vector<size_t> order;
+    order.reserve(n);
+    while (!ready.empty()) {
+        auto [d, i] = ready.top();
+        ready.pop();
+        if (done[i] || d != delta(i))
+            continue;
+        done[i] = true;
+        order.emplace_back(i);
+        for (auto b : ops[i].inputs)
+            if (--remaining[b] == 1)
+                // the last reader now frees the buffer
+                for (auto r : readers[b])
+                    if (!done[r] && pending[r] == 0)
+                        ready.emplace(delta(r), r);
+        for (auto s : successors[i])
+            if (--pending[s] == 0)
+                ready.emplace(delta(s), s);
+    }
+    IT_ASSERT(order.size() == n, "The ops contain a cycle");
+    return order;
+}
+
+} // namespace infini
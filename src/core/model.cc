@@ -0,0 +1,494 @@
+#include "core/model.h"
+#include "core/kernel.h"
+#include "operators/concat.h"
+#include "operators/element_wise.h"
+#include "operators/matmul.h"
+#include "operators/transpose.h"
+#include "operators/unary.h"
+#include <cstddef>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace infini {
+
+static_assert(modelAlignment % RuntimeObj::alignment == 0,
+              "Mapped weights must be aligned like the arena");
+
+namespace {
+
+constexpr char magic[8] = {'I', 'T', 'M', 'O', 'D', 'E', 'L', '\0'};
+// reads as another value on a host of the other byte order
+constexpr uint32_t byteOrderMark = 0x01020304;
+constexpr uint64_t noData = UINT64_MAX;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t metaOffset, metaSize;
+    uint64_t dataOffset, dataSize;
+    // since version 2
+    uint64_t planOffset, planSize;
+    uint64_t key;
+    uint32_t engine;
+    uint32_t reserved;
+};
+// the header of version 1 ends with the data section
+constexpr size_t headerSizeV1 = offsetof(Header, planOffset);
+
+size_t alignUp(size_t size) {
+    return (size + modelAlignment - 1) / modelAlignment * modelAlignment;
+}
+
+// whether [offset, offset + size) lies in [0, limit), without overflowing on
+// the values of a crafted file
+bool within(uint64_t offset, uint64_t size, uint64_t limit) {
+    return offset <= limit && size <= limit - offset;
+}
+
+class Writer {
+    string buffer;
+
+  public:
+    template <typename T> void put(T value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        buffer.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+    template <typename T> void putVector(const vector<T> &values) {
+        put<uint32_t>(values.size());
+        for (const auto &v : values)
+            put(v);
+    }
+    const string &str() const { return buffer; }
+};
+
+// bounds-checked reads from the metadata section
+class Reader {
+    const char *ptr, *end;
+
+  public:
+    Reader(const char *begin, size_t size) : ptr(begin), end(begin + size) {}
+
+    template <typename T> T get() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        IT_ASSERT(size_t(end - ptr) >= sizeof(T), "Truncated model file");
+        T value;
+        std::memcpy(&value, ptr, sizeof(T));
+        ptr += sizeof(T);
+        return value;
+    }
+    template <typename T> vector<T> getVector() {
+        auto n = get<uint32_t>();
+        IT_ASSERT(size_t(end - ptr) / sizeof(T) >= n, "Truncated model file");
+        vector<T> values(n);
+        for (auto &v : values)
+            v = get<T>();
+        return values;
+    }
+};
+
+void putOptional(Writer &writer, optional<float> value) {
+    writer.put<uint8_t>(value.has_value());
+    writer.put<float>(value.value_or(0));
+}
+
+optional<float> getOptional(Reader &reader) {
+    auto has = reader.get<uint8_t>();
+    auto value = reader.get<float>();
+    return has ? optional<float>(value) : std::nullopt;
+}
+
+void putAttributes(Writer &writer, const Operator &op) {
+    switch (op->getOpType().underlying()) {
+    case OpType::Add:
+    case OpType::Sub:
+    case OpType::Mul:
+    case OpType::Div:
+    case OpType::Relu:
+        break;
+    case OpType::MatMul: {
+        auto matmul = as<MatmulObj>(op);
+        writer.put<uint8_t>(matmul->getTransA());
+        writer.put<uint8_t>(matmul->getTransB());
+        break;
+    }
+    case OpType::Concat:
+        writer.put<int32_t>(as<ConcatObj>(op)->getDim());
+        break;
+    case OpType::Transpose:
+        writer.putVector<int32_t>(as<TransposeObj>(op)->getPermute());
+        break;
+    case OpType::Clip: {
+        auto clip = as<ClipObj>(op);
+        putOptional(writer, clip->getMin());
+        putOptional(writer, clip->getMax());
+        break;
+    }
+    case OpType::Cast:
+        writer.put<int32_t>(enum_to_underlying(as<CastObj>(op)->getType()));
+        break;
+    default:
+        IT_TODO_HALT_MSG(string("Cannot save ") + op->getOpType().toString());
+    }
+}
+
+void addOperator(GraphObj &g, OpType type, const TensorVec &inputs,
+                 const TensorVec &outputs, Reader &reader) {
+    const auto arity = [&](size_t nInputs) {
+        IT_ASSERT(inputs.size() == nInputs && outputs.size() == 1,
+                  string("Bad arity of ") + type.toString());
+    };
+    switch (type.underlying()) {
+    case OpType::Add:
+        arity(2);
+        g.addOpWithOutputs<AddObj>(inputs[0], inputs[1], outputs[0]);
+        break;
+    case OpType::Sub:
+        arity(2);
+        g.addOpWithOutputs<SubObj>(inputs[0], inputs[1], outputs[0]);
+        break;
+    case OpType::Mul:
+        arity(2);
+        g.addOpWithOutputs<MulObj>(inputs[0], inputs[1], outputs[0]);
+        break;
+    case OpType::Div:
+        arity(2);
+        g.addOpWithOutputs<DivObj>(inputs[0], inputs[1], outputs[0]);
+        break;
+    case OpType::Relu:
+        arity(1);
+        g.addOpWithOutputs<ReluObj>(inputs[0], outputs[0]);
+        break;
+    case OpType::MatMul: {
+        arity(2);
+        bool transA = reader.get<uint8_t>();
+        bool transB = reader.get<uint8_t>();
+        g.addOpWithOutputs<MatmulObj>(inputs[0], inputs[1], outputs[0],
+                                      transA, transB);
+        break;
+    }
+    case OpType::Concat:
+        IT_ASSERT(outputs.size() == 1, "Bad arity of Concat");
+        g.addOpWithOutputs<ConcatObj>(inputs, outputs[0],
+                                      reader.get<int32_t>());
+        break;
+    case OpType::Transpose:
+        arity(1);
+        g.addOpWithOutputs<TransposeObj>(inputs[0], outputs[0],
+                                         reader.getVector<int32_t>());
+        break;
+    case OpType::Clip: {
+        arity(1);
+        auto min = getOptional(reader);
+        auto max = getOptional(reader);
+        g.addOpWithOutputs<ClipObj>(inputs[0], outputs[0], min, max);
+        break;
+    }
+    case OpType::Cast:
+        arity(1);
+        g.addOpWithOutputs<CastObj>(inputs[0], outputs[0],
+                                    CastType(reader.get<int32_t>()));
+        break;
+    default:
+        IT_TODO_HALT_MSG(string("Cannot load ") + type.toString());
+    }
+}
+
+// the name of the kernel running `op`, empty if there is none
+string kernelName(const Operator &op, Device device) {
+    const auto &registry = KernelRegistry::getInstance();
+    KernelAttrs attrs{device, op->getOpType().underlying()};
+    if (registry.findKernel(attrs) == nullptr)
+        return "";
+    return std::get<1>(registry.getKernelItem(attrs));
+}
+
+// the tensors, then the ops in topological order
+Writer writeMeta(const Graph &graph, uint64_t &dataSize) {
+    IT_ASSERT(graph->topo_sort() == true);
+    const auto &tensors = graph->getTensors();
+    std::unordered_map<TensorObj *, uint32_t> index;
+    Writer meta;
+    dataSize = 0;
+    meta.put<uint32_t>(tensors.size());
+    for (const auto &t : tensors) {
+        auto i = index.size();
+        index[t.get()] = i;
+        meta.put<int32_t>(t->getDType().getIndex());
+        meta.put<uint32_t>(enum_to_underlying(t->getTensorType()));
+        meta.putVector<int32_t>(t->getDims());
+        if (t->isWeight()) {
+            meta.put<uint64_t>(dataSize);
+            dataSize = alignUp(dataSize + t->getBytes());
+        } else {
+            meta.put<uint64_t>(noData);
+        }
+    }
+    const auto &ops = graph->getOperators();
+    meta.put<uint32_t>(ops.size());
+    for (const auto &op : ops) {
+        meta.put<uint16_t>(op->getOpType().underlying());
+        for (const auto *list : {&op->getInputs(), &op->getOutputs()}) {
+            meta.put<uint32_t>(list->size());
+            for (const auto &t : *list)
+                meta.put<uint32_t>(index.at(t.get()));
+        }
+        putAttributes(meta, op);
+    }
+    return meta;
+}
+
+// the arena layout: its size, then the offset of every tensor (-1 for the
+// weights and the bound tensors) and the kernel and workspace of every op
+Writer writePlan(const Graph &graph) {
+    auto layout = graph->getMemoryLayout();
+    Writer plan;
+    plan.put<uint64_t>(layout.peak);
+    plan.put<uint32_t>(enum_to_underlying(layout.strategy));
+    for (const auto &t : graph->getTensors()) {
+        auto it = layout.offsets.find(t.get());
+        plan.put<uint64_t>(it == layout.offsets.end() ? noData : it->second);
+    }
+    auto device = graph->getRuntime()->getDevice();
+    for (const auto &op : graph->getOperators()) {
+        auto name = kernelName(op, device);
+        plan.putVector<char>(vector<char>(name.begin(), name.end()));
+        auto it = layout.workspaceOffsets.find(op.get());
+        if (it == layout.workspaceOffsets.end()) {
+            plan.put<uint64_t>(noData);
+            plan.put<uint64_t>(0);
+        } else {
+            plan.put<uint64_t>(it->second);
+            plan.put<uint64_t>(layout.workspaceBytes.at(op.get()));
+        }
+    }
+    return plan;
+}
+
+void writeFile(const Graph &graph, const string &path, const Writer *plan,
+               uint64_t key) {
+    uint64_t dataSize;
+    auto meta = writeMeta(graph, dataSize);
+    Header header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = modelVersion;
+    header.byteOrder = byteOrderMark;
+    header.metaOffset = sizeof(Header);
+    header.metaSize = meta.str().size();
+    header.planOffset = header.metaOffset + header.metaSize;
+    header.planSize = plan ? plan->str().size() : 0;
+    header.key = key;
+    header.engine = plan ? engineVersion : 0;
+    header.dataOffset = alignUp(header.planOffset + header.planSize);
+    header.dataSize = dataSize;
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    IT_ASSERT(file.good(), "Cannot open " + path);
+    const auto pad = [&](size_t offset) {
+        string zeros(offset - size_t(file.tellp()), '\0');
+        file.write(zeros.data(), zeros.size());
+    };
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(meta.str().data(), meta.str().size());
+    if (plan)
+        file.write(plan->str().data(), plan->str().size());
+    uint64_t offset = 0;
+    for (const auto &t : graph->getTensors()) {
+        if (!t->isWeight())
+            continue;
+        IT_ASSERT(t->hasData(), "Weights must hold their data");
+        pad(header.dataOffset + offset);
+        file.write(t->getRawDataPtr<const char *>(), t->getBytes());
+        offset = alignUp(offset + t->getBytes());
+    }
+    pad(header.dataOffset + dataSize);
+    IT_ASSERT(file.good(), "Cannot write " + path);
+}
+
+Ref<MappedFile> openFile(const string &path, Header &header) {
+    auto file = make_ref<MappedFile>(path);
+    IT_ASSERT(file->getSize() >= headerSizeV1, "Truncated model file");
+    header = Header{};
+    std::memcpy(&header, file->data(), headerSizeV1);
+    IT_ASSERT(std::memcmp(header.magic, magic, sizeof(magic)) == 0,
+              path + " is not a model file");
+    IT_ASSERT(header.byteOrder == byteOrderMark, "Unsupported byte order");
+    IT_ASSERT(header.version <= modelVersion,
+              "Unsupported model version " + std::to_string(header.version));
+    if (header.version >= 2) {
+        IT_ASSERT(file->getSize() >= sizeof(Header), "Truncated model file");
+        std::memcpy(&header, file->data(), sizeof(Header));
+    }
+    IT_ASSERT(within(header.metaOffset, header.metaSize, file->getSize()) &&
+                  within(header.planOffset, header.planSize, file->getSize()) &&
+                  header.dataOffset % modelAlignment == 0 &&
+                  within(header.dataOffset, header.dataSize, file->getSize()),
+              "Truncated model file");
+    return file;
+}
+
+Graph readGraph(const Ref<MappedFile> &file, const Header &header,
+                Runtime runtime) {
+    Graph g = make_ref<GraphObj>(runtime);
+    Reader reader(file->data() + header.metaOffset, header.metaSize);
+    TensorVec tensors(reader.get<uint32_t>());
+    for (auto &t : tensors) {
+        auto dtype = reader.get<int32_t>();
+        IT_ASSERT(dtype > 0 && size_t(dtype) < std::size(DataType::names) &&
+                      DataType(dtype).getSize() > 0,
+                  "Bad data type");
+        auto type = TensorType(reader.get<uint32_t>());
+        IT_ASSERT(type <= TensorType::Constant, "Bad tensor type");
+        t = g->addTensor(reader.getVector<int32_t>(), DataType(dtype));
+        auto offset = reader.get<uint64_t>();
+        if (type != TensorType::Weight && type != TensorType::Constant) {
+            IT_ASSERT(offset == noData, "Only weights hold data");
+            continue;
+        }
+        t->setTensorType(type);
+        IT_ASSERT(offset % modelAlignment == 0 &&
+                      within(offset, t->getBytes(), header.dataSize),
+                  "Truncated model file");
+        auto ptr = file->data() + header.dataOffset + offset;
+        t->setDataBlob(make_ref<BlobObj>(runtime, ptr, file));
+    }
+    const auto getTensors = [&] {
+        TensorVec ret;
+        for (auto i : reader.getVector<uint32_t>()) {
+            IT_ASSERT(i < tensors.size(), "Bad tensor index");
+            ret.emplace_back(tensors[i]);
+        }
+        return ret;
+    };
+    auto nOps = reader.get<uint32_t>();
+    for (uint32_t i = 0; i < nOps; ++i) {
+        OpType type(reader.get<uint16_t>());
+        auto inputs = getTensors();
+        auto outputs = getTensors();
+        addOperator(*g, type, inputs, outputs, reader);
+    }
+    return g;
+}
+
+// the layout saved by `writePlan`, nullopt if the kernels it was planned
+// for are not the ones registered any more
+optional<GraphObj::MemoryLayout> readPlan(const Ref<MappedFile> &file,
+                                          const Header &header,
+                                          const Graph &g) {
+    Reader reader(file->data() + header.planOffset, header.planSize);
+    GraphObj::MemoryLayout layout;
+    layout.peak = reader.get<uint64_t>();
+    auto strategy = reader.get<uint32_t>();
+    IT_ASSERT(strategy <= uint32_t(MemoryStrategy::BestOf),
+              "Bad memory strategy");
+    layout.strategy = MemoryStrategy(strategy);
+    const auto fits = [&](uint64_t offset, uint64_t size) {
+        IT_ASSERT(offset % RuntimeObj::alignment == 0 &&
+                      within(offset, size, layout.peak),
+                  "Bad memory plan");
+    };
+    for (const auto &t : g->getTensors()) {
+        auto offset = reader.get<uint64_t>();
+        IT_ASSERT(offset == noData || !t->isWeight(), "Bad memory plan");
+        // activations out of the arena were bound by the caller
+        if (offset == noData && !t->isWeight())
+            g->setBound(t);
+        if (offset != noData) {
+            fits(offset, t->getBytes());
+            layout.offsets[t.get()] = offset;
+            layout.bytes[t.get()] = t->getBytes();
+        }
+    }
+    auto device = g->getRuntime()->getDevice();
+    for (const auto &op : g->getOperators()) {
+        auto name = reader.getVector<char>();
+        if (string(name.begin(), name.end()) != kernelName(op, device))
+            return std::nullopt;
+        auto offset = reader.get<uint64_t>();
+        auto size = reader.get<uint64_t>();
+        if (offset != noData) {
+            fits(offset, size);
+            layout.workspaceOffsets[op.get()] = offset;
+            layout.workspaceBytes[op.get()] = size;
+        }
+    }
+    return layout;
+}
+
+} // namespace
+
+MappedFile::MappedFile(const string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    IT_ASSERT(fd >= 0, "Cannot open " + path);
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        IT_TODO_HALT_MSG("Cannot map " + path);
+    }
+    size = st.st_size;
+    // private and writable: writes are copied, never reach the file
+    ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    IT_ASSERT(ptr != MAP_FAILED, "Cannot map " + path);
+}
+
+MappedFile::~MappedFile() { munmap(ptr, size); }
+
+void saveModel(const Graph &graph, const string &path) {
+    writeFile(graph, path, nullptr, 0);
+}
+
+Graph loadModel(const string &path, Runtime runtime) {
+    Header header;
+    auto file = openFile(path, header);
+    return readGraph(file, header, runtime);
+}
+
+uint64_t hashGraph(const Graph &graph) {
+    // 64-bit FNV-1a
+    uint64_t hash = 0xcbf29ce484222325;
+    const auto update = [&](const char *data, size_t size) {
+        for (size_t i = 0; i < size; ++i)
+            hash = (hash ^ uint8_t(data[i])) * 0x100000001b3;
+    };
+    uint64_t dataSize;
+    auto meta = writeMeta(graph, dataSize);
+    update(meta.str().data(), meta.str().size());
+    for (const auto &t : graph->getTensors()) {
+        if (t->isWeight()) {
+            IT_ASSERT(t->hasData(), "Weights must hold their data");
+            update(t->getRawDataPtr<const char *>(), t->getBytes());
+        }
+    }
+    return hash;
+}
+
+void saveCompiled(const Graph &graph, const string &path, uint64_t key) {
+    auto plan = writePlan(graph);
+    writeFile(graph, path, &plan, key);
+}
+
+Graph loadCompiled(const string &path, Runtime runtime, uint64_t key) {
+    Header header;
+    Ref<MappedFile> file;
+    try {
+        file = openFile(path, header);
+    } catch (const Exception &) {
+        // a missing or foreign file is a miss, not an error
+        return nullptr;
+    }
+    if (header.planSize == 0 || header.key != key ||
+        header.engine != engineVersion)
+        return nullptr;
+    auto g = readGraph(file, header, runtime);
+    auto layout = readPlan(file, header, g);
+    if (!layout)
+        return nullptr;
+    g->dataMalloc(*layout);
+    return g;
+}
+
+} // namespace infini
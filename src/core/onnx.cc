@@ -0,0 +1,641 @@
+#include "core/onnx.h"
+#include "core/model.h"
+#include "operators/concat.h"
+#include "operators/element_wise.h"
+#include "operators/matmul.h"
+#include "operators/transpose.h"
+#include "operators/unary.h"
+#include <charconv>
+#include <filesystem>
+#include <string_view>
+
+namespace infini {
+
+namespace {
+
+// Field numbers of the ONNX messages, see onnx/onnx.proto
+namespace field {
+constexpr uint32_t modelGraph = 7;
+constexpr uint32_t graphNode = 1, graphInitializer = 5, graphInput = 11,
+                   graphOutput = 12;
+constexpr uint32_t nodeInput = 1, nodeOutput = 2, nodeOpType = 4,
+                   nodeAttribute = 5;
+constexpr uint32_t attrName = 1, attrF = 2, attrI = 3, attrS = 4,
+                   attrFloats = 7, attrInts = 8;
+constexpr uint32_t tensorDims = 1, tensorDataType = 2, tensorFloatData = 4,
+                   tensorInt32Data = 5, tensorInt64Data = 7, tensorName = 8,
+                   tensorRawData = 9, tensorExternalData = 13,
+                   tensorDataLocation = 14;
+constexpr uint32_t entryKey = 1, entryValue = 2;
+constexpr uint32_t valueName = 1, valueType = 2;
+constexpr uint32_t typeTensor = 1;
+constexpr uint32_t tensorTypeElem = 1, tensorTypeShape = 2;
+constexpr uint32_t shapeDim = 1;
+constexpr uint32_t dimValue = 1, dimParam = 2;
+} // namespace field
+
+enum Wire : uint32_t { Varint = 0, Fixed64 = 1, Bytes = 2, Fixed32 = 5 };
+
+/**
+ * @brief Decodes the fields of one protobuf message, in order.
+ */
+class ProtoReader {
+    const uint8_t *ptr, *end;
+
+  public:
+    uint32_t number = 0, wire = 0;
+
+    explicit ProtoReader(std::string_view bytes)
+        : ptr(reinterpret_cast<const uint8_t *>(bytes.data())),
+          end(ptr + bytes.size()) {}
+
+    // reads the key of the next field, false at the end of the message
+    bool next() {
+        if (ptr == end)
+            return false;
+        auto key = varint();
+        number = key >> 3;
+        wire = key & 7;
+        return true;
+    }
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            IT_ASSERT(ptr < end, "Truncated ONNX model");
+            auto byte = *ptr++;
+            value |= uint64_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return value;
+        }
+        IT_TODO_HALT_MSG("Bad varint in ONNX model");
+    }
+
+    template <typename T> T fixed() {
+        IT_ASSERT(size_t(end - ptr) >= sizeof(T), "Truncated ONNX model");
+        T value;
+        std::memcpy(&value, ptr, sizeof(T));
+        ptr += sizeof(T);
+        return value;
+    }
+
+    std::string_view bytes() {
+        auto size = varint();
+        IT_ASSERT(size <= uint64_t(end - ptr), "Truncated ONNX model");
+        std::string_view ret(reinterpret_cast<const char *>(ptr), size);
+        ptr += size;
+        return ret;
+    }
+
+    void skip() {
+        switch (wire) {
+        case Varint:
+            varint();
+            break;
+        case Fixed64:
+            fixed<uint64_t>();
+            break;
+        case Bytes:
+            bytes();
+            break;
+        case Fixed32:
+            fixed<uint32_t>();
+            break;
+        default:
+            IT_TODO_HALT_MSG("Unsupported wire type in ONNX model");
+        }
+    }
+
+    // a repeated scalar field, packed or not
+    template <typename T> void repeated(vector<T> &values) {
+        const auto one = [&](ProtoReader &r) {
+            if constexpr (std::is_same_v<T, float>)
+                values.emplace_back(r.fixed<float>());
+            else
+                values.emplace_back(T(int64_t(r.varint())));
+        };
+        if (wire != Bytes) {
+            one(*this);
+            return;
+        }
+        ProtoReader packed(bytes());
+        while (packed.ptr < packed.end)
+            one(packed);
+    }
+};
+
+struct Attribute {
+    int64_t i = 0;
+    float f = 0;
+    string s;
+    vector<int64_t> ints;
+    vector<float> floats;
+};
+
+struct Node {
+    string opType;
+    vector<string> inputs, outputs;
+    std::map<string, Attribute> attributes;
+
+    const Attribute *find(const string &name) const {
+        auto it = attributes.find(name);
+        return it == attributes.end() ? nullptr : &it->second;
+    }
+    int64_t getInt(const string &name, int64_t otherwise) const {
+        auto attr = find(name);
+        return attr ? attr->i : otherwise;
+    }
+    float getFloat(const string &name, float otherwise) const {
+        auto attr = find(name);
+        return attr ? attr->f : otherwise;
+    }
+};
+
+Node parseNode(std::string_view bytes) {
+    Node node;
+    ProtoReader r(bytes);
+    while (r.next()) {
+        switch (r.number) {
+        case field::nodeInput:
+            node.inputs.emplace_back(r.bytes());
+            break;
+        case field::nodeOutput:
+            node.outputs.emplace_back(r.bytes());
+            break;
+        case field::nodeOpType:
+            node.opType = r.bytes();
+            break;
+        case field::nodeAttribute: {
+            string name;
+            Attribute attr;
+            ProtoReader a(r.bytes());
+            while (a.next()) {
+                if (a.number == field::attrName)
+                    name = a.bytes();
+                else if (a.number == field::attrF)
+                    attr.f = a.fixed<float>();
+                else if (a.number == field::attrI)
+                    attr.i = a.varint();
+                else if (a.number == field::attrS)
+                    attr.s = a.bytes();
+                else if (a.number == field::attrFloats)
+                    a.repeated(attr.floats);
+                else if (a.number == field::attrInts)
+                    a.repeated(attr.ints);
+                else
+                    a.skip();
+            }
+            node.attributes[name] = std::move(attr);
+            break;
+        }
+        default:
+            r.skip();
+        }
+    }
+    return node;
+}
+
+// name, element type and shape of a graph input or output
+struct ValueInfo {
+    string name;
+    int64_t elemType = 0;
+    Shape shape;
+};
+
+// the name of a graph output: its shape is inferred, so unknown or unbound
+// dimensions of the model do not matter
+string parseValueName(std::string_view bytes) {
+    string name;
+    ProtoReader r(bytes);
+    while (r.next()) {
+        if (r.number == field::valueName)
+            name = r.bytes();
+        else
+            r.skip();
+    }
+    return name;
+}
+
+ValueInfo parseValueInfo(std::string_view bytes,
+                         const std::map<string, int> &dims) {
+    ValueInfo info;
+    ProtoReader r(bytes);
+    while (r.next()) {
+        if (r.number == field::valueName) {
+            info.name = r.bytes();
+        } else if (r.number == field::valueType) {
+            ProtoReader type(r.bytes());
+            while (type.next()) {
+                if (type.number != field::typeTensor) {
+                    type.skip();
+                    continue;
+                }
+                ProtoReader tensor(type.bytes());
+                while (tensor.next()) {
+                    if (tensor.number == field::tensorTypeElem) {
+                        info.elemType = tensor.varint();
+                    } else if (tensor.number == field::tensorTypeShape) {
+                        ProtoReader shape(tensor.bytes());
+                        while (shape.next()) {
+                            if (shape.number != field::shapeDim) {
+                                shape.skip();
+                                continue;
+                            }
+                            optional<int> value;
+                            ProtoReader dim(shape.bytes());
+                            while (dim.next()) {
+                                if (dim.number == field::dimValue) {
+                                    value = int(dim.varint());
+                                } else if (dim.number == field::dimParam) {
+                                    string param(dim.bytes());
+                                    auto it = dims.find(param);
+                                    IT_ASSERT(it != dims.end(),
+                                              "No value for dimension " +
+                                                  param + " of " + info.name);
+                                    value = it->second;
+                                } else {
+                                    dim.skip();
+                                }
+                            }
+                            IT_ASSERT(value.has_value(),
+                                      "Unknown dimension of " + info.name);
+                            info.shape.emplace_back(*value);
+                        }
+                    } else {
+                        tensor.skip();
+                    }
+                }
+            }
+        } else {
+            r.skip();
+        }
+    }
+    return info;
+}
+
+// ONNX numbers its element types like `DataType`, up to bfloat16; the later
+// ones, strings and complex numbers have no kernels
+DataType dataType(int64_t type) {
+    IT_ASSERT(type > 0 && size_t(type) < std::size(DataType::names) &&
+                  !(DataType(type) == DataType::String) &&
+                  DataType(type).getSize() > 0,
+              "Unsupported ONNX element type " + std::to_string(type));
+    return DataType(type);
+}
+
+CastType castType(DataType from, DataType to) {
+    static const tuple<DataType, DataType, CastType> casts[] = {
+        {DataType::Float32, DataType::Float16, CastType::Float2Float16},
+        {DataType::Float32, DataType::Int64, CastType::Float2Int64},
+        {DataType::Float32, DataType::Int32, CastType::Float2Int32},
+        {DataType::Float32, DataType::Int16, CastType::Float2Int16},
+        {DataType::Float32, DataType::Int8, CastType::Float2Int8},
+        {DataType::Float32, DataType::BFloat16, CastType::Float2BFloat16},
+        {DataType::Int32, DataType::Float32, CastType::Int322Float},
+        {DataType::Int32, DataType::Int8, CastType::Int322Int8},
+        {DataType::Int32, DataType::Int16, CastType::Int322Int16},
+        {DataType::Int32, DataType::Int64, CastType::Int322Int64},
+        {DataType::Int16, DataType::Float32, CastType::Int162Float},
+        {DataType::Int16, DataType::Int32, CastType::Int162Int32},
+        {DataType::Int8, DataType::Float32, CastType::Int82Float},
+        {DataType::Int8, DataType::Int16, CastType::Int82Int16},
+        {DataType::Int8, DataType::Int32, CastType::Int82Int32},
+        {DataType::UInt8, DataType::Float32, CastType::Uint82Float},
+        {DataType::UInt8, DataType::Int32, CastType::Uint82Int32},
+        {DataType::UInt8, DataType::Int64, CastType::Uint82Int64},
+        {DataType::Int64, DataType::Int32, CastType::Int642Int32},
+        {DataType::Int64, DataType::UInt32, CastType::Int642Uint32},
+        {DataType::Int64, DataType::Float32, CastType::Int642Float},
+        {DataType::UInt32, DataType::Int64, CastType::Uint322Int64},
+        {DataType::Float16, DataType::Float32, CastType::Float162Float},
+        {DataType::BFloat16, DataType::Float32, CastType::BFloat162Float},
+        {DataType::Float32, DataType::Float32, CastType::Float2Float},
+    };
+    for (const auto &[a, b, type] : casts)
+        if (a == from && b == to)
+            return type;
+    IT_TODO_HALT_MSG("Unsupported Cast from " + from.toString() + " to " +
+                     to.toString());
+}
+
+class Importer {
+    Runtime runtime;
+    std::filesystem::path directory;
+    Ref<MappedFile> model;
+    // external data files, mapped once
+    std::map<string, Ref<MappedFile>> files;
+    // what keeps the data of every initializer alive
+    std::unordered_map<TensorObj *, Ref<void>> owners;
+
+  public:
+    OnnxModel result;
+
+    Importer(const string &path, Runtime runtime)
+        : runtime(runtime),
+          directory(std::filesystem::path(path).parent_path()),
+          model(make_ref<MappedFile>(path)) {
+        result.graph = make_ref<GraphObj>(runtime);
+    }
+
+    void import(const std::map<string, int> &dims) {
+        std::string_view graph;
+        ProtoReader r(std::string_view(model->data(), model->getSize()));
+        while (r.next()) {
+            if (r.number == field::modelGraph)
+                graph = r.bytes();
+            else
+                r.skip();
+        }
+        IT_ASSERT(!graph.empty(), "No graph in ONNX model");
+
+        vector<std::string_view> nodes, inputs, outputs;
+        ProtoReader g(graph);
+        while (g.next()) {
+            if (g.number == field::graphNode)
+                nodes.emplace_back(g.bytes());
+            else if (g.number == field::graphInitializer)
+                addInitializer(g.bytes());
+            else if (g.number == field::graphInput)
+                inputs.emplace_back(g.bytes());
+            else if (g.number == field::graphOutput)
+                outputs.emplace_back(g.bytes());
+            else
+                g.skip();
+        }
+        for (auto bytes : inputs) {
+            auto info = parseValueInfo(bytes, dims);
+            // older models list the initializers as inputs too
+            if (result.tensors.count(info.name))
+                continue;
+            auto t = result.graph->addTensor(info.shape,
+                                              dataType(info.elemType));
+            result.tensors[info.name] = t;
+            result.inputs.emplace_back(t);
+        }
+        // nodes are sorted topologically in ONNX models
+        for (auto bytes : nodes)
+            addNode(parseNode(bytes));
+        for (auto bytes : outputs)
+            result.outputs.emplace_back(get(parseValueName(bytes)));
+
+        // unused initializers, e.g. replaced by views of a higher rank
+        for (auto it = result.tensors.begin(); it != result.tensors.end();) {
+            auto t = it->second;
+            if (t->isWeight() && t->getTargets().empty()) {
+                result.graph->removeTensor(t);
+                owners.erase(t.get());
+                it = result.tensors.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+  private:
+    Tensor get(const string &name) const {
+        auto it = result.tensors.find(name);
+        IT_ASSERT(it != result.tensors.end(), "Unknown tensor " + name);
+        return it->second;
+    }
+
+    // a weight pointing to `ptr` in `file`, in place if it is aligned, else
+    // copied
+    void bindData(const Tensor &t, const char *ptr, size_t size,
+                  const Ref<MappedFile> &file) {
+        IT_ASSERT(size == t->getBytes(), "Bad size of initializer data");
+        void *data = const_cast<char *>(ptr);
+        Ref<void> owner = file;
+        if (!file ||
+            reinterpret_cast<uintptr_t>(ptr) % RuntimeObj::alignment != 0) {
+            data = runtime->alloc(size);
+            std::memcpy(data, ptr, size);
+            owner = Ref<void>(data, [runtime = runtime](void *p) {
+                runtime->dealloc(p);
+            });
+        }
+        t->setDataBlob(make_ref<BlobObj>(runtime, data, owner));
+        owners[t.get()] = owner;
+    }
+
+    void addInitializer(std::string_view bytes) {
+        string name;
+        Shape shape;
+        int64_t dtype = 0;
+        std::string_view raw;
+        bool external = false;
+        std::map<string, string> location;
+        vector<float> floats;
+        vector<int32_t> int32s;
+        vector<int64_t> int64s;
+        vector<int64_t> dims;
+        ProtoReader r(bytes);
+        while (r.next()) {
+            switch (r.number) {
+            case field::tensorDims:
+                r.repeated(dims);
+                break;
+            case field::tensorDataType:
+                dtype = r.varint();
+                break;
+            case field::tensorFloatData:
+                r.repeated(floats);
+                break;
+            case field::tensorInt32Data:
+                r.repeated(int32s);
+                break;
+            case field::tensorInt64Data:
+                r.repeated(int64s);
+                break;
+            case field::tensorName:
+                name = r.bytes();
+                break;
+            case field::tensorRawData:
+                raw = r.bytes();
+                break;
+            case field::tensorExternalData: {
+                string key, value;
+                ProtoReader entry(r.bytes());
+                while (entry.next()) {
+                    if (entry.number == field::entryKey)
+                        key = entry.bytes();
+                    else if (entry.number == field::entryValue)
+                        value = entry.bytes();
+                    else
+                        entry.skip();
+                }
+                location[key] = value;
+                break;
+            }
+            case field::tensorDataLocation:
+                external = r.varint() == 1;
+                break;
+            default:
+                r.skip();
+            }
+        }
+        for (auto d : dims)
+            shape.emplace_back(d);
+        auto t = result.graph->addTensor(shape, dataType(dtype));
+        t->setWeight();
+        result.tensors[name] = t;
+
+        if (external) {
+            auto &file = files[location["location"]];
+            if (!file)
+                file = make_ref<MappedFile>(
+                    (directory / location["location"]).string());
+            const auto number = [&](const string &key, size_t otherwise) {
+                if (!location.count(key))
+                    return otherwise;
+                const auto &value = location[key];
+                size_t ret = 0;
+                auto [end, error] = std::from_chars(
+                    value.data(), value.data() + value.size(), ret);
+                IT_ASSERT(!value.empty() && error == std::errc() &&
+                              end == value.data() + value.size(),
+                          "Bad external data " + key + " of " + name);
+                return ret;
+            };
+            auto offset = number("offset", 0);
+            auto length = number("length", t->getBytes());
+            IT_ASSERT(offset <= file->getSize() &&
+                          length <= file->getSize() - offset,
+                      "Truncated external data of " + name);
+            bindData(t, file->data() + offset, length, file);
+        } else if (!raw.empty() || t->size() == 0) {
+            bindData(t, raw.data(), raw.size(), model);
+        } else {
+            // typed fields are decoded, hence copied
+            const auto bind = [&](const auto &values) {
+                using T = typename std::decay_t<decltype(values)>::value_type;
+                IT_ASSERT(t->getDType().getSize() == sizeof(T),
+                          "Unsupported data of initializer " + name);
+                bindData(t, reinterpret_cast<const char *>(values.data()),
+                         values.size() * sizeof(T), nullptr);
+            };
+            if (!floats.empty())
+                bind(floats);
+            else if (!int64s.empty())
+                bind(int64s);
+            else if (!int32s.empty())
+                bind(int32s);
+            else
+                IT_TODO_HALT_MSG("No data for initializer " + name);
+        }
+    }
+
+    // the value of a scalar float initializer
+    optional<float> scalar(const Node &node, size_t i) const {
+        if (i >= node.inputs.size() || node.inputs[i].empty())
+            return std::nullopt;
+        auto t = get(node.inputs[i]);
+        IT_ASSERT(t->isWeight() && t->size() == 1 &&
+                      t->getDType() == DataType::Float32,
+                  node.opType + " bounds must be float constants");
+        return *t->getRawDataPtr<float *>();
+    }
+
+    // a view of an initializer with leading dimensions of size 1, since
+    // matmuls need operands of the same rank
+    Tensor expandRank(const Tensor &t, size_t rank) {
+        if (t->getRank() >= rank)
+            return t;
+        IT_ASSERT(t->isWeight(),
+                  "MatMul operands of different ranks must be initializers");
+        Shape shape(rank - t->getRank(), 1);
+        for (auto d : t->getDims())
+            shape.emplace_back(d);
+        auto view = result.graph->addTensor(shape, t->getDType());
+        view->setWeight();
+        view->setDataBlob(make_ref<BlobObj>(
+            runtime, t->getRawDataPtr<void *>(), owners.at(t.get())));
+        return view;
+    }
+
+    void addNode(const Node &node) {
+        auto &g = *result.graph;
+        TensorVec in;
+        for (const auto &name : node.inputs)
+            in.emplace_back(name.empty() ? nullptr : get(name));
+        const auto arity = [&](size_t n) {
+            IT_ASSERT(in.size() >= n && node.outputs.size() == 1,
+                      "Bad arity of " + node.opType);
+        };
+        const auto &type = node.opType;
+        Tensor out;
+        if (type == "Add" || type == "Sub" || type == "Mul" || type == "Div") {
+            arity(2);
+            if (type == "Add")
+                out = g.addOp<AddObj>(in[0], in[1], nullptr)->getOutput();
+            else if (type == "Sub")
+                out = g.addOp<SubObj>(in[0], in[1], nullptr)->getOutput();
+            else if (type == "Mul")
+                out = g.addOp<MulObj>(in[0], in[1], nullptr)->getOutput();
+            else
+                out = g.addOp<DivObj>(in[0], in[1], nullptr)->getOutput();
+        } else if (type == "Relu") {
+            arity(1);
+            out = g.addOp<ReluObj>(in[0], nullptr)->getOutput();
+        } else if (type == "MatMul") {
+            arity(2);
+            auto rank = std::max(in[0]->getRank(), in[1]->getRank());
+            IT_ASSERT(rank >= 2, "Unsupported MatMul of vectors");
+            out = g.addOp<MatmulObj>(expandRank(in[0], rank),
+                                     expandRank(in[1], rank), nullptr)
+                      ->getOutput();
+        } else if (type == "Gemm") {
+            arity(2);
+            IT_ASSERT(node.getFloat("alpha", 1) == 1 &&
+                          node.getFloat("beta", 1) == 1,
+                      "Unsupported Gemm with alpha or beta");
+            out = g.addOp<MatmulObj>(in[0], in[1], nullptr,
+                                     node.getInt("transA", 0),
+                                     node.getInt("transB", 0))
+                      ->getOutput();
+            if (in.size() > 2 && in[2])
+                out = g.addOp<AddObj>(out, in[2], nullptr)->getOutput();
+        } else if (type == "Transpose") {
+            arity(1);
+            vector<int> perm;
+            if (auto attr = node.find("perm"))
+                perm.assign(attr->ints.begin(), attr->ints.end());
+            else
+                for (int i = in[0]->getRank(); i > 0; --i)
+                    perm.emplace_back(i - 1);
+            out = g.addOp<TransposeObj>(in[0], nullptr, perm)->getOutput();
+        } else if (type == "Concat") {
+            IT_ASSERT(node.find("axis"), "Concat needs an axis");
+            out = g.addOp<ConcatObj>(in, nullptr, node.getInt("axis", 0))
+                      ->getOutput();
+        } else if (type == "Clip") {
+            arity(1);
+            // bounds are inputs since opset 11, attributes before
+            optional<float> min = scalar(node, 1), max = scalar(node, 2);
+            if (auto attr = node.find("min"))
+                min = attr->f;
+            if (auto attr = node.find("max"))
+                max = attr->f;
+            out = g.addOp<ClipObj>(in[0], nullptr, min, max)->getOutput();
+        } else if (type == "Cast") {
+            arity(1);
+            auto to = dataType(node.getInt("to", 0));
+            out = g.addOp<CastObj>(in[0], nullptr,
+                                   castType(in[0]->getDType(), to))
+                      ->getOutput();
+        } else {
+            IT_TODO_HALT_MSG("Unsupported ONNX node " + type);
+        }
+        result.tensors[node.outputs[0]] = out;
+    }
+};
+
+} // namespace
+
+OnnxModel loadOnnx(const string &path, Runtime runtime,
+                   const std::map<string, int> &dims) {
+    Importer importer(path, runtime);
+    importer.import(dims);
+    return std::move(importer.result);
+}
+
+} // namespace infini
@@ -18,6 +18,8 @@ const char *OpType::toString() const {
         CASE(Transpose);
         CASE(Concat);
         CASE(MatMul);
+        CASE(AllGather);
+        CASE(AllReduceSum);
 
     default:
         return "Unknown";
@@ -0,0 +1,192 @@
+#include "core/plan.h"
+#include "core/graph.h"
+
+namespace infini {
+
+namespace {
+// Runs kernels which cannot be prepared through `Kernel::compute`.
+struct FallbackArgs : KernelArgs {
+    Kernel *kernel;
+    Operator op;
+};
+
+void fallbackCompute(const KernelArgs *_args, void *const *data,
+                     const RuntimeObj *context) {
+    auto args = static_cast<const FallbackArgs *>(_args);
+    args->kernel->compute(args->op, context);
+}
+} // namespace
+
+PlanObj::PlanObj(const Graph &graph, const RuntimeObj *context)
+    : graph(graph), arena(graph->getArena()),
+      arenaSize(graph->getArenaSize()), relocatable(true) {
+    IT_ASSERT(graph->topo_sort() == true);
+    const auto &kernelRegistry = KernelRegistry::getInstance();
+    const auto device = context->getDevice();
+
+    for (auto &op : graph->getOperators()) {
+        auto kernelAttrs = KernelAttrs{device, op->getOpType().underlying()};
+        Kernel *kernel = kernelRegistry.getKernel(kernelAttrs);
+        IT_ASSERT(kernel->getWorkspaceSize(op) <= op->getWorkspaceSize(),
+                  "The workspace of the op is not allocated");
+        auto [func, arg] = kernel->prepare(op, context);
+        if (!func) {
+            auto fallback = make_ref<FallbackArgs>();
+            fallback->kernel = kernel;
+            fallback->op = op;
+            func = fallbackCompute;
+            arg = fallback;
+            relocatable = false;
+        }
+        steps.push_back({func, arg.get(), data.size()});
+        for (const auto *list : {&op->getInputs(), &op->getOutputs()}) {
+            for (auto &t : *list) {
+                // bound tensors are set by the contexts running the plan
+                if (t->isBound()) {
+                    slots[t.get()].emplace_back(data.size());
+                    data.emplace_back(t->hasData() ? t->getRawDataPtr<void *>()
+                                                   : nullptr);
+                } else {
+                    data.emplace_back(t->getRawDataPtr<void *>());
+                }
+            }
+        }
+        data.emplace_back(op->getWorkspace());
+        ops.emplace_back(op);
+        args.emplace_back(arg);
+    }
+    buildDependencies();
+}
+
+void PlanObj::buildDependencies() {
+    // Replays the steps in order and tracks, for every byte range of the
+    // arena, the step which wrote it last and the steps which read it since.
+    // A step depends on the last writer of what it reads, and on the last
+    // writer and readers of what it overwrites. Workspaces are overwritten
+    // by their op.
+    struct Range {
+        uintptr_t end;
+        optional<size_t> writer;
+        vector<size_t> readers;
+    };
+    std::map<uintptr_t, Range> ranges;
+    const auto n = steps.size();
+    successors.assign(n, {});
+    dependencies.assign(n, 0);
+    vector<size_t> mark(n, n);
+    const auto depend = [&](size_t from, size_t to) {
+        if (from != to && mark[from] != to) {
+            mark[from] = to;
+            successors[from].emplace_back(to);
+            dependencies[to]++;
+        }
+    };
+    // first range which may overlap [begin, end)
+    const auto first = [&](uintptr_t begin) {
+        auto it = ranges.upper_bound(begin);
+        if (it != ranges.begin() && std::prev(it)->second.end > begin)
+            --it;
+        return it;
+    };
+
+    // bound tensors are graph inputs, only read, or graph outputs, only
+    // written by their source, so they add no dependencies
+    for (size_t i = 0; i < n; ++i) {
+        for (auto &input : ops[i]->getInputs()) {
+            if (input->isBound())
+                continue;
+            auto begin =
+                reinterpret_cast<uintptr_t>(input->getRawDataPtr<void *>());
+            auto end = begin + input->getBytes();
+            for (auto it = first(begin); it != ranges.end() && it->first < end;
+                 ++it) {
+                if (it->second.writer)
+                    depend(*it->second.writer, i);
+                it->second.readers.emplace_back(i);
+            }
+        }
+        vector<pair<uintptr_t, uintptr_t>> written;
+        for (auto &output : ops[i]->getOutputs()) {
+            if (output->isBound())
+                continue;
+            auto begin =
+                reinterpret_cast<uintptr_t>(output->getRawDataPtr<void *>());
+            written.emplace_back(begin, begin + output->getBytes());
+        }
+        if (auto size = ops[i]->getWorkspaceSize()) {
+            auto begin = reinterpret_cast<uintptr_t>(ops[i]->getWorkspace());
+            written.emplace_back(begin, begin + size);
+        }
+        for (auto [begin, end] : written) {
+            auto it = first(begin);
+            while (it != ranges.end() && it->first < end) {
+                auto [b, range] = *it;
+                if (range.writer)
+                    depend(*range.writer, i);
+                for (auto r : range.readers)
+                    depend(r, i);
+                it = ranges.erase(it);
+                // keep the parts which are not overwritten
+                if (b < begin)
+                    ranges.emplace(b, Range{begin, range.writer,
+                                            range.readers});
+                if (range.end > end)
+                    it = ranges.emplace(end, Range{range.end, range.writer,
+                                                   range.readers})
+                             .first;
+            }
+            ranges.emplace(begin, Range{end, i, {}});
+        }
+    }
+
+    // steps are in topological order, so depths can be computed in one pass
+    vector<size_t> depth(n, 0), count(n + 1, 0);
+    width = 0;
+    for (size_t i = 0; i < n; ++i) {
+        width = std::max(width, ++count[depth[i]]);
+        for (auto s : successors[i])
+            depth[s] = std::max(depth[s], depth[i] + 1);
+    }
+}
+
+void PlanObj::runProfiled(size_t i, const RuntimeObj *context,
+                          void *const *data, Profiler &profiler) const {
+    const auto &step = steps[i];
+    auto begin = Profiler::Clock::now();
+    step.func(step.args, data + step.offset, context);
+    profiler.record(ops[i], begin, Profiler::Clock::now());
+}
+
+const vector<size_t> &PlanObj::getSlots(const Tensor &tensor) const {
+    auto it = slots.find(tensor.get());
+    IT_ASSERT(it != slots.end(), "The tensor is not bound in the plan");
+    return it->second;
+}
+
+void PlanObj::checkBound(void *const *data) const {
+    for (const auto &[tensor, positions] : slots)
+        for (auto i : positions)
+            IT_ASSERT(data[i] != nullptr, "A bound tensor has no data");
+}
+
+string PlanObj::toString() const {
+    std::ostringstream oss;
+    oss << "Plan " << guid << ", " << steps.size() << " steps:\n";
+    for (const auto &op : ops)
+        oss << op << "\n";
+    return oss.str();
+}
+
+Plan PlanCache::get(const std::map<Tensor, Shape> &shapes) {
+    graph->resize(shapes);
+    vector<Shape> key;
+    for (const auto &in : graph->getInputs())
+        key.emplace_back(in->getDims());
+    auto &plan = plans[key];
+    // plans point into the arena, which moves when it grows
+    if (!plan || plan->getArena() != graph->getArena())
+        plan = context->compile(graph);
+    return plan;
+}
+
+} // namespace infini
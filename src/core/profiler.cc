@@ -0,0 +1,132 @@
+#include "core/profiler.h"
+#include "operators/matmul.h"
+#include <iomanip>
+#include <map>
+
+namespace infini {
+
+void Profiler::record(const Operator &op, Clock::time_point begin,
+                      Clock::time_point end) {
+    using us = std::chrono::duration<double, std::micro>;
+    Record r;
+    r.type = op->getOpType();
+    r.guid = op->getGuid();
+    const auto shapes = [](const TensorVec &tensors) {
+        vector<string> ret;
+        for (const auto &t : tensors)
+            ret.emplace_back(vecToString(t->getDims()));
+        return vecToString(ret);
+    };
+    r.inputs = shapes(op->getInputs());
+    r.outputs = shapes(op->getOutputs());
+    r.bytes = estimateBytes(op);
+    r.flops = estimateFlops(op);
+    r.start = us(begin - origin).count();
+    r.duration = us(end - begin).count();
+
+    std::lock_guard<std::mutex> guard(lock);
+    r.thread = threads.try_emplace(std::this_thread::get_id(), threads.size())
+                   .first->second;
+    records.emplace_back(std::move(r));
+}
+
+vector<Profiler::Record> Profiler::getRecords() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return records;
+}
+
+void Profiler::clear() {
+    std::lock_guard<std::mutex> guard(lock);
+    records.clear();
+}
+
+string Profiler::summary() const {
+    struct Total {
+        OpType type = OpType::Unknown;
+        size_t count = 0, bytes = 0, flops = 0;
+        double time = 0;
+    };
+    std::map<OpType::underlying_t, Total> totals;
+    double time = 0;
+    for (const auto &r : getRecords()) {
+        auto &t = totals[r.type.underlying()];
+        t.type = r.type;
+        t.count++;
+        t.bytes += r.bytes;
+        t.flops += r.flops;
+        t.time += r.duration;
+        time += r.duration;
+    }
+    vector<Total> sorted;
+    for (const auto &[_, t] : totals)
+        sorted.emplace_back(t);
+    std::sort(sorted.begin(), sorted.end(),
+              [](const Total &a, const Total &b) { return a.time > b.time; });
+
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(2) << std::left << std::setw(16)
+        << "OpType" << std::right << std::setw(8) << "Count" << std::setw(14)
+        << "Total(us)" << std::setw(12) << "Mean(us)" << std::setw(9) << "%"
+        << std::setw(10) << "GB/s" << std::setw(10) << "GFLOP/s" << "\n";
+    for (const auto &t : sorted) {
+        // bytes per microsecond are megabytes per second
+        auto rate = [&](size_t n) {
+            return t.time > 0 ? n / t.time / 1e3 : 0;
+        };
+        oss << std::left << std::setw(16) << t.type.toString() << std::right
+            << std::setw(8) << t.count << std::setw(14) << t.time
+            << std::setw(12) << t.time / t.count << std::setw(9)
+            << (time > 0 ? 100 * t.time / time : 0) << std::setw(10)
+            << rate(t.bytes) << std::setw(10) << rate(t.flops) << "\n";
+    }
+    oss << std::left << std::setw(16) << "Total" << std::right << std::setw(22)
+        << time << "\n";
+    return oss.str();
+}
+
+string Profiler::toChromeTrace() const {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+    bool first = true;
+    for (const auto &r : getRecords()) {
+        oss << (first ? "\n" : ",\n") << "{\"name\":\"" << r.type.toString()
+            << "\",\"cat\":\"op\",\"ph\":\"X\",\"pid\":0,\"tid\":" << r.thread
+            << ",\"ts\":" << r.start << ",\"dur\":" << r.duration
+            << ",\"args\":{\"guid\":" << r.guid << ",\"inputs\":\""
+            << r.inputs << "\",\"outputs\":\"" << r.outputs
+            << "\",\"bytes\":" << r.bytes << ",\"flops\":" << r.flops << "}}";
+        first = false;
+    }
+    oss << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return oss.str();
+}
+
+size_t Profiler::estimateFlops(const Operator &op) {
+    switch (op->getOpType().underlying()) {
+    case OpType::MatMul: {
+        // the output has m x k elements per batch, each a dot product of n
+        auto matmul = as<MatmulObj>(op);
+        return 2 * matmul->getOutput()->size() * matmul->getN();
+    }
+    case OpType::Add:
+    case OpType::Sub:
+    case OpType::Mul:
+    case OpType::Div:
+    case OpType::Relu:
+    case OpType::Clip:
+        return op->getOutput()->size();
+    default:
+        return 0;
+    }
+}
+
+size_t Profiler::estimateBytes(const Operator &op) {
+    size_t bytes = 0;
+    for (const auto &t : op->getInputs())
+        bytes += t->getBytes();
+    for (const auto &t : op->getOutputs())
+        bytes += t->getBytes();
+    return bytes;
+}
+
+} // namespace infini
@@ -1,10 +1,15 @@
 #include "core/runtime.h"
 #include "core/blob.h"
+#include "core/context.h"
 #include "core/graph.h"
 #include "core/kernel.h"
+#include "core/plan.h"
+#include "core/profiler.h"
 #include <chrono>
 #include <cstring>
 #include <memory>
+#include <sys/mman.h>
+#include <unistd.h>
 namespace infini {
 void NativeCpuRuntimeObj::run(const Graph &graph) const {
     const auto &kernelRegistry = KernelRegistry::getInstance();
@@ -12,17 +17,216 @@ void NativeCpuRuntimeObj::run(const Graph &graph) const {
     for (auto &op : graph->getOperators()) {
         auto kernelAttrs = KernelAttrs{device, op->getOpType().underlying()};
         Kernel *kernel = kernelRegistry.getKernel(kernelAttrs);
-        kernel->compute(op, this);
+        if (!profiler) {
+            kernel->compute(op, this);
+        } else {
+            auto begin = Profiler::Clock::now();
+            kernel->compute(op, this);
+            profiler->record(op, begin, Profiler::Clock::now());
+        }
     }
 }
 
+void NativeCpuRuntimeObj::run(const Plan &plan) const {
+    run(*plan, plan->getData().data());
+}
+
+void NativeCpuRuntimeObj::run(const Context &context) const {
+    run(*context->getPlan(), context->getData().data());
+}
+
+void NativeCpuRuntimeObj::run(const PlanObj &plan, void *const *data) const {
+    plan.checkBound(data);
+    auto config = parallelConfig;
+    if (config.interOp == 0)
+        config.interOp =
+            ParallelConfig::split(std::thread::hardware_concurrency(),
+                                  plan.getWidth())
+                .interOp;
+    if (config.interOp <= 1) {
+        plan.run(this, data, profiler.get());
+        return;
+    }
+    getScheduler(config)->run(plan, data, this, profiler.get());
+}
+
+void NativeCpuRuntimeObj::setParallelConfig(const ParallelConfig &config) {
+    IT_ASSERT(config.interOp >= 0 && config.intraOp >= 0);
+    parallelConfig = config;
+    if (config.intraOp > 0 && config.intraOp != threadPool->getThreads()) {
+        auto poolConfig = threadPool->getConfig();
+        poolConfig.threads = config.intraOp;
+        setThreadPool(poolConfig);
+    }
+}
+
+Ref<Scheduler>
+NativeCpuRuntimeObj::getScheduler(const ParallelConfig &config) const {
+    std::lock_guard<std::mutex> guard(schedulerLock);
+    if (!scheduler || scheduler->getThreads() != config.interOp)
+        scheduler = make_ref<Scheduler>(config.interOp);
+    return scheduler;
+}
+
+Plan RuntimeObj::compile(const Graph &graph) const {
+    return make_ref<PlanObj>(graph, this);
+}
+
+std::future<void> RuntimeObj::runAsync(const Context &context) const {
+    auto promise = std::make_shared<std::promise<void>>();
+    auto future = promise->get_future();
+    runAsync(context, [promise](std::exception_ptr error) {
+        if (error)
+            promise->set_exception(error);
+        else
+            promise->set_value();
+    });
+    return future;
+}
+
+void RuntimeObj::runAsync(
+    const Context &context,
+    std::function<void(std::exception_ptr)> callback) const {
+    std::lock_guard<std::mutex> guard(executorLock);
+    if (!executor)
+        executor = std::make_unique<Executor>();
+    executor->submit([this, context, callback = std::move(callback)] {
+        std::exception_ptr error;
+        try {
+            run(context);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        callback(error);
+    });
+}
+
+void RuntimeObj::stopAsync() {
+    std::unique_ptr<Executor> pending;
+    {
+        std::lock_guard<std::mutex> guard(executorLock);
+        pending = std::move(executor);
+    }
+    // joins after the queued requests, which may still submit new ones
+    pending.reset();
+}
+
 string NativeCpuRuntimeObj::toString() const { return "CPU Runtime"; }
 
-void NativeCpuRuntimeObj::dealloc(void *ptr) { return free(ptr); }
+namespace {
+
+constexpr size_t hugePageSize = 2 << 20;
+
+size_t roundUp(size_t size, size_t alignment) {
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+void NativeCpuRuntimeObj::dealloc(void *ptr) {
+    if (ptr == nullptr)
+        return;
+    size_t size;
+    {
+        std::lock_guard<std::mutex> guard(blocksLock);
+        auto it = blocks.find(ptr);
+        IT_ASSERT(it != blocks.end(), "Deallocating an unknown block");
+        size = it->second;
+        blocks.erase(it);
+    }
+    if (size == 0)
+        free(ptr);
+    else
+        munmap(ptr, size);
+}
 
 void *NativeCpuRuntimeObj::alloc(size_t size) {
-    return calloc((size + sizeof(uint64_t) - 1) / sizeof(uint64_t),
-                  sizeof(uint64_t));
+    // the memory is not zeroed: every tensor is written before it is read,
+    // and fresh mappings are zero-filled by the kernel anyway
+    size = roundUp(std::max<size_t>(size, 1), alignment);
+    void *ptr;
+    if (size < memoryConfig.mmapThreshold) {
+        ptr = aligned_alloc(alignment, size);
+        IT_ASSERT(ptr != nullptr, "Out of memory");
+        size = 0;
+    } else {
+        ptr = map(size);
+    }
+    return record(ptr, size);
+}
+
+void *NativeCpuRuntimeObj::allocPages(size_t size) {
+    size = roundUp(std::max<size_t>(size, 1), size_t(sysconf(_SC_PAGESIZE)));
+    auto ptr = map(size);
+    return record(ptr, size);
+}
+
+void *NativeCpuRuntimeObj::record(void *ptr, size_t size) {
+    std::lock_guard<std::mutex> guard(blocksLock);
+    blocks.emplace(ptr, size);
+    return ptr;
+}
+
+void NativeCpuRuntimeObj::protect(void *ptr, bool readOnly) {
+    size_t size;
+    {
+        std::lock_guard<std::mutex> guard(blocksLock);
+        auto it = blocks.find(ptr);
+        IT_ASSERT(it != blocks.end() && it->second > 0,
+                  "Only blocks from allocPages can be protected");
+        size = it->second;
+    }
+    auto prot = readOnly ? PROT_READ : PROT_READ | PROT_WRITE;
+    IT_ASSERT(mprotect(ptr, size, prot) == 0, "mprotect failed");
+}
+
+void *NativeCpuRuntimeObj::map(size_t &size) {
+    const int prot = PROT_READ | PROT_WRITE;
+    const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    void *ptr = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if (memoryConfig.explicitHugePages) {
+        auto hugeSize = roundUp(size, hugePageSize);
+        ptr = mmap(nullptr, hugeSize, prot, flags | MAP_HUGETLB, -1, 0);
+        if (ptr != MAP_FAILED)
+            size = hugeSize;
+    }
+#endif
+    if (ptr == MAP_FAILED && memoryConfig.hugePages && size >= hugePageSize) {
+        // transparent huge pages only back aligned ranges, so over-map by one
+        // huge page and trim the unaligned head and tail
+        size = roundUp(size, hugePageSize);
+        auto raw = mmap(nullptr, size + hugePageSize, prot, flags, -1, 0);
+        IT_ASSERT(raw != MAP_FAILED, "Out of memory");
+        auto begin = reinterpret_cast<uintptr_t>(raw);
+        auto aligned = roundUp(begin, hugePageSize);
+        if (aligned > begin)
+            munmap(raw, aligned - begin);
+        if (auto tail = begin + hugePageSize - aligned; tail > 0)
+            munmap(reinterpret_cast<void *>(aligned + size), tail);
+        ptr = reinterpret_cast<void *>(aligned);
+#ifdef MADV_HUGEPAGE
+        // only a hint, the kernel may have THP disabled
+        madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+    }
+    if (ptr == MAP_FAILED) {
+        ptr = mmap(nullptr, size, prot, flags, -1, 0);
+        IT_ASSERT(ptr != MAP_FAILED, "Out of memory");
+    }
+    if (memoryConfig.prefault)
+        prefault(ptr, size);
+    return ptr;
+}
+
+void NativeCpuRuntimeObj::prefault(void *ptr, size_t size) const {
+    const auto pageSize = size_t(sysconf(_SC_PAGESIZE));
+    auto bytes = static_cast<volatile char *>(ptr);
+    // contiguous ranges of pages per thread, as kernels split their loops
+    parallelFor(0, size / pageSize, 0, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            bytes[i * pageSize] = 0;
+    });
 }
 
 } // namespace infini
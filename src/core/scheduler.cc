@@ -0,0 +1,155 @@
+#include "core/scheduler.h"
+#include "core/plan.h"
+
+namespace infini {
+
+ParallelConfig ParallelConfig::split(int cores, int width) {
+    cores = std::max(cores, 1);
+    ParallelConfig config;
+    config.interOp = std::clamp(width, 1, cores);
+    config.intraOp = std::max(cores / config.interOp, 1);
+    return config;
+}
+
+Scheduler::Scheduler(int nThreads) {
+    IT_ASSERT(nThreads >= 1);
+    for (int i = 0; i < nThreads; ++i)
+        queues.emplace_back(std::make_unique<Queue>());
+    // the thread calling `run` works as the first worker
+    for (int i = 1; i < nThreads; ++i)
+        threads.emplace_back([this, i] { workerLoop(i); });
+}
+
+Scheduler::~Scheduler() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stop = true;
+    }
+    wake.notify_all();
+    for (auto &thread : threads)
+        thread.join();
+}
+
+void Scheduler::run(const PlanObj &plan, void *const *data,
+                    const RuntimeObj *context, Profiler *profiler) {
+    std::lock_guard<std::mutex> runGuard(runLock);
+    const auto n = plan.getSteps().size();
+    if (n == 0)
+        return;
+    pending = std::make_unique<std::atomic<size_t>[]>(n);
+    for (size_t i = 0; i < n; ++i)
+        pending[i] = plan.getDependencies(i);
+    failed = false;
+    error = nullptr;
+    remaining = n;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        this->plan = &plan;
+        this->data = data;
+        this->context = context;
+        this->profiler = profiler;
+    }
+    // spread the initially ready steps over all the queues
+    for (size_t i = 0, k = 0; i < n; ++i)
+        if (plan.getDependencies(i) == 0)
+            push(k++ % queues.size(), i);
+
+    work(0);
+
+    {
+        // wait for the other workers to leave this run
+        std::unique_lock<std::mutex> guard(lock);
+        wake.wait(guard, [this] { return active == 0; });
+        this->plan = nullptr;
+        this->data = nullptr;
+        this->context = nullptr;
+    }
+    if (error)
+        std::rethrow_exception(error);
+}
+
+void Scheduler::workerLoop(int id) {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [this] { return stop || (plan && queued > 0); });
+            if (stop)
+                return;
+            active++;
+        }
+        work(id);
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            active--;
+        }
+        wake.notify_all();
+    }
+}
+
+void Scheduler::work(int id) {
+    size_t step;
+    while (remaining > 0) {
+        if (pop(id, step)) {
+            execute(id, step);
+            continue;
+        }
+        std::unique_lock<std::mutex> guard(lock);
+        wake.wait(guard, [this] { return queued > 0 || remaining == 0; });
+    }
+}
+
+bool Scheduler::pop(int id, size_t &step) {
+    const auto n = queues.size();
+    for (size_t k = 0; k < n; ++k) {
+        auto &queue = *queues[(id + k) % n];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (queue.steps.empty())
+            continue;
+        // LIFO on the own queue keeps the data of the producer hot, FIFO
+        // when stealing takes the oldest and usually largest piece of work
+        if (k == 0) {
+            step = queue.steps.back();
+            queue.steps.pop_back();
+        } else {
+            step = queue.steps.front();
+            queue.steps.pop_front();
+        }
+        queued--;
+        return true;
+    }
+    return false;
+}
+
+void Scheduler::push(int id, size_t step) {
+    {
+        auto &queue = *queues[id];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        queue.steps.push_back(step);
+    }
+    queued++;
+    // synchronize with threads checking `queued` before they sleep
+    { std::lock_guard<std::mutex> guard(lock); }
+    wake.notify_one();
+}
+
+void Scheduler::execute(int id, size_t i) {
+    // after a failure the remaining steps are only drained
+    if (!failed) {
+        try {
+            plan->runStep(i, context, data, profiler);
+        } catch (...) {
+            std::lock_guard<std::mutex> guard(lock);
+            if (!failed.exchange(true))
+                error = std::current_exception();
+        }
+    }
+    for (auto s : plan->getSuccessors(i))
+        if (--pending[s] == 0)
+            push(id, s);
+    if (--remaining == 0) {
+        { std::lock_guard<std::mutex> guard(lock); }
+        wake.notify_all();
+    }
+}
+
+} // namespace infini
@@ -13,6 +13,39 @@ TensorObj::TensorObj(Shape shape_, DataType dtype, Runtime runtime)
       _size(std::accumulate(shape.begin(), shape.end(), 1, std::multiplies{})) {
 }
 
+const char *toString(TensorType type) {
+    switch (type) {
+    case TensorType::Activation:
+        return "Activation";
+    case TensorType::Input:
+        return "Input";
+    case TensorType::Output:
+        return "Output";
+    case TensorType::Weight:
+        return "Weight";
+    case TensorType::Constant:
+        return "Constant";
+    }
+    IT_TODO_HALT();
+}
+
+TensorType TensorObj::getTensorType() const {
+    if (isWeight())
+        return type;
+    if (!getSource())
+        return TensorType::Input;
+    if (targets.empty())
+        return TensorType::Output;
+    return TensorType::Activation;
+}
+
+void TensorObj::setTensorType(TensorType type_) {
+    IT_ASSERT(type_ == TensorType::Weight || type_ == TensorType::Constant ||
+                  type_ == TensorType::Activation,
+              "Inputs and outputs follow from the graph");
+    type = type_;
+}
+
 string TensorObj::toString() const {
     // Convert data pointer to string
     std::stringstream ss;
@@ -22,7 +55,9 @@ string TensorObj::toString() const {
         ss << "nullptr data";
     string ret = "Tensor " + std::to_string(guid) + ", Fuid " +
                  std::to_string(fuid) + ", shape " + vecToString(shape) +
-                 ", dtype " + dtype.toString() + ", " + runtime->toString() +
+                 ", dtype " + dtype.toString() + ", " +
+                 infini::toString(getTensorType()) + ", " +
+                 runtime->toString() +
                  ", " + ss.str() + "\n";
     vector<UidBaseType> targetGuids;
     for (const auto &op : targets)
@@ -0,0 +1,217 @@
+#include "core/tensor_parallel.h"
+#include "core/runtime.h"
+#include "operators/collective.h"
+#include "operators/element_wise.h"
+#include "operators/matmul.h"
+#include "operators/unary.h"
+#include <cstring>
+#include <numeric>
+
+namespace infini {
+
+namespace {
+
+class Sharder {
+    Graph source, graph;
+    Communicator comm;
+    Runtime runtime;
+    int ranks;
+
+    struct Local {
+        Tensor tensor;
+        // split along the last axis, the process holding its `rank`th part
+        bool sharded;
+    };
+    std::unordered_map<TensorObj *, Local> locals;
+
+  public:
+    Sharder(const Graph &source, const Communicator &comm)
+        : source(source), comm(comm), runtime(source->getRuntime()),
+          ranks(comm->getWorldSize()) {
+        graph = make_ref<GraphObj>(runtime);
+    }
+
+    ShardedGraph run() {
+        IT_ASSERT(source->topo_sort(), "The graph to shard has a cycle");
+        ShardedGraph ret{graph, {}, {}};
+        for (const auto &t : source->getInputs())
+            if (!t->isWeight()) {
+                auto local = graph->addTensor(t->getDims(), t->getDType());
+                locals[t.get()] = {local, false};
+                ret.inputs.emplace_back(local);
+            }
+        for (const auto &op : source->getOperators()) {
+            if (op->getOpType() == OpType::MatMul && shardMatmul(op))
+                continue;
+            if (shardElementWise(op))
+                continue;
+            TensorVec inputs;
+            for (const auto &input : op->getInputs())
+                inputs.emplace_back(whole(input));
+            graph->cloneOperator(op, inputs, addOutputs(op, false));
+        }
+        for (const auto &t : source->getOutputs())
+            ret.outputs.emplace_back(whole(t));
+        return ret;
+    }
+
+  private:
+    bool isSharded(const Tensor &t) const {
+        auto it = locals.find(t.get());
+        return it != locals.end() && it->second.sharded;
+    }
+
+    Shape shardShape(Shape dims) const {
+        dims.back() /= ranks;
+        return dims;
+    }
+
+    bool divisible(const Tensor &t) const {
+        return t->getRank() > 0 && t->getDims().back() % ranks == 0;
+    }
+
+    TensorVec addOutputs(const Operator &op, bool sharded) {
+        TensorVec ret;
+        for (const auto &output : op->getOutputs()) {
+            auto dims = output->getDims();
+            auto local = graph->addTensor(sharded ? shardShape(dims) : dims,
+                                          output->getDType());
+            locals[output.get()] = {local, sharded};
+            ret.emplace_back(local);
+        }
+        return ret;
+    }
+
+    // `t` whole, gathered once if it is sharded
+    Tensor whole(const Tensor &t) {
+        auto it = locals.find(t.get());
+        if (it == locals.end()) {
+            IT_ASSERT(t->isWeight() && t->hasData(),
+                      "The weights of the graph to shard must be filled");
+            auto local = graph->addTensor(t->getDims(), t->getDType());
+            local->setTensorType(t->getTensorType());
+            auto ptr = t->getRawDataPtr<void *>();
+            local->setDataBlob(
+                make_ref<BlobObj>(runtime, ptr, Ref<void>(source, ptr)));
+            it = locals.emplace(t.get(), Local{local, false}).first;
+        } else if (it->second.sharded) {
+            auto &local = it->second;
+            local.tensor =
+                graph
+                    ->addOp<AllGatherObj>(local.tensor, nullptr, comm,
+                                          int(local.tensor->getRank()) - 1)
+                    ->getOutput();
+            local.sharded = false;
+        }
+        return it->second.tensor;
+    }
+
+    // the `rank`th of the equal parts of the weight `t` along `axis`
+    Tensor slice(const Tensor &t, int axis) {
+        IT_ASSERT(t->hasData(),
+                  "The weights of the graph to shard must be filled");
+        auto dims = t->getDims();
+        const size_t outer = std::accumulate(dims.begin(), dims.begin() + axis,
+                                             size_t(1), std::multiplies<>());
+        const size_t inner = std::accumulate(
+            dims.begin() + axis + 1, dims.end(), t->getDType().getSize(),
+            std::multiplies<>());
+        const size_t full = dims[axis], length = full / ranks;
+        dims[axis] = length;
+        auto local = graph->addTensor(dims, t->getDType());
+        local->setTensorType(t->getTensorType());
+        auto src = t->getRawDataPtr<const char *>() +
+                   comm->getRank() * length * inner;
+        auto data = static_cast<char *>(runtime->alloc(local->getBytes()));
+        for (size_t i = 0; i < outer; ++i)
+            std::memcpy(data + i * length * inner, src + i * full * inner,
+                        length * inner);
+        Ref<void> owner(data, [runtime = runtime](void *p) {
+            runtime->dealloc(p);
+        });
+        local->setDataBlob(make_ref<BlobObj>(runtime, data, owner));
+        return local;
+    }
+
+    bool shardMatmul(const Operator &_op) {
+        auto op = as<MatmulObj>(_op);
+        auto a = op->getInputs(0), b = op->getInputs(1);
+        const int rank = b->getRank();
+        if (op->numInputs() != 2 || !b->isWeight() ||
+            a->getRank() != b->getRank())
+            return false;
+        auto dims = b->getDims();
+        for (int i = 0; i < rank - 2; ++i)
+            if (dims[i] != 1)
+                return false;
+        const auto transB = op->getTransB();
+        if (isSharded(a) && !op->getTransA() && op->getN() % ranks == 0) {
+            // row-parallel: the sharded axis of A is the reduced one
+            auto c = graph
+                         ->addOp<MatmulObj>(locals[a.get()].tensor,
+                                            slice(b, transB ? rank - 1
+                                                            : rank - 2),
+                                            nullptr, false, transB)
+                         ->getOutput();
+            auto sum = graph->addOp<AllReduceSumObj>(c, nullptr, comm);
+            locals[op->getOutput().get()] = {sum->getOutput(), false};
+            return true;
+        }
+        if (op->getK() % ranks != 0)
+            return false;
+        // column-parallel
+        auto c = graph
+                     ->addOp<MatmulObj>(whole(a),
+                                        slice(b, transB ? rank - 2 : rank - 1),
+                                        nullptr, op->getTransA(), transB)
+                     ->getOutput();
+        locals[op->getOutput().get()] = {c, true};
+        return true;
+    }
+
+    // an element-wise op on a shard, instead of gathering it
+    bool shardElementWise(const Operator &op) {
+        if (op->numOutputs() != 1 || !divisible(op->getOutput()))
+            return false;
+        const auto last = op->getOutput()->getDims().back();
+        if (as<UnaryObj>(op) || as<ClipObj>(op) || as<CastObj>(op)) {
+            if (!isSharded(op->getInputs(0)))
+                return false;
+            graph->cloneOperator(op, {locals[op->getInputs(0).get()].tensor},
+                                 addOutputs(op, true));
+            return true;
+        }
+        if (!as<ElementWiseObj>(op))
+            return false;
+        bool anySharded = false;
+        for (const auto &input : op->getInputs()) {
+            // the other inputs must be weights, sliced as well unless they
+            // are broadcast along the last axis
+            if (isSharded(input))
+                anySharded = true;
+            else if (!input->isWeight())
+                return false;
+        }
+        if (!anySharded)
+            return false;
+        TensorVec inputs;
+        for (const auto &input : op->getInputs()) {
+            if (isSharded(input))
+                inputs.emplace_back(locals[input.get()].tensor);
+            else if (input->getRank() > 0 && input->getDims().back() == last)
+                inputs.emplace_back(slice(input, input->getRank() - 1));
+            else
+                inputs.emplace_back(whole(input));
+        }
+        graph->cloneOperator(op, inputs, addOutputs(op, true));
+        return true;
+    }
+};
+
+} // namespace
+
+ShardedGraph shardGraph(const Graph &graph, const Communicator &comm) {
+    return Sharder(graph, comm).run();
+}
+
+} // namespace infini
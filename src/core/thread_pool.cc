@@ -0,0 +1,117 @@
+#include "core/thread_pool.h"
+#include <pthread.h>
+
+namespace infini {
+
+namespace {
+thread_local bool inPool = false;
+
+void pin(std::thread &thread, int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    IT_ASSERT(pthread_setaffinity_np(thread.native_handle(), sizeof(set),
+                                     &set) == 0,
+              "Failed to pin a thread to cpu " + std::to_string(cpu));
+}
+} // namespace
+
+ThreadPool::ThreadPool(const ThreadPoolConfig &config) : config(config) {
+    nThreads = config.threads > 0 ? config.threads
+                                  : std::thread::hardware_concurrency();
+    nThreads = std::max(nThreads, 1);
+    // the thread calling `parallelFor` runs chunks as well
+    for (int i = 1; i < nThreads; ++i) {
+        workers.emplace_back([this, i] { workerLoop(i); });
+        if (!config.cpus.empty())
+            pin(workers.back(), config.cpus[(i - 1) % config.cpus.size()]);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stop = true;
+    }
+    wake.notify_all();
+    for (auto &worker : workers)
+        worker.join();
+}
+
+void ThreadPool::parallelFor(size_t begin, size_t end, size_t grain,
+                             const Body &body) {
+    if (begin >= end)
+        return;
+    const auto n = end - begin;
+    if (grain == 0)
+        grain = config.grain;
+    const auto chunks = std::min<size_t>(nThreads, (n + grain - 1) / grain);
+    std::unique_lock<std::mutex> region(regionLock, std::defer_lock);
+    if (chunks <= 1 || inPool || !region.try_lock()) {
+        body(begin, end);
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        // workers may still be leaving the previous region
+        while (active > 0) {
+            guard.unlock();
+            std::this_thread::yield();
+            guard.lock();
+        }
+        this->body = &body;
+        this->begin = begin;
+        this->end = end;
+        this->nChunks = chunks;
+        this->chunk = (n + chunks - 1) / chunks;
+        next = 0;
+        finished = 0;
+        error = nullptr;
+        generation++;
+    }
+    wake.notify_all();
+
+    inPool = true;
+    runChunks();
+    inPool = false;
+    while (finished < chunks)
+        std::this_thread::yield();
+    if (error)
+        std::rethrow_exception(error);
+}
+
+void ThreadPool::workerLoop(int id) {
+    inPool = true;
+    uint64_t seen = 0;
+    while (true) {
+        for (int i = 0; i < config.spin && generation == seen && !stop; ++i)
+            std::this_thread::yield();
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [&] { return stop || generation != seen; });
+            if (stop)
+                return;
+            seen = generation;
+            active++;
+        }
+        runChunks();
+        active--;
+    }
+}
+
+void ThreadPool::runChunks() {
+    for (size_t c; (c = next++) < nChunks;) {
+        auto b = begin + c * chunk, e = std::min(b + chunk, end);
+        try {
+            (*body)(b, e);
+        } catch (...) {
+            std::lock_guard<std::mutex> guard(lock);
+            if (!error)
+                error = std::current_exception();
+        }
+        finished++;
+    }
+}
+
+} // namespace infini
@@ -0,0 +1,652 @@
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "core/blob.h"
+#include "core/graph.h"
+#include "core/model.h"
+#include "core/onnx.h"
+#include "core/runtime.h"
+#include "operators/concat.h"
+#include "operators/element_wise.h"
+#include "operators/matmul.h"
+#include "operators/transpose.h"
+#include "operators/unary.h"
+#include <cctype>
+
+// The `pyinfinitensor` module, written against the CPython API directly.
+// Tensors expose their data with the buffer protocol, so that NumPy arrays
+// and memoryviews read and write the arena in place, and graph inputs and
+// outputs can be bound to Python buffers without copying.
+
+namespace infini {
+
+namespace {
+
+struct PyGraph {
+    PyObject_HEAD Graph graph;
+    // inputs and outputs in the order of the loaded model, if any
+    optional<TensorVec> inputs, outputs;
+    // buffers currently exported by the tensors of the graph
+    Py_ssize_t exports;
+    // calls of `run` in flight, with the GIL released; like `exports` it is
+    // only read and written under the GIL
+    Py_ssize_t running;
+};
+
+struct PyTensor {
+    PyObject_HEAD PyGraph *graph;
+    Tensor tensor;
+};
+
+extern PyTypeObject GraphType, TensorType_;
+
+// buffer protocol format of every `DataType`, by index
+const char *format(DataType dtype) {
+    static const char *formats[] = {nullptr, "f", "B", "b", "H", "h", "i",
+                                    "q",     nullptr, "?", "e", "d", "I",
+                                    "Q",     nullptr, nullptr, nullptr};
+    auto i = dtype.getIndex();
+    return i >= 0 && size_t(i) < std::size(formats) ? formats[i] : nullptr;
+}
+
+// whether a buffer protocol format holds values of `dtype`, ignoring the
+// byte order prefix and the spelling of the integer sizes
+bool matches(const char *fmt, DataType dtype) {
+    if (fmt == nullptr)
+        fmt = "B";
+    if (*fmt == '@' || *fmt == '=' || *fmt == '<')
+        ++fmt;
+    auto expected = format(dtype);
+    if (expected == nullptr || strlen(fmt) != 1)
+        return false;
+    const auto kind = [](char c) {
+        return std::isupper(c) && c != '?' ? 'u' : std::isalpha(c) ? 's' : c;
+    };
+    const string floats = "efd";
+    if (floats.find(*fmt) != string::npos ||
+        floats.find(*expected) != string::npos)
+        return *fmt == *expected;
+    return kind(*fmt) == kind(*expected) &&
+           PyBuffer_SizeFromFormat(fmt) == Py_ssize_t(dtype.getSize());
+}
+
+// throws unless the graph can be changed: its kernels read the tensors,
+// ops and arena of the graph while `run` has released the GIL
+void checkIdle(const PyGraph *graph) {
+    if (graph->running > 0)
+        throw std::runtime_error("The graph is running");
+}
+
+// runs `f`, turning C++ exceptions into Python ones
+template <typename F> PyObject *guard(F &&f) {
+    try {
+        return f();
+    } catch (const std::exception &e) {
+        PyErr_SetString(PyExc_RuntimeError, e.what());
+        return nullptr;
+    }
+}
+
+PyObject *wrap(PyGraph *graph, const Tensor &tensor) {
+    auto self = PyObject_New(PyTensor, &TensorType_);
+    if (self == nullptr)
+        return nullptr;
+    Py_INCREF(graph);
+    self->graph = graph;
+    new (&self->tensor) Tensor(tensor);
+    return reinterpret_cast<PyObject *>(self);
+}
+
+PyObject *wrap(PyGraph *graph, const TensorVec &tensors) {
+    auto list = PyList_New(tensors.size());
+    for (size_t i = 0; list != nullptr && i < tensors.size(); ++i) {
+        auto item = wrap(graph, tensors[i]);
+        if (item == nullptr) {
+            Py_CLEAR(list);
+            break;
+        }
+        PyList_SET_ITEM(list, i, item);
+    }
+    return list;
+}
+
+// the tensor wrapped by `obj`, which must belong to `graph`
+Tensor unwrap(PyGraph *graph, PyObject *obj) {
+    if (!PyObject_TypeCheck(obj, &TensorType_))
+        throw std::invalid_argument("Expected a Tensor");
+    auto t = reinterpret_cast<PyTensor *>(obj);
+    if (t->graph != graph)
+        throw std::invalid_argument("The tensor belongs to another graph");
+    return t->tensor;
+}
+
+// a sequence of ints, e.g. a shape
+vector<int> ints(PyObject *obj) {
+    vector<int> ret;
+    auto seq = PySequence_Fast(obj, "Expected a sequence of ints");
+    if (seq == nullptr)
+        throw std::invalid_argument("Expected a sequence of ints");
+    for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(seq); ++i)
+        ret.emplace_back(PyLong_AsLong(PySequence_Fast_GET_ITEM(seq, i)));
+    Py_DECREF(seq);
+    if (PyErr_Occurred()) {
+        PyErr_Clear();
+        throw std::invalid_argument("Expected a sequence of ints");
+    }
+    return ret;
+}
+
+optional<float> optionalFloat(PyObject *obj) {
+    if (obj == nullptr || obj == Py_None)
+        return std::nullopt;
+    auto value = PyFloat_AsDouble(obj);
+    if (PyErr_Occurred()) {
+        PyErr_Clear();
+        throw std::invalid_argument("Expected a float or None");
+    }
+    return float(value);
+}
+
+DataType parseDType(const char *name) {
+    string lower(name);
+    for (size_t i = 0; i < std::size(DataType::names); ++i) {
+        string candidate(DataType::names[i]);
+        for (auto &c : candidate)
+            c = std::tolower(c);
+        if (candidate == lower && format(DataType(i)) != nullptr)
+            return DataType(i);
+    }
+    throw std::invalid_argument(string("Unsupported dtype ") + name);
+}
+
+// Graph
+
+PyObject *newGraph(PyTypeObject *type, Graph graph) {
+    auto self = reinterpret_cast<PyGraph *>(type->tp_alloc(type, 0));
+    if (self == nullptr)
+        return nullptr;
+    new (&self->graph) Graph(std::move(graph));
+    new (&self->inputs) optional<TensorVec>();
+    new (&self->outputs) optional<TensorVec>();
+    self->exports = 0;
+    self->running = 0;
+    return reinterpret_cast<PyObject *>(self);
+}
+
+PyObject *Graph_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+    static const char *keywords[] = {nullptr};
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, ":Graph",
+                                     const_cast<char **>(keywords)))
+        return nullptr;
+    return newGraph(type, make_ref<GraphObj>(
+                              NativeCpuRuntimeObj::getInstance()));
+}
+
+void Graph_dealloc(PyGraph *self) {
+    self->graph.~Graph();
+    self->inputs.~optional<TensorVec>();
+    self->outputs.~optional<TensorVec>();
+    Py_TYPE(self)->tp_free(reinterpret_cast<PyObject *>(self));
+}
+
+PyObject *Graph_tensor(PyGraph *self, PyObject *args, PyObject *kwds) {
+    static const char *keywords[] = {"shape", "dtype", "weight", nullptr};
+    PyObject *shape;
+    const char *dtype = "float32";
+    int weight = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|sp:tensor",
+                                     const_cast<char **>(keywords), &shape,
+                                     &dtype, &weight))
+        return nullptr;
+    return guard([&] {
+        checkIdle(self);
+        auto t = self->graph->addTensor(ints(shape), parseDType(dtype));
+        t->setWeight(weight);
+        return wrap(self, t);
+    });
+}
+
+template <typename T>
+PyObject *Graph_binary(PyGraph *self, PyObject *args) {
+    PyObject *a, *b;
+    if (!PyArg_ParseTuple(args, "OO", &a, &b))
+        return nullptr;
+    return guard([&] {
+        checkIdle(self);
+        return wrap(self, self->graph
+                              ->addOp<T>(unwrap(self, a), unwrap(self, b),
+                                         nullptr)
+                              ->getOutput());
+    });
+}
+
+PyObject *Graph_relu(PyGraph *self, PyObject *arg) {
+    return guard([&] {
+        checkIdle(self);
+        auto x = unwrap(self, arg);
+        return wrap(self, self->graph->addOp<ReluObj>(x, nullptr)->getOutput());
+    });
+}
+
+PyObject *Graph_matmul(PyGraph *self, PyObject *args, PyObject *kwds) {
+    static const char *keywords[] = {"a", "b", "trans_a", "trans_b", nullptr};
+    PyObject *a, *b;
+    int transA = 0, transB = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "OO|pp:matmul",
+                                     const_cast<char **>(keywords), &a, &b,
+                                     &transA, &transB))
+        return nullptr;
+    return guard([&] {
+        checkIdle(self);
+        return wrap(self, self->graph
+                              ->addOp<MatmulObj>(unwrap(self, a),
+                                                 unwrap(self, b), nullptr,
+                                                 transA, transB)
+                              ->getOutput());
+    });
+}
+
+PyObject *Graph_transpose(PyGraph *self, PyObject *args) {
+    PyObject *x, *perm;
+    if (!PyArg_ParseTuple(args, "OO:transpose", &x, &perm))
+        return nullptr;
+    return guard([&] {
+        checkIdle(self);
+        return wrap(self, self->graph
+                              ->addOp<TransposeObj>(unwrap(self, x), nullptr,
+                                                    ints(perm))
+                              ->getOutput());
+    });
+}
+
+PyObject *Graph_concat(PyGraph *self, PyObject *args) {
+    PyObject *inputs;
+    int axis;
+    if (!PyArg_ParseTuple(args, "Oi:concat", &inputs, &axis))
+        return nullptr;
+    return guard([&] {
+        checkIdle(self);
+        auto seq = PySequence_Fast(inputs, "Expected a sequence of tensors");
+        if (seq == nullptr)
+            return (PyObject *)nullptr;
+        TensorVec tensors;
+        try {
+            for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(seq); ++i)
+                tensors.emplace_back(
+                    unwrap(self, PySequence_Fast_GET_ITEM(seq, i)));
+        } catch (...) {
+            Py_DECREF(seq);
+            throw;
+        }
+        Py_DECREF(seq);
+        return wrap(self, self->graph->addOp<ConcatObj>(tensors, nullptr, axis)
+                              ->getOutput());
+    });
+}
+
+PyObject *Graph_clip(PyGraph *self, PyObject *args, PyObject *kwds) {
+    static const char *keywords[] = {"x", "min", "max", nullptr};
+    PyObject *x, *min = nullptr, *max = nullptr;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|OO:clip",
+                                     const_cast<char **>(keywords), &x, &min,
+                                     &max))
+        return nullptr;
+    return guard([&] {
+        checkIdle(self);
+        return wrap(self, self->graph
+                              ->addOp<ClipObj>(unwrap(self, x), nullptr,
+                                               optionalFloat(min),
+                                               optionalFloat(max))
+                              ->getOutput());
+    });
+}
+
+PyObject *Graph_optimize(PyGraph *self, PyObject *) {
+    return guard([&] {
+        checkIdle(self);
+        self->graph->optimize();
+        Py_RETURN_NONE;
+    });
+}
+
+PyObject *Graph_data_malloc(PyGraph *self, PyObject *) {
+    if (self->exports > 0) {
+        PyErr_SetString(PyExc_BufferError,
+                        "Cannot reallocate a graph whose tensors are viewed");
+        return nullptr;
+    }
+    return guard([&] {
+        checkIdle(self);
+        self->graph->dataMalloc();
+        Py_RETURN_NONE;
+    });
+}
+
+PyObject *Graph_run(PyGraph *self, PyObject *) {
+    // the runs of a graph share its arena
+    if (self->running > 0) {
+        PyErr_SetString(PyExc_RuntimeError, "The graph is running");
+        return nullptr;
+    }
+    string error;
+    auto graph = self->graph;
+    ++self->running;
+    // the kernels never call back into Python
+    Py_BEGIN_ALLOW_THREADS;
+    try {
+        graph->getRuntime()->run(graph);
+    } catch (const std::exception &e) {
+        error = e.what();
+        if (error.empty())
+            error = "Failed to run the graph";
+    }
+    Py_END_ALLOW_THREADS;
+    --self->running;
+    if (!error.empty()) {
+        PyErr_SetString(PyExc_RuntimeError, error.c_str());
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+PyObject *Graph_save(PyGraph *self, PyObject *args) {
+    const char *path;
+    if (!PyArg_ParseTuple(args, "s:save", &path))
+        return nullptr;
+    return guard([&] {
+        saveModel(self->graph, path);
+        Py_RETURN_NONE;
+    });
+}
+
+PyObject *Graph_get_inputs(PyGraph *self, void *) {
+    return guard([&] {
+        return wrap(self, self->inputs ? *self->inputs
+                                       : self->graph->getInputs());
+    });
+}
+
+PyObject *Graph_get_outputs(PyGraph *self, void *) {
+    return guard([&] {
+        return wrap(self, self->outputs ? *self->outputs
+                                        : self->graph->getOutputs());
+    });
+}
+
+PyMethodDef graphMethods[] = {
+    {"tensor", (PyCFunction)(void (*)())Graph_tensor,
+     METH_VARARGS | METH_KEYWORDS,
+     "tensor(shape, dtype='float32', weight=False)\n--\n\nAdd a tensor."},
+    {"add", (PyCFunction)Graph_binary<AddObj>, METH_VARARGS, "a + b"},
+    {"sub", (PyCFunction)Graph_binary<SubObj>, METH_VARARGS, "a - b"},
+    {"mul", (PyCFunction)Graph_binary<MulObj>, METH_VARARGS, "a * b"},
+    {"div", (PyCFunction)Graph_binary<DivObj>, METH_VARARGS, "a / b"},
+    {"relu", (PyCFunction)Graph_relu, METH_O, "relu(x)"},
+    {"matmul", (PyCFunction)(void (*)())Graph_matmul,
+     METH_VARARGS | METH_KEYWORDS,
+     "matmul(a, b, trans_a=False, trans_b=False)"},
+    {"transpose", (PyCFunction)Graph_transpose, METH_VARARGS,
+     "transpose(x, perm)"},
+    {"concat", (PyCFunction)Graph_concat, METH_VARARGS,
+     "concat(inputs, axis)"},
+    {"clip", (PyCFunction)(void (*)())Graph_clip, METH_VARARGS | METH_KEYWORDS,
+     "clip(x, min=None, max=None)"},
+    {"optimize", (PyCFunction)Graph_optimize, METH_NOARGS,
+     "Optimize the graph."},
+    {"data_malloc", (PyCFunction)Graph_data_malloc, METH_NOARGS,
+     "Allocate the tensors. Bound buffers are unbound."},
+    {"run", (PyCFunction)Graph_run, METH_NOARGS,
+     "Run the graph, with the GIL released. The graph cannot be changed, "
+     "reallocated or run again until it returns."},
+    {"save", (PyCFunction)Graph_save, METH_VARARGS,
+     "save(path)\n--\n\nWrite the graph in the binary model format."},
+    {nullptr, nullptr, 0, nullptr}};
+
+PyGetSetDef graphGetSet[] = {
+    {"inputs", (getter)Graph_get_inputs, nullptr, "The graph inputs.",
+     nullptr},
+    {"outputs", (getter)Graph_get_outputs, nullptr, "The graph outputs.",
+     nullptr},
+    {nullptr, nullptr, nullptr, nullptr, nullptr}};
+
+// Tensor
+
+void Tensor_dealloc(PyTensor *self) {
+    self->tensor.~Tensor();
+    Py_DECREF(self->graph);
+    PyObject_Free(self);
+}
+
+int Tensor_getbuffer(PyTensor *self, Py_buffer *view, int flags) {
+    const auto &t = self->tensor;
+    auto fmt = format(t->getDType());
+    if (!t->hasData() || fmt == nullptr) {
+        PyErr_SetString(PyExc_BufferError,
+                        t->hasData() ? "Unsupported dtype"
+                                     : "The tensor is not allocated");
+        view->obj = nullptr;
+        return -1;
+    }
+    auto rank = t->getRank();
+    // shape then strides, released with the view
+    auto dims = new Py_ssize_t[2 * rank + 1];
+    Py_ssize_t stride = t->getDType().getSize();
+    for (size_t i = rank; i-- > 0;) {
+        dims[i] = t->getDims()[i];
+        dims[rank + i] = stride;
+        stride *= dims[i];
+    }
+    view->buf = t->getRawDataPtr<void *>();
+    view->obj = reinterpret_cast<PyObject *>(self);
+    Py_INCREF(self);
+    view->len = t->getBytes();
+    view->readonly = 0;
+    view->itemsize = t->getDType().getSize();
+    view->format = (flags & PyBUF_FORMAT) ? const_cast<char *>(fmt) : nullptr;
+    view->ndim = rank;
+    view->shape = (flags & PyBUF_ND) == PyBUF_ND ? dims : nullptr;
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? dims + rank
+                                                              : nullptr;
+    view->suboffsets = nullptr;
+    view->internal = dims;
+    ++self->graph->exports;
+    return 0;
+}
+
+void Tensor_releasebuffer(PyTensor *self, Py_buffer *view) {
+    delete[] static_cast<Py_ssize_t *>(view->internal);
+    --self->graph->exports;
+}
+
+PyBufferProcs tensorBuffer = {(getbufferproc)Tensor_getbuffer,
+                              (releasebufferproc)Tensor_releasebuffer};
+
+PyObject *Tensor_bind(PyTensor *self, PyObject *obj) {
+    if (self->graph->running > 0) {
+        PyErr_SetString(PyExc_RuntimeError, "The graph is running");
+        return nullptr;
+    }
+    const auto &t = self->tensor;
+    bool output = t->getSource() != nullptr;
+    if (output && !t->getTargets().empty()) {
+        PyErr_SetString(PyExc_ValueError,
+                        "Only graph inputs and outputs can be bound");
+        return nullptr;
+    }
+    if (!t->hasData()) {
+        PyErr_SetString(PyExc_ValueError, "The graph is not allocated");
+        return nullptr;
+    }
+    auto buffer = new Py_buffer;
+    int flags = PyBUF_C_CONTIGUOUS | PyBUF_FORMAT;
+    if (output)
+        flags |= PyBUF_WRITABLE;
+    if (PyObject_GetBuffer(obj, buffer, flags) < 0) {
+        delete buffer;
+        return nullptr;
+    }
+    const char *error = nullptr;
+    auto dims = t->getDims();
+    if (!matches(buffer->format, t->getDType()))
+        error = "The buffer and the tensor have different dtypes";
+    else if (buffer->ndim != int(dims.size()) ||
+             !std::equal(dims.begin(), dims.end(), buffer->shape))
+        error = "The buffer and the tensor have different shapes";
+    else if (reinterpret_cast<uintptr_t>(buffer->buf) % buffer->itemsize != 0)
+        error = "The buffer is not aligned";
+    if (error != nullptr) {
+        PyBuffer_Release(buffer);
+        delete buffer;
+        PyErr_SetString(PyExc_ValueError, error);
+        return nullptr;
+    }
+    // the buffer is released when the tensor lets go of it, maybe from a
+    // thread not holding the GIL
+    Ref<void> owner(buffer, [](void *ptr) {
+        auto buffer = static_cast<Py_buffer *>(ptr);
+        auto state = PyGILState_Ensure();
+        PyBuffer_Release(buffer);
+        PyGILState_Release(state);
+        delete buffer;
+    });
+    t->setDataBlob(
+        make_ref<BlobObj>(t->getRuntime(), buffer->buf, std::move(owner)));
+    Py_RETURN_NONE;
+}
+
+PyObject *Tensor_get_shape(PyTensor *self, void *) {
+    auto dims = self->tensor->getDims();
+    auto tuple = PyTuple_New(dims.size());
+    for (size_t i = 0; tuple != nullptr && i < dims.size(); ++i)
+        PyTuple_SET_ITEM(tuple, i, PyLong_FromLong(dims[i]));
+    return tuple;
+}
+
+PyObject *Tensor_get_dtype(PyTensor *self, void *) {
+    string name = self->tensor->getDType().toString();
+    for (auto &c : name)
+        c = std::tolower(c);
+    return PyUnicode_FromString(name.c_str());
+}
+
+PyObject *Tensor_repr(PyTensor *self) {
+    return guard([&] {
+        return PyUnicode_FromString(self->tensor->toString().c_str());
+    });
+}
+
+PyMethodDef tensorMethods[] = {
+    {"bind", (PyCFunction)Tensor_bind, METH_O,
+     "bind(buffer)\n--\n\nPoint a graph input or output to a C-contiguous "
+     "buffer of the same dtype and shape, without copying, until the next "
+     "data_malloc. Outputs need a writable buffer."},
+    {nullptr, nullptr, 0, nullptr}};
+
+PyGetSetDef tensorGetSet[] = {
+    {"shape", (getter)Tensor_get_shape, nullptr, "The dimensions.", nullptr},
+    {"dtype", (getter)Tensor_get_dtype, nullptr, "The element type.",
+     nullptr},
+    {nullptr, nullptr, nullptr, nullptr, nullptr}};
+
+PyTypeObject GraphType = [] {
+    PyTypeObject type = {PyVarObject_HEAD_INIT(nullptr, 0)};
+    type.tp_name = "pyinfinitensor.Graph";
+    type.tp_basicsize = sizeof(PyGraph);
+    type.tp_dealloc = (destructor)Graph_dealloc;
+    type.tp_flags = Py_TPFLAGS_DEFAULT;
+    type.tp_doc = "A computation graph on the CPU runtime.";
+    type.tp_methods = graphMethods;
+    type.tp_getset = graphGetSet;
+    type.tp_new = Graph_new;
+    return type;
+}();
+
+PyTypeObject TensorType_ = [] {
+    PyTypeObject type = {PyVarObject_HEAD_INIT(nullptr, 0)};
+    type.tp_name = "pyinfinitensor.Tensor";
+    type.tp_basicsize = sizeof(PyTensor);
+    type.tp_dealloc = (destructor)Tensor_dealloc;
+    type.tp_repr = (reprfunc)Tensor_repr;
+    type.tp_as_buffer = &tensorBuffer;
+    type.tp_flags = Py_TPFLAGS_DEFAULT;
+    type.tp_doc = "A tensor of a graph, exposing its data as a buffer.";
+    type.tp_methods = tensorMethods;
+    type.tp_getset = tensorGetSet;
+    return type;
+}();
+
+// Module
+
+PyObject *load_model(PyObject *, PyObject *args) {
+    const char *path;
+    if (!PyArg_ParseTuple(args, "s:load_model", &path))
+        return nullptr;
+    return guard([&] {
+        return newGraph(&GraphType,
+                        loadModel(path, NativeCpuRuntimeObj::getInstance()));
+    });
+}
+
+PyObject *load_onnx(PyObject *, PyObject *args, PyObject *kwds) {
+    static const char *keywords[] = {"path", "dims", nullptr};
+    const char *path;
+    PyObject *dimsObj = nullptr;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "s|O!:load_onnx",
+                                     const_cast<char **>(keywords), &path,
+                                     &PyDict_Type, &dimsObj))
+        return nullptr;
+    std::map<string, int> dims;
+    PyObject *key, *value;
+    Py_ssize_t pos = 0;
+    while (dimsObj && PyDict_Next(dimsObj, &pos, &key, &value)) {
+        auto name = PyUnicode_AsUTF8(key);
+        auto d = PyLong_AsLong(value);
+        if (name == nullptr || PyErr_Occurred())
+            return nullptr;
+        dims[name] = d;
+    }
+    return guard([&] {
+        auto model = loadOnnx(path, NativeCpuRuntimeObj::getInstance(), dims);
+        auto self = newGraph(&GraphType, model.graph);
+        if (self != nullptr) {
+            auto graph = reinterpret_cast<PyGraph *>(self);
+            graph->inputs = model.inputs;
+            graph->outputs = model.outputs;
+        }
+        return self;
+    });
+}
+
+PyMethodDef moduleMethods[] = {
+    {"load_model", (PyCFunction)load_model, METH_VARARGS,
+     "load_model(path)\n--\n\nRead a graph in the binary model format."},
+    {"load_onnx", (PyCFunction)(void (*)())load_onnx,
+     METH_VARARGS | METH_KEYWORDS,
+     "load_onnx(path, dims=None)\n--\n\nImport an ONNX model, with the "
+     "values of its symbolic dimensions."},
+    {nullptr, nullptr, 0, nullptr}};
+
+PyModuleDef module = {PyModuleDef_HEAD_INIT, "pyinfinitensor",
+                      "Build and run InfiniTensor graphs.", -1,
+                      moduleMethods};
+
+} // namespace
+
+} // namespace infini
+
+PyMODINIT_FUNC PyInit_pyinfinitensor() {
+    using namespace infini;
+    if (PyType_Ready(&GraphType) < 0 || PyType_Ready(&TensorType_) < 0)
+        return nullptr;
+    auto m = PyModule_Create(&module);
+    if (m == nullptr)
+        return nullptr;
+    Py_INCREF(&GraphType);
+    Py_INCREF(&TensorType_);
+    if (PyModule_AddObject(m, "Graph", (PyObject *)&GraphType) < 0 ||
+        PyModule_AddObject(m, "Tensor", (PyObject *)&TensorType_) < 0) {
+        Py_DECREF(m);
+        return nullptr;
+    }
+    return m;
+}
@@ -0,0 +1,88 @@
+#include "operators/collective.h"
+#include "core/kernel.h"
+#include <cstring>
+
+namespace infini {
+
+class AllReduceSum : public CpuKernelWithoutConfig {
+    struct Args : KernelArgs {
+        CommunicatorObj *comm;
+        size_t n;
+        DataType dtype = DataType::Float32;
+    };
+
+    static void doCompute(const KernelArgs *_args, void *const *data,
+                          const RuntimeObj *context) {
+        auto args = static_cast<const Args *>(_args);
+        if (data[1] != data[0])
+            std::memcpy(data[1], data[0], args->n * args->dtype.getSize());
+        args->comm->allReduceSum(data[1], args->n, args->dtype);
+    }
+
+    PreparedKernel prepare(const Operator &_op,
+                           const RuntimeObj *context) const override {
+        auto op = as<AllReduceSumObj>(_op);
+        auto args = make_ref<Args>();
+        args->comm = op->getCommunicator().get();
+        args->n = op->getOutput()->size();
+        args->dtype = op->getDType();
+        return {doCompute, args};
+    }
+};
+
+class AllGather : public CpuKernelWithoutConfig {
+    struct Args : KernelArgs {
+        CommunicatorObj *comm;
+        // the input is `outer` blocks of `block` bytes, placed one after the
+        // other in the output for every rank
+        size_t outer, block;
+    };
+
+    static void doCompute(const KernelArgs *_args, void *const *data,
+                          const RuntimeObj *context) {
+        auto args = static_cast<const Args *>(_args);
+        const auto ranks = args->comm->getWorldSize();
+        const auto bytes = args->outer * args->block;
+        auto output = static_cast<char *>(data[1]);
+        if (args->outer == 1) {
+            args->comm->allGather(data[0], output, bytes);
+            return;
+        }
+        // gathered rank after rank into the workspace, then interleaved
+        auto gathered = static_cast<const char *>(data[2]);
+        args->comm->allGather(data[0], data[2], bytes);
+        for (int r = 0; r < ranks; ++r)
+            for (size_t i = 0; i < args->outer; ++i)
+                std::memcpy(output + (i * ranks + r) * args->block,
+                            gathered + r * bytes + i * args->block,
+                            args->block);
+    }
+
+    PreparedKernel prepare(const Operator &_op,
+                           const RuntimeObj *context) const override {
+        auto op = as<AllGatherObj>(_op);
+        const auto dims = op->getInputs(0)->getDims();
+        auto args = make_ref<Args>();
+        args->comm = op->getCommunicator().get();
+        args->outer = 1;
+        args->block = op->getDType().getSize();
+        for (int i = 0; i < int(dims.size()); ++i)
+            (i < op->getDim() ? args->outer : args->block) *= dims[i];
+        return {doCompute, args};
+    }
+
+    size_t getWorkspaceSize(const Operator &_op) const override {
+        auto op = as<AllGatherObj>(_op);
+        const auto dims = op->getInputs(0)->getDims();
+        size_t outer = 1;
+        for (int i = 0; i < op->getDim(); ++i)
+            outer *= dims[i];
+        return outer == 1 ? 0 : op->getOutput()->getBytes();
+    }
+};
+
+REGISTER_KERNEL(Device::CPU, OpType::AllReduceSum, AllReduceSum,
+                "AllReduceSum_CPU");
+REGISTER_KERNEL(Device::CPU, OpType::AllGather, AllGather, "AllGather_CPU");
+
+} // namespace infini
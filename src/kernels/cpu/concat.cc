@@ -4,8 +4,38 @@
 namespace infini {
 
 class NaiveConcat : public CpuKernelWithoutConfig {
+    struct Args : KernelArgs {
+        struct Part {
+            size_t size, localBlockOffset, innerOffset;
+        };
+        vector<Part> parts;
+        size_t blockOffset;
+    };
+
     template <typename T>
-    void doCompute(const Operator &_op, const RuntimeObj *context) const {
+    static void doCompute(const KernelArgs *_args, void *const *data,
+                          const RuntimeObj *context) {
+        auto args = static_cast<const Args *>(_args);
+        const auto &parts = args->parts;
+        const auto blockOffset = args->blockOffset;
+        auto outPtr = static_cast<T *>(data[parts.size()]);
+        for (size_t i = 0; i < parts.size(); ++i) {
+            auto inPtr = static_cast<const T *>(data[i]);
+            const auto inSize = parts[i].size;
+            const auto localBlockOffset = parts[i].localBlockOffset;
+            const auto innerOffset = parts[i].innerOffset;
+            context->parallelFor(0, inSize, 0, [&](size_t begin, size_t end) {
+                for (size_t iOffset = begin; iOffset < end; ++iOffset) {
+                    auto oOffset = iOffset % localBlockOffset + innerOffset +
+                                   iOffset / localBlockOffset * blockOffset;
+                    outPtr[oOffset] = inPtr[iOffset];
+                }
+            });
+        }
+    }
+
+    PreparedKernel prepare(const Operator &_op,
+                           const RuntimeObj *context) const override {
         auto op = as<ConcatObj>(_op);
         auto inputs = op->getInputs(), outputs = op->getOutputs();
         auto dim = op->getDim();
@@ -17,9 +47,10 @@ class NaiveConcat : public CpuKernelWithoutConfig {
         size_t blockOffsetInner = 1;
         for (size_t i = outDim.size() - 1; i > (size_t)dim; --i)
             blockOffsetInner *= outDim[i];
-        size_t blockOffset = outDim[dim] * blockOffsetInner;
+
+        auto args = make_ref<Args>();
+        args->blockOffset = outDim[dim] * blockOffsetInner;
         for (size_t i = 0; i < inputs.size(); ++i) {
-            auto input = inputs[i];
             auto dimOffset = 0;
             auto iDim = iDims[i];
             for (size_t j = 0; j < i; ++j)
@@ -28,25 +59,16 @@ class NaiveConcat : public CpuKernelWithoutConfig {
             for (size_t i = iDim.size() - 1;
                  i >= (size_t)dim && i != (size_t)-1; --i)
                 localBlockOffset *= iDim[i];
-            auto innerOffset = blockOffsetInner * dimOffset;
-            auto inSize = input->size();
-            auto inPtr = input->getRawDataPtr<T *>(),
-                 outPtr = output->getRawDataPtr<T *>();
-#pragma omp parallel for
-            for (size_t iOffset = 0; iOffset < inSize; ++iOffset) {
-                auto oOffset = iOffset % localBlockOffset + innerOffset +
-                               iOffset / localBlockOffset * blockOffset;
-                outPtr[oOffset] = inPtr[iOffset];
-            }
+            args->parts.push_back(
+                {inputs[i]->size(), localBlockOffset,
+                 blockOffsetInner * dimOffset});
         }
-    }
 
-    void compute(const Operator &_op,
-                 const RuntimeObj *context) const override {
 #define CASE(N)                                                                \
     case N:                                                                    \
-        doCompute<DT<N>::t>(_op, context)
+        func = doCompute<DT<N>::t>
 
+        KernelFunc func = nullptr;
         int dataTypeIdx = _op->getDType().getIndex();
         switch (dataTypeIdx) {
             CASE(1); // DataType::Float32
@@ -56,6 +78,8 @@ class NaiveConcat : public CpuKernelWithoutConfig {
         default:
             IT_TODO_HALT();
         }
+#undef CASE
+        return {func, args};
     }
 };
 
@@ -3,7 +3,18 @@
 #include "utils/operator_utils.h"
 
 namespace infini {
+KERNEL_ISA_BEGIN
+
 class NativeElementWise : public CpuKernelWithoutConfig {
+    struct Args : KernelArgs {
+        size_t n;
+        // output shape and input strides, 0 on broadcast dimensions
+        Shape shapeC, strideA, strideB;
+        // no broadcast: the inputs are read at the index of the output, in a
+        // loop the compiler vectorizes
+        bool contiguous;
+    };
+
     template <typename T> static T addCompute(T val0, T val1) {
         return val0 + val1;
     }
@@ -20,13 +31,57 @@ class NativeElementWise : public CpuKernelWithoutConfig {
         return (T)(val0 / val1);
     }
 
-    template <typename T>
-    void doCompute(const Operator &_op, const RuntimeObj *context) const {
-        auto op = as<ElementWiseObj>(_op);
-        T *inptr0 = op->getInputs(0)->getRawDataPtr<T *>();
-        T *inptr1 = op->getInputs(1)->getRawDataPtr<T *>();
-        T *outptr = op->getOutput()->getRawDataPtr<T *>();
+    template <typename T, T (*_doCompute)(T, T)>
+    static void doCompute(const KernelArgs *_args, void *const *data,
+                          const RuntimeObj *context) {
+        auto args = static_cast<const Args *>(_args);
+        auto inptr0 = static_cast<const T *>(data[0]);
+        auto inptr1 = static_cast<const T *>(data[1]);
+        auto outptr = static_cast<T *>(data[2]);
+        const auto &shapeC = args->shapeC;
+        const auto &strideA = args->strideA;
+        const auto &strideB = args->strideB;
+        const auto rank = shapeC.size();
+
+        if (args->contiguous) {
+            context->parallelFor(0, args->n, 0, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i)
+                    outptr[i] = _doCompute(inptr0[i], inptr1[i]);
+            });
+            return;
+        }
+        context->parallelFor(0, args->n, 0, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                size_t rest = i, indexA = 0, indexB = 0;
+                for (auto j = rank; j > 0; --j) {
+                    auto pos = rest % shapeC[j - 1];
+                    rest /= shapeC[j - 1];
+                    indexA += pos * strideA[j - 1];
+                    indexB += pos * strideB[j - 1];
+                }
+                outptr[i] = _doCompute(inptr0[indexA], inptr1[indexB]);
+            }
+        });
+    }
+
+    template <typename T> static KernelFunc select(OpType type) {
+        switch (type.underlying()) {
+        case OpType::Add:
+            return doCompute<T, addCompute<T>>;
+        case OpType::Sub:
+            return doCompute<T, subCompute<T>>;
+        case OpType::Mul:
+            return doCompute<T, mulCompute<T>>;
+        case OpType::Div:
+            return doCompute<T, divCompute<T>>;
+        default:
+            IT_TODO_HALT();
+        }
+    }
 
+    PreparedKernel prepare(const Operator &_op,
+                           const RuntimeObj *context) const override {
+        auto op = as<ElementWiseObj>(_op);
         auto shapeA = op->getInputs(0)->getDims();
         auto shapeB = op->getInputs(1)->getDims();
         auto shapeC = op->getOutput()->getDims();
@@ -41,48 +96,24 @@ class NativeElementWise : public CpuKernelWithoutConfig {
             int p = 1;
             Shape stride(rank);
             for (auto i = rank; i > 0; --i) {
-                stride[i - 1] = p;
+                stride[i - 1] = shape[i - 1] == 1 ? 0 : p;
                 p = p * shape[i - 1];
             }
             return stride;
         };
-        Shape strideA = getStride(a);
-        Shape strideB = getStride(b);
-
-        auto n = op->getOutput()->size();
-        T(*_doCompute)
-        (T val0, T val1);
-        switch (op->getOpType().underlying()) {
-        case OpType::Add:
-            _doCompute = addCompute<T>;
-            break;
-        case OpType::Sub:
-            _doCompute = subCompute<T>;
-            break;
-        case OpType::Mul:
-            _doCompute = mulCompute<T>;
-            break;
-        case OpType::Div:
-            _doCompute = divCompute<T>;
-            break;
-        default:
-            IT_TODO_HALT();
-        }
 
-        for (size_t i = 0; i < n; ++i) {
-            auto shapeIndexC = locate_index(i, shapeC);
-            auto indexA = delocate_index(shapeIndexC, a, strideA);
-            auto indexB = delocate_index(shapeIndexC, b, strideB);
-            outptr[i] = _doCompute(inptr0[indexA], inptr1[indexB]);
-        }
-    }
+        auto args = make_ref<Args>();
+        args->n = op->getOutput()->size();
+        args->shapeC = shapeC;
+        args->strideA = getStride(a);
+        args->strideB = getStride(b);
+        args->contiguous = a == shapeC && b == shapeC;
 
-    void compute(const Operator &_op,
-                 const RuntimeObj *context) const override {
 #define CASE(N)                                                                \
     case N:                                                                    \
-        doCompute<DT<N>::t>(_op, context)
+        func = select<DT<N>::t>(op->getOpType())
 
+        KernelFunc func = nullptr;
         int dataTypeIdx = _op->getDType().getIndex();
         switch (dataTypeIdx) {
             CASE(1); // DataType::Float32
@@ -92,9 +123,13 @@ class NativeElementWise : public CpuKernelWithoutConfig {
         default:
             IT_TODO_HALT();
         }
+#undef CASE
+        return {func, args};
     }
 };
 
+KERNEL_ISA_END
+
 REGISTER_KERNEL(Device::CPU, OpType::Add, NativeElementWise, "addNaive_CPU");
 REGISTER_KERNEL(Device::CPU, OpType::Sub, NativeElementWise, "subNaive_CPU");
 REGISTER_KERNEL(Device::CPU, OpType::Mul, NativeElementWise, "mulNaive_CPU");
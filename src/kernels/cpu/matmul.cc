@@ -0,0 +1,143 @@
+#include "operators/matmul.h"
+#include "core/kernel.h"
+
+namespace infini {
+
+KERNEL_ISA_BEGIN
+
+class NaiveMatmul : public CpuKernelWithoutConfig {
+    struct Args : KernelArgs {
+        // C (m x k) = A (m x n) * B (n x k) for every batch
+        size_t m, n, k, batch;
+        // output batch dims and the batch strides of A and B, 0 on broadcast
+        // dims
+        Shape batchDim;
+        vector<size_t> batchStrideA, batchStrideB;
+        // strides of the rows and columns of A and B, after transposition
+        size_t rowA, colA, rowB, colB;
+        // a transposed B is first packed into the workspace as n x k
+        // matrices, so that the inner loop reads contiguous rows; sizeB is
+        // its number of elements
+        bool packB;
+        size_t sizeB;
+    };
+
+    template <typename T>
+    static void doCompute(const KernelArgs *_args, void *const *data,
+                          const RuntimeObj *context) {
+        auto args = static_cast<const Args *>(_args);
+        auto A = static_cast<const T *>(data[0]);
+        auto B = static_cast<const T *>(data[1]);
+        auto C = static_cast<T *>(data[2]);
+        const auto m = args->m, n = args->n, k = args->k;
+        const auto &batchDim = args->batchDim;
+        auto rowB = args->rowB;
+
+        if (args->packB) {
+            auto P = static_cast<T *>(data[3]);
+            // one row of a packed matrix per index
+            auto packRows = args->sizeB / std::max<size_t>(1, k);
+            auto packGrain = std::max<size_t>(1, 4096 / std::max<size_t>(1, k));
+            context->parallelFor(
+                0, packRows, packGrain, [&](size_t begin, size_t end) {
+                    for (size_t r = begin; r < end; ++r) {
+                        auto src = B + r / n * n * k + r % n * rowB;
+                        for (size_t j = 0; j < k; ++j)
+                            P[r * k + j] = src[j * args->colB];
+                    }
+                });
+            B = P;
+            rowB = k;
+        }
+
+        // one row of C per index, so that each row is written by one thread
+        auto rows = args->batch * m;
+        auto grain = std::max<size_t>(1, 4096 / std::max<size_t>(1, n * k));
+        context->parallelFor(0, rows, grain, [&](size_t begin, size_t end) {
+            for (size_t r = begin; r < end; ++r) {
+                size_t b = r / m, i = r % m, offsetA = 0, offsetB = 0;
+                for (size_t j = batchDim.size(), rest = b; j > 0; --j) {
+                    auto pos = rest % batchDim[j - 1];
+                    rest /= batchDim[j - 1];
+                    offsetA += pos * args->batchStrideA[j - 1];
+                    offsetB += pos * args->batchStrideB[j - 1];
+                }
+                auto a = A + offsetA + i * args->rowA;
+                auto c = C + r * k;
+                std::fill(c, c + k, T(0));
+                for (size_t p = 0; p < n; ++p) {
+                    auto x = a[p * args->colA];
+                    // rows of B are contiguous, so that this loop is
+                    // vectorized
+                    auto row = B + offsetB + p * rowB;
+                    for (size_t j = 0; j < k; ++j)
+                        c[j] += x * row[j];
+                }
+            }
+        });
+    }
+
+    PreparedKernel prepare(const Operator &_op,
+                           const RuntimeObj *context) const override {
+        auto op = as<MatmulObj>(_op);
+        const auto shapeA = op->getInputs(0)->getDims();
+        const auto shapeB = op->getInputs(1)->getDims();
+        const auto shapeC = op->getOutput()->getDims();
+        const auto rank = shapeC.size();
+        IT_ASSERT(shapeA.size() == rank && shapeB.size() == rank);
+
+        auto args = make_ref<Args>();
+        args->m = op->getM();
+        args->n = op->getN();
+        args->k = op->getK();
+        // A is stored as m x n, or n x m if transposed
+        args->rowA = op->getTransA() ? 1 : args->n;
+        args->colA = op->getTransA() ? args->m : 1;
+        // B is stored as n x k, or k x n if transposed
+        args->rowB = op->getTransB() ? 1 : args->k;
+        args->colB = op->getTransB() ? args->n : 1;
+        args->packB = op->getTransB();
+        args->sizeB = op->getInputs(1)->size();
+
+        args->batchDim = Shape(shapeC.begin(), shapeC.end() - 2);
+        args->batch = 1;
+        args->batchStrideA.assign(rank - 2, 0);
+        args->batchStrideB.assign(rank - 2, 0);
+        size_t pA = args->m * args->n, pB = args->n * args->k;
+        for (auto i = rank - 2; i > 0; --i) {
+            args->batch *= shapeC[i - 1];
+            args->batchStrideA[i - 1] = shapeA[i - 1] == 1 ? 0 : pA;
+            args->batchStrideB[i - 1] = shapeB[i - 1] == 1 ? 0 : pB;
+            pA *= shapeA[i - 1];
+            pB *= shapeB[i - 1];
+        }
+
+#define CASE(N)                                                                \
+    case N:                                                                    \
+        func = doCompute<DT<N>::t>
+
+        KernelFunc func = nullptr;
+        int dataTypeIdx = _op->getDType().getIndex();
+        switch (dataTypeIdx) {
+            CASE(1); // DataType::Float32
+            break;
+            CASE(12); // DataType::UInt32
+            break;
+        default:
+            IT_TODO_HALT();
+        }
+#undef CASE
+        return {func, args};
+    }
+
+    size_t getWorkspaceSize(const Operator &op) const override {
+        auto matmul = as<MatmulObj>(op);
+        return matmul->getTransB() ? matmul->getInputs(1)->getBytes() : 0;
+    }
+};
+
+KERNEL_ISA_END
+
+REGISTER_KERNEL(Device::CPU, OpType::MatMul, NaiveMatmul, "MatmulNaive_CPU");
+
+} // namespace infini
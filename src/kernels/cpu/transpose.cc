@@ -3,45 +3,55 @@
 
 namespace infini {
 
-inline Shape idx2Pos(const Shape &shape, size_t idx) {
-    Shape pos = Shape(shape.size(), 0);
-    auto rest = idx, curDimId = shape.size() - 1;
-    while (rest > 0) {
-        pos[curDimId] = rest % shape[curDimId];
-        rest /= shape[curDimId];
-        curDimId--;
-    }
-    return pos;
-}
-
 class NaiveTranspose : public CpuKernelWithoutConfig {
+    struct Args : KernelArgs {
+        size_t n;
+        // input dims and the output stride of every input dim
+        Shape inDim, outStride;
+    };
+
     template <typename T>
-    void doCompute(const Operator &_op, const RuntimeObj *context) const {
+    static void doCompute(const KernelArgs *_args, void *const *data,
+                          const RuntimeObj *context) {
+        auto args = static_cast<const Args *>(_args);
+        auto inPtr = static_cast<const T *>(data[0]);
+        auto outPtr = static_cast<T *>(data[1]);
+        const auto &inDim = args->inDim;
+        const auto &outStride = args->outStride;
+        const auto rank = inDim.size();
+
+        context->parallelFor(0, args->n, 0, [&](size_t begin, size_t end) {
+            for (size_t inIdx = begin; inIdx < end; ++inIdx) {
+                size_t rest = inIdx, outIdx = 0;
+                for (auto j = rank; j > 0; --j) {
+                    outIdx += rest % inDim[j - 1] * outStride[j - 1];
+                    rest /= inDim[j - 1];
+                }
+                outPtr[outIdx] = inPtr[inIdx];
+            }
+        });
+    }
+
+    PreparedKernel prepare(const Operator &_op,
+                           const RuntimeObj *context) const override {
         auto op = as<TransposeObj>(_op);
-        auto inputs = op->getInputs(), outputs = op->getOutputs();
-        const auto &inDim = inputs[0]->getDims();
+        const auto &inDim = op->getInputs(0)->getDims();
         const auto &perm = op->getPermute();
 
-        size_t inSize = inputs[0]->size();
-        auto inPtr = inputs[0]->getRawDataPtr<T *>(),
-             outPtr = outputs[0]->getRawDataPtr<T *>();
-        // #pragma omp parallel for
-        for (size_t inIdx = 0; inIdx < inSize; ++inIdx) {
-            auto posInput = idx2Pos(inDim, inIdx);
-            int outIdx = 0;
-            for (size_t j = 0, jEnd = perm.size(); j < jEnd; ++j) {
-                outIdx = outIdx * inDim[perm[j]] + posInput[perm[j]];
-            }
-            outPtr[outIdx] = inPtr[inIdx];
+        auto args = make_ref<Args>();
+        args->n = op->getInputs(0)->size();
+        args->inDim = inDim;
+        args->outStride = Shape(perm.size());
+        for (size_t j = perm.size(), p = 1; j > 0; --j) {
+            args->outStride[perm[j - 1]] = p;
+            p *= inDim[perm[j - 1]];
         }
-    }
 
-    void compute(const Operator &_op,
-                 const RuntimeObj *context) const override {
 #define CASE(N)                                                                \
     case N:                                                                    \
-        doCompute<DT<N>::t>(_op, context)
+        func = doCompute<DT<N>::t>
 
+        KernelFunc func = nullptr;
         int dataTypeIdx = _op->getDType().getIndex();
         switch (dataTypeIdx) {
             CASE(1); // DataType::Float32
@@ -51,6 +61,8 @@ class NaiveTranspose : public CpuKernelWithoutConfig {
         default:
             IT_TODO_HALT();
         }
+#undef CASE
+        return {func, args};
     }
 };
 
@@ -2,41 +2,51 @@
 #include "core/kernel.h"
 
 namespace infini {
+KERNEL_ISA_BEGIN
+
 class NativeUnary : public CpuKernelWithoutConfig {
+    struct Args : KernelArgs {
+        size_t n;
+    };
+
     template <typename T> static T reluCompute(T val) {
         return std::max(T(0), val);
     }
 
-    template <typename T>
-    void doCompute(const Operator &_op, const RuntimeObj *context) const {
-        auto op = as<UnaryObj>(_op);
-        T *inptr = op->getInputs(0)->getRawDataPtr<T *>();
-        T *outptr = op->getOutput()->getRawDataPtr<T *>();
+    template <typename T, T (*_doCompute)(T)>
+    static void doCompute(const KernelArgs *_args, void *const *data,
+                          const RuntimeObj *context) {
+        auto args = static_cast<const Args *>(_args);
+        auto inptr = static_cast<const T *>(data[0]);
+        auto outptr = static_cast<T *>(data[1]);
 
-        auto outDim = op->getOutput()->getDims();
-        auto n = op->getOutput()->size();
+        context->parallelFor(0, args->n, 0, [&](size_t begin, size_t end) {
+            for (size_t offset = begin; offset < end; offset++) {
+                outptr[offset] = _doCompute(inptr[offset]);
+            }
+        });
+    }
 
-        T(*_doCompute)
-        (T val);
-        switch (op->getOpType().underlying()) {
+    template <typename T> static KernelFunc select(OpType type) {
+        switch (type.underlying()) {
         case OpType::Relu:
-            _doCompute = reluCompute<T>;
-            break;
+            return doCompute<T, reluCompute<T>>;
         default:
             IT_TODO_HALT();
         }
-
-        for (size_t offset = 0; offset < n; offset++) {
-            outptr[offset] = _doCompute(inptr[offset]);
-        }
     }
 
-    void compute(const Operator &_op,
-                 const RuntimeObj *context) const override {
+    PreparedKernel prepare(const Operator &_op,
+                           const RuntimeObj *context) const override {
+        auto op = as<UnaryObj>(_op);
+        auto args = make_ref<Args>();
+        args->n = op->getOutput()->size();
+
 #define CASE(N)                                                                \
     case N:                                                                    \
-        doCompute<DT<N>::t>(_op, context)
+        func = select<DT<N>::t>(op->getOpType())
 
+        KernelFunc func = nullptr;
         int dataTypeIdx = _op->getDType().getIndex();
         switch (dataTypeIdx) {
             CASE(1); // DataType::Float32
@@ -46,33 +56,49 @@ class NativeUnary : public CpuKernelWithoutConfig {
         default:
             IT_TODO_HALT();
         }
+#undef CASE
+        return {func, args};
     }
 };
 
 class Clip : public CpuKernelWithoutConfig {
+    struct Args : KernelArgs {
+        size_t n;
+        std::optional<float> minValue, maxValue;
+    };
+
     template <typename T>
-    void doCompute(const Operator &_op, const RuntimeObj *context) const {
-        auto op = as<ClipObj>(_op);
-        T *inptr = op->getInputs(0)->getRawDataPtr<T *>();
-        T *outptr = op->getOutput()->getRawDataPtr<T *>();
-        auto minValue = op->getMin();
-        auto maxValue = op->getMax();
-
-        auto n = op->getOutput()->size();
-        for (size_t offset = 0; offset < n; offset++) {
-            auto val = *inptr++;
-            *outptr++ = (minValue && val < *minValue)   ? *minValue
-                        : (maxValue && val > *maxValue) ? *maxValue
-                                                        : val;
-        }
+    static void doCompute(const KernelArgs *_args, void *const *data,
+                          const RuntimeObj *context) {
+        auto args = static_cast<const Args *>(_args);
+        auto inptr = static_cast<const T *>(data[0]);
+        auto outptr = static_cast<T *>(data[1]);
+        auto minValue = args->minValue;
+        auto maxValue = args->maxValue;
+
+        context->parallelFor(0, args->n, 0, [&](size_t begin, size_t end) {
+            for (size_t offset = begin; offset < end; offset++) {
+                auto val = inptr[offset];
+                outptr[offset] = (minValue && val < *minValue)   ? *minValue
+                                 : (maxValue && val > *maxValue) ? *maxValue
+                                                                 : val;
+            }
+        });
     }
 
-    void compute(const Operator &_op,
-                 const RuntimeObj *context) const override {
+    PreparedKernel prepare(const Operator &_op,
+                           const RuntimeObj *context) const override {
+        auto op = as<ClipObj>(_op);
+        auto args = make_ref<Args>();
+        args->n = op->getOutput()->size();
+        args->minValue = op->getMin();
+        args->maxValue = op->getMax();
+
 #define CASE(N)                                                                \
     case N:                                                                    \
-        doCompute<DT<N>::t>(_op, context)
+        func = doCompute<DT<N>::t>
 
+        KernelFunc func = nullptr;
         int dataTypeIdx = _op->getDType().getIndex();
         switch (dataTypeIdx) {
             CASE(1); // DataType::Float32
@@ -82,9 +108,13 @@ class Clip : public CpuKernelWithoutConfig {
         default:
             IT_TODO_HALT();
         }
+#undef CASE
+        return {func, args};
     }
 };
 
+KERNEL_ISA_END
+
 REGISTER_KERNEL(Device::CPU, OpType::Relu, NativeUnary, "reluNaive_CPU");
 REGISTER_KERNEL(Device::CPU, OpType::Clip, Clip, "Clip_CPU");
 
@@ -0,0 +1,55 @@
+#include "operators/collective.h"
+#include "utils/operator_utils.h"
+
+namespace infini {
+AllReduceSumObj::AllReduceSumObj(GraphObj *graph, Tensor input, Tensor output,
+                                 Communicator comm)
+    : OperatorObj(OpType::AllReduceSum, {input}, {output}),
+      comm(std::move(comm)) {
+    IT_ASSERT(this->comm != nullptr);
+    IT_ASSERT(checkValid(graph));
+}
+
+optional<vector<Shape>> AllReduceSumObj::inferShape(const TensorVec &inputs) {
+    return {{inputs[0]->getDims()}};
+}
+
+std::string AllReduceSumObj::toString() const {
+    std::ostringstream os;
+    os << type.toString() << "[" << getGuid() << "]";
+    os << "(";
+    os << vecToString(inputs[0]->getDims()) << ",";
+    os << "ranks=" << comm->getWorldSize() << ",";
+    os << "input=" << inputs[0]->getGuid() << ",";
+    os << "output=" << outputs[0]->getGuid() << ")";
+    return os.str();
+}
+
+AllGatherObj::AllGatherObj(GraphObj *graph, Tensor input, Tensor output,
+                           Communicator comm, int _dim)
+    : OperatorObj(OpType::AllGather, {input}, {output}),
+      comm(std::move(comm)) {
+    IT_ASSERT(this->comm != nullptr);
+    dim = get_real_axis(_dim, input->getRank());
+    IT_ASSERT(checkValid(graph));
+}
+
+optional<vector<Shape>> AllGatherObj::inferShape(const TensorVec &inputs) {
+    auto dims = inputs[0]->getDims();
+    dims[dim] *= comm->getWorldSize();
+    return {{dims}};
+}
+
+std::string AllGatherObj::toString() const {
+    std::ostringstream os;
+    os << type.toString() << "[" << getGuid() << "]";
+    os << "(";
+    os << vecToString(inputs[0]->getDims()) << ",";
+    os << "dim=" << dim << ",";
+    os << "ranks=" << comm->getWorldSize() << ",";
+    os << "input=" << inputs[0]->getGuid() << ",";
+    os << "output=" << outputs[0]->getGuid() << ")";
+    return os.str();
+}
+
+} // namespace infini
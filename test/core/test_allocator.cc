@@ -51,6 +51,43 @@ namespace infini
         EXPECT_EQ(offsetC, offsetD);
     }
 
+    TEST(Allocator, testAllocKeepsRemainder)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Allocator allocator = Allocator(runtime);
+        // a multiple of the alignment
+        const size_t unit = 64;
+        size_t offsetA = allocator.alloc(4 * unit);
+        allocator.alloc(unit);
+        // free a, then allocate two blocks inside it
+        allocator.free(offsetA, 4 * unit);
+        size_t offsetB = allocator.alloc(unit);
+        size_t offsetC = allocator.alloc(unit);
+        // expected to be b->c->(free)->guard
+        EXPECT_EQ(offsetB, offsetA);
+        EXPECT_EQ(offsetC, offsetA + unit);
+    }
+
+    TEST(Allocator, testAllocExtendsOnlyTheEndFreeBlock)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Allocator allocator = Allocator(runtime);
+        const size_t unit = 64;
+        size_t offsetA = allocator.alloc(unit);
+        allocator.alloc(unit);
+        size_t offsetC = allocator.alloc(unit);
+        // the free block a does not end the pool, so d goes after c
+        allocator.free(offsetA, unit);
+        size_t offsetD = allocator.alloc(2 * unit);
+        EXPECT_EQ(offsetD, offsetC + unit);
+        // the free block d ends the pool and is extended, moving the peak
+        allocator.free(offsetD, 2 * unit);
+        size_t offsetE = allocator.alloc(3 * unit);
+        EXPECT_EQ(offsetE, offsetD);
+        size_t offsetF = allocator.alloc(2 * unit);
+        EXPECT_EQ(offsetF, offsetE + 3 * unit);
+    }
+
     TEST(Allocator, testGetPtr)
     {
         Shape shape = Shape{1, 2, 2, 3};
@@ -71,4 +108,80 @@ namespace infini
         EXPECT_EQ(ptr1, ptr2);
     }
 
+    TEST(Allocator, testCoalesce)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Allocator allocator = Allocator(runtime);
+        // allocate a->b->c->d
+        size_t offsetA = allocator.alloc(64);
+        size_t offsetB = allocator.alloc(64);
+        size_t offsetC = allocator.alloc(64);
+        allocator.alloc(64);
+        // free a and c, two separate blocks
+        allocator.free(offsetA, 64);
+        allocator.free(offsetC, 64);
+        EXPECT_EQ(allocator.getFreeBlocks(), 2u);
+        // free b, merged with both neighbors
+        allocator.free(offsetB, 64);
+        EXPECT_EQ(allocator.getFreeBlocks(), 1u);
+        // the merged block fits a larger tensor without growing the pool
+        EXPECT_EQ(allocator.alloc(192), offsetA);
+        EXPECT_EQ(allocator.getPeak(), 256u);
+        EXPECT_EQ(allocator.getFreeBlocks(), 0u);
+    }
+
+    TEST(Allocator, testCoalesceTail)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Allocator allocator = Allocator(runtime);
+        // allocate a->b->c
+        allocator.alloc(64);
+        size_t offsetB = allocator.alloc(64);
+        size_t offsetC = allocator.alloc(64);
+        // free c then b, merged into one block at the end of the pool
+        allocator.free(offsetC, 64);
+        allocator.free(offsetB, 64);
+        EXPECT_EQ(allocator.getFreeBlocks(), 1u);
+        // a larger tensor extends the free block at the end
+        EXPECT_EQ(allocator.alloc(192), offsetB);
+        EXPECT_EQ(allocator.getPeak(), offsetB + 192);
+        EXPECT_EQ(allocator.getUsed(), 256u);
+    }
+
+    TEST(Allocator, testAlignment)
+    {
+        Runtime runtime = make_ref<NativeCpuRuntimeObj>();
+        Graph g = make_ref<GraphObj>(runtime);
+        // odd sizes, which would leave the next tensor unaligned
+        auto x = g->addTensor({3, 5}, DataType::Float32);
+        auto t = g->addOp<ReluObj>(x, nullptr)->getOutput();
+        g->addOp<ReluObj>(t, nullptr);
+        g->dataMalloc();
+        for (auto &tensor : g->getTensors())
+        {
+            auto ptr = tensor->getRawDataPtr<void *>();
+            EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % RuntimeObj::alignment,
+                      0u);
+        }
+    }
+
+    TEST(Allocator, testMappedMemory)
+    {
+        auto runtime = make_ref<NativeCpuRuntimeObj>();
+        MemoryConfig config;
+        config.mmapThreshold = 4096;
+        config.prefault = true;
+        runtime->setMemoryConfig(config);
+        // from the heap, then mapped, then mapped over a huge page
+        for (size_t size : {100, 10000, 5 << 20})
+        {
+            auto ptr = static_cast<char *>(runtime->alloc(size));
+            EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % RuntimeObj::alignment,
+                      0u);
+            std::fill(ptr, ptr + size, 1);
+            EXPECT_EQ(ptr[size - 1], 1);
+            runtime->dealloc(ptr);
+        }
+    }
+
 } // namespace infini
@@ -0,0 +1,130 @@
+#include "core/aot.h"
+#include "core/graph.h"
+#include "core/runtime.h"
+#include "operators/concat.h"
+#include "operators/element_wise.h"
+#include "operators/matmul.h"
+#include "operators/transpose.h"
+#include "operators/unary.h"
+
+#include "test.h"
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+namespace infini {
+
+static void fill(const Tensor &t, float scale) {
+    auto ptr = t->getRawDataPtr<float *>();
+    for (size_t i = 0; i < t->size(); ++i)
+        ptr[i] = float(int(i * 7 % 13) - 6) * scale;
+}
+
+// x[2, 3, 4] -> MatMul(w^T[1, 4, 5]) -> Add(b[5]) -> Relu -> Clip(max = 3)
+// -> Transpose -> Concat(z[2, 1, 3]) -> Mul(z2[2, 6, 3]) -> y[2, 6, 3]
+static Graph build(Runtime runtime) {
+    Graph g = make_ref<GraphObj>(runtime);
+    auto x = g->addTensor({2, 3, 4});
+    auto z = g->addTensor({2, 1, 3});
+    auto z2 = g->addTensor({2, 6, 3});
+    auto w = g->addTensor({1, 5, 4});
+    auto b = g->addTensor(Shape{5});
+    w->setWeight();
+    b->setWeight();
+    auto m = g->addOp<MatmulObj>(x, w, nullptr, false, true)->getOutput();
+    auto a = g->addOp<AddObj>(m, b, nullptr)->getOutput();
+    auto r = g->addOp<ReluObj>(a, nullptr)->getOutput();
+    auto c = g->addOp<ClipObj>(r, nullptr, std::nullopt, 3.f)->getOutput();
+    auto t = g->addOp<TransposeObj>(c, nullptr, Shape{0, 2, 1})->getOutput();
+    auto cat = g->addOp<ConcatObj>(TensorVec{t, z}, nullptr, 1)->getOutput();
+    g->addOp<MulObj>(cat, z2, nullptr);
+    g->dataMalloc();
+    fill(w, 0.5f);
+    fill(b, 0.25f);
+    return g;
+}
+
+TEST(Aot, Emit) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    auto g = build(runtime);
+    auto source = emitCpp(g, "net");
+    EXPECT_NE(source.find("extern \"C\" void net("), string::npos);
+    EXPECT_EQ(source.find("shared_ptr"), string::npos);
+    // the transposed weights are packed into the workspace
+    EXPECT_NE(source.find("w[i0 * 20 + i1 * 5 + i2] = x1[i0 * 20 + i1 + "
+                          "i2 * 4];"),
+              string::npos);
+    EXPECT_EQ(emitCpp(g, "net"), source);
+
+    Graph h = make_ref<GraphObj>(runtime);
+    auto x = h->addTensor({2, 3});
+    h->addOp<CastObj>(x, nullptr, CastType::Float2Int32);
+    h->dataMalloc();
+    EXPECT_ANY_THROW(emitCpp(h));
+}
+
+TEST(Aot, Compile) {
+    const char *cxx = std::getenv("CXX") ? std::getenv("CXX") : "c++";
+    if (std::system((string(cxx) + " --version > /dev/null 2>&1").c_str()))
+        GTEST_SKIP() << "no host compiler";
+
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    auto g = build(runtime);
+    auto inputs = g->getInputs(), outputs = g->getOutputs();
+    inputs.erase(std::remove_if(inputs.begin(), inputs.end(),
+                                [](auto &t) { return t->isWeight(); }),
+                 inputs.end());
+    ASSERT_EQ(inputs.size(), 3u);
+    ASSERT_EQ(outputs.size(), 1u);
+    for (size_t i = 0; i < inputs.size(); ++i)
+        fill(inputs[i], float(i + 1) / 4);
+    runtime->run(g);
+
+    // a driver reading the inputs from a file and writing the output to
+    // another one
+    auto directory = std::filesystem::temp_directory_path() / "test_aot";
+    std::filesystem::create_directories(directory);
+    std::ofstream(directory / "net.cc") << emitCpp(g, "net");
+    {
+        std::ofstream in(directory / "in.bin", std::ios::binary);
+        std::ofstream driver(directory / "main.cc");
+        driver << "#include <fstream>\n#include <vector>\n"
+               << "extern \"C\" void net(const void *const *, void *const "
+                  "*);\n"
+               << "int main(int, char **argv) {\n"
+               << "    std::ifstream in(argv[1], std::ios::binary);\n"
+               << "    std::vector<std::vector<float>> x;\n";
+        for (const auto &t : inputs) {
+            in.write(t->getRawDataPtr<const char *>(), t->getBytes());
+            driver << "    x.emplace_back(" << t->size() << ");\n"
+                   << "    in.read(reinterpret_cast<char *>(x.back().data()),"
+                   << t->getBytes() << ");\n";
+        }
+        driver << "    const void *inputs[] = {x[0].data(), x[1].data(), "
+                  "x[2].data()};\n"
+               << "    std::vector<float> y(" << outputs[0]->size() << ");\n"
+               << "    void *outputs[] = {y.data()};\n"
+               << "    net(inputs, outputs);\n"
+               << "    std::ofstream(argv[2], std::ios::binary).write("
+                  "reinterpret_cast<char *>(y.data()), "
+               << outputs[0]->getBytes() << ");\n"
+               << "}\n";
+    }
+    auto d = directory.string();
+    auto command = string(cxx) + " -std=c++17 -O2 -Wall -Werror " + d +
+                   "/net.cc " + d + "/main.cc -o " + d + "/net && " + d +
+                   "/net " + d + "/in.bin " + d + "/out.bin";
+    ASSERT_EQ(std::system(command.c_str()), 0) << command;
+
+    vector<float> expected(outputs[0]->size()), actual(outputs[0]->size());
+    auto ptr = outputs[0]->getRawDataPtr<const float *>();
+    expected.assign(ptr, ptr + expected.size());
+    std::ifstream(directory / "out.bin", std::ios::binary)
+        .read(reinterpret_cast<char *>(actual.data()),
+              outputs[0]->getBytes());
+    std::filesystem::remove_all(directory);
+    for (size_t i = 0; i < expected.size(); ++i)
+        EXPECT_NEAR(actual[i], expected[i], 1e-5f) << i;
+}
+
+} // namespace infini
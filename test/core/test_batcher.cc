@@ -0,0 +1,68 @@
+#include "core/batcher.h"
+#include "operators/element_wise.h"
+#include "operators/unary.h"
+
+#include "test.h"
+
+namespace infini {
+
+// y = relu(x * w) for x of shape [batch, 4]
+static BatchedGraph build(Runtime runtime, size_t batch) {
+    Graph g = make_ref<GraphObj>(runtime);
+    auto x = g->addTensor({int(batch), 4}, DataType::Float32);
+    auto w = g->addTensor({4}, DataType::Float32);
+    auto t = g->addOp<MulObj>(x, w, nullptr)->getOutput();
+    auto y = g->addOp<ReluObj>(t, nullptr)->getOutput();
+    g->dataMalloc();
+    w->setData(IncrementalGenerator());
+    return {g, {x}, {y}};
+}
+
+static Batcher::Buffers sample(float v) {
+    vector<float> x(4, v);
+    auto bytes = reinterpret_cast<uint8_t *>(x.data());
+    return {vector<uint8_t>(bytes, bytes + sizeof(float) * 4)};
+}
+
+static vector<float> result(const Batcher::Buffers &outputs) {
+    auto ptr = reinterpret_cast<const float *>(outputs.at(0).data());
+    return vector<float>(ptr, ptr + 4);
+}
+
+TEST(Batcher, CoalescesRequests) {
+    Runtime runtime = make_ref<NativeCpuRuntimeObj>();
+    Batcher batcher(
+        runtime, [&](size_t batch) { return build(runtime, batch); },
+        {4, std::chrono::milliseconds(50)});
+
+    const int nThreads = 4, nRequests = 8;
+    vector<std::thread> threads;
+    std::atomic<int> failures{0};
+    for (int t = 0; t < nThreads; ++t) {
+        threads.emplace_back([&, t] {
+            for (int r = 0; r < nRequests; ++r) {
+                float v = t * nRequests + r;
+                auto y = result(batcher.submit(sample(v)).get());
+                if (y != vector<float>{0, v, 2 * v, 3 * v})
+                    failures++;
+            }
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+    EXPECT_EQ(failures, 0);
+    EXPECT_EQ(batcher.getRequests(), size_t(nThreads * nRequests));
+    EXPECT_LT(batcher.getBatches(), size_t(nThreads * nRequests));
+}
+
+TEST(Batcher, BadRequest) {
+    Runtime runtime = make_ref<NativeCpuRuntimeObj>();
+    Batcher batcher(runtime,
+                    [&](size_t batch) { return build(runtime, batch); });
+    auto bad = batcher.submit({vector<uint8_t>(3)});
+    EXPECT_THROW(bad.get(), Exception);
+    EXPECT_EQ(result(batcher.submit(sample(-1)).get()),
+              (vector<float>{0, 0, 0, 0}));
+}
+
+} // namespace infini
@@ -0,0 +1,130 @@
+#include "core/context.h"
+#include "core/graph.h"
+#include "core/runtime.h"
+#include "operators/element_wise.h"
+#include "operators/unary.h"
+
+#include "test.h"
+
+namespace infini {
+
+// o = relu(x * w) + x
+static Graph buildGraph(Runtime runtime) {
+    Graph g = make_ref<GraphObj>(runtime);
+    auto x = g->addTensor({2, 8}, DataType::Float32);
+    auto w = g->addTensor({8}, DataType::Float32);
+    w->setWeight();
+    auto t = g->addOp<MulObj>(x, w, nullptr)->getOutput();
+    t = g->addOp<ReluObj>(t, nullptr)->getOutput();
+    g->addOp<AddObj>(t, x, nullptr);
+    g->dataMalloc();
+    w->setData(IncrementalGenerator());
+    return g;
+}
+
+static vector<float> expected(float x) {
+    vector<float> ret;
+    for (int i = 0; i < 16; ++i)
+        ret.emplace_back(std::max(x * (i % 8), 0.f) + x);
+    return ret;
+}
+
+TEST(Context, RunAsync) {
+    auto runtime = make_ref<NativeCpuRuntimeObj>();
+    Graph g = buildGraph(runtime);
+    auto x = g->getInputs()[0], o = g->getOutputs()[0];
+    auto plan = runtime->compile(g);
+
+    auto c1 = make_ref<ContextObj>(plan), c2 = make_ref<ContextObj>(plan);
+    EXPECT_NE(c1->getRawDataPtr<void *>(o), c2->getRawDataPtr<void *>(o));
+    // weights are not copied into the contexts
+    auto w = g->getInputs()[1];
+    EXPECT_TRUE(w->isWeight());
+    EXPECT_EQ(c1->getRawDataPtr<void *>(w), w->getRawDataPtr<void *>());
+    EXPECT_EQ(c2->getRawDataPtr<void *>(w), w->getRawDataPtr<void *>());
+    // the 32 bytes of w are padded to the alignment of the runtime
+    EXPECT_EQ(g->getWeightsSize(), RuntimeObj::alignment);
+    EXPECT_EQ(g->getArenaSize(), 3 * x->getBytes());
+    c1->setData(x, ValGenerator<2>());
+    c2->setData(x, ValGenerator<3>());
+    auto f1 = runtime->runAsync(c1), f2 = runtime->runAsync(c2);
+    f1.get();
+    f2.get();
+    auto out = [&](const Context &c) {
+        auto ptr = c->getRawDataPtr<float *>(o);
+        return vector<float>(ptr, ptr + o->size());
+    };
+    EXPECT_EQ(out(c1), expected(2));
+    EXPECT_EQ(out(c2), expected(3));
+}
+
+TEST(Context, Pipeline) {
+    auto runtime = make_ref<NativeCpuRuntimeObj>();
+    Graph g = buildGraph(runtime);
+    auto x = g->getInputs()[0], o = g->getOutputs()[0];
+    Pipeline pipeline(runtime->compile(g), 3);
+
+    vector<vector<float>> outputs(10);
+    vector<std::future<void>> futures;
+    for (int i = 0; i < 10; ++i) {
+        futures.emplace_back(pipeline.submit(
+            [&, i](ContextObj &c) {
+                auto ptr = c.getRawDataPtr<float *>(x);
+                std::fill(ptr, ptr + x->size(), float(i));
+            },
+            [&, i](ContextObj &c) {
+                auto ptr = c.getRawDataPtr<float *>(o);
+                outputs[i].assign(ptr, ptr + o->size());
+            }));
+    }
+    for (auto &f : futures)
+        f.get();
+    for (int i = 0; i < 10; ++i)
+        EXPECT_EQ(outputs[i], expected(i));
+}
+
+TEST(Context, Bind) {
+    auto runtime = make_ref<NativeCpuRuntimeObj>();
+    Graph g = buildGraph(runtime);
+    auto x = g->getInputs()[0], o = g->getOutputs()[0];
+    auto arena = g->getArenaSize();
+    g->setBound(x);
+    g->setBound(o);
+    g->dataMalloc();
+    // only the intermediate tensors are left in the arena
+    EXPECT_LT(g->getArenaSize(), arena);
+    EXPECT_FALSE(x->hasData());
+    EXPECT_FALSE(o->hasData());
+    auto plan = runtime->compile(g);
+    auto context = make_ref<ContextObj>(plan);
+    EXPECT_ANY_THROW(runtime->run(context));
+
+    const auto buffer = [&] {
+        auto ptr = static_cast<float *>(runtime->alloc(x->getBytes()));
+        return std::shared_ptr<float>(ptr,
+                                      [&](float *p) { runtime->dealloc(p); });
+    };
+    auto in1 = buffer(), in2 = buffer(), out = buffer();
+    std::fill(in1.get(), in1.get() + x->size(), 2.f);
+    std::fill(in2.get(), in2.get() + x->size(), 3.f);
+    EXPECT_ANY_THROW(context->bind(x, in1.get() + 1));
+    context->bind(x, in1.get());
+    context->bind(o, out.get());
+    EXPECT_EQ(context->getRawDataPtr<float *>(x), in1.get());
+    runtime->run(context);
+    EXPECT_EQ(vector<float>(out.get(), out.get() + o->size()), expected(2));
+    // the inputs are read in place
+    context->bind(x, in2.get());
+    runtime->run(context);
+    EXPECT_EQ(vector<float>(out.get(), out.get() + o->size()), expected(3));
+
+    // bound tensors stay out of the arena when the graph is allocated again
+    g->dataMalloc();
+    EXPECT_FALSE(x->hasData());
+    g->setBound(x, false);
+    g->dataMalloc();
+    EXPECT_TRUE(x->hasData());
+    EXPECT_ANY_THROW(g->setBound(g->getInputs()[1]));
+}
+
+} // namespace infini
@@ -1,8 +1,10 @@
 #include "core/graph.h"
 #include "core/kernel.h"
 #include "core/runtime.h"
+#include "operators/element_wise.h"
 #include "operators/matmul.h"
 #include "operators/transpose.h"
+#include "operators/unary.h"
 
 #include "test.h"
 
@@ -37,4 +39,120 @@ namespace infini
         EXPECT_EQ(op->getTransA(), false);
         EXPECT_EQ(op->getTransB(), true);
     }
-}
\ No newline at end of file
+
+    // every op is placed after the producers of its inputs
+    static bool isTopoOrder(const OpVec &ops)
+    {
+        std::unordered_set<OperatorObj *> done;
+        for (auto &op : ops)
+        {
+            for (auto &input : op->getInputs())
+                if (auto src = input->getSource(); src && !done.count(src.get()))
+                    return false;
+            done.insert(op.get());
+        }
+        return true;
+    }
+
+    TEST(Graph, TopoSort)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        // a chain whose ops are added back to front
+        const int n = 64;
+        TensorVec ts;
+        for (int i = 0; i <= n; ++i)
+            ts.emplace_back(g->addTensor({2, 3}, DataType::Float32));
+        for (int i = n - 1; i >= 0; --i)
+            g->addOpWithOutputs<ReluObj>(ts[i], ts[i + 1]);
+        EXPECT_FALSE(isTopoOrder(g->getOperators()));
+        EXPECT_TRUE(g->topo_sort());
+        EXPECT_TRUE(isTopoOrder(g->getOperators()));
+        EXPECT_EQ(g->getOperators().front()->getInputs(0), ts[0]);
+        EXPECT_EQ(g->getOperators().back()->getOutput(), ts[n]);
+    }
+
+    TEST(Graph, TopoSortCycle)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor a = g->addTensor({2, 3}, DataType::Float32);
+        Tensor b = g->addTensor({2, 3}, DataType::Float32);
+        g->addOpWithOutputs<ReluObj>(a, b);
+        g->addOpWithOutputs<ReluObj>(b, a);
+        EXPECT_FALSE(g->topo_sort());
+    }
+
+    TEST(Graph, TopoSortIncremental)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor i = g->addTensor({2, 3}, DataType::Float32);
+        Tensor t = g->addTensor({2, 3}, DataType::Float32);
+        Tensor o = g->addTensor({2, 3}, DataType::Float32);
+        auto first = g->addOpWithOutputs<ReluObj>(i, t);
+        auto last = g->addOpWithOutputs<ReluObj>(t, o);
+        ASSERT_TRUE(g->topo_sort());
+        // rewrite i -> t -> o into i -> t' -> t -> o
+        Tensor t2 = g->addTensor({2, 3}, DataType::Float32);
+        g->removeOperator(first);
+        g->addOpWithOutputs<ReluObj>(t2, t);
+        g->addOpWithOutputs<ReluObj>(i, t2);
+        EXPECT_TRUE(isTopoOrder(g->getOperators()));
+        EXPECT_EQ(g->getOperators().back(), last);
+        EXPECT_TRUE(g->topo_sort());
+        EXPECT_EQ(g->getOperators().size(), 3);
+    }
+
+    TEST(Graph, TensorTypes)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({2, 3}, DataType::Float32);
+        Tensor w = g->addTensor({2, 3}, DataType::Float32);
+        Tensor c = g->addTensor({3}, DataType::Float32);
+        w->setTensorType(TensorType::Weight);
+        c->setTensorType(TensorType::Constant);
+        Tensor t = g->addOp<MulObj>(x, w, nullptr)->getOutput();
+        Tensor o = g->addOp<AddObj>(t, c, nullptr)->getOutput();
+        EXPECT_EQ(x->getTensorType(), TensorType::Input);
+        EXPECT_EQ(w->getTensorType(), TensorType::Weight);
+        EXPECT_EQ(c->getTensorType(), TensorType::Constant);
+        EXPECT_EQ(t->getTensorType(), TensorType::Activation);
+        EXPECT_EQ(o->getTensorType(), TensorType::Output);
+        EXPECT_ANY_THROW(x->setTensorType(TensorType::Input));
+
+        // only inputs, outputs and activations are in the arena
+        g->dataMalloc();
+        EXPECT_EQ(g->getWeightsSize(), 2 * RuntimeObj::alignment);
+        EXPECT_EQ(g->getArenaSize(), 3 * RuntimeObj::alignment);
+        auto weights = reinterpret_cast<char *>(g->getWeights());
+        for (auto &tensor : {w, c})
+        {
+            auto ptr = tensor->getRawDataPtr<char *>();
+            EXPECT_TRUE(ptr >= weights && ptr < weights + g->getWeightsSize());
+        }
+    }
+
+    TEST(Graph, ProtectWeights)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({4}, DataType::Float32);
+        Tensor w = g->addTensor({4}, DataType::Float32);
+        w->setWeight();
+        Tensor o = g->addOp<MulObj>(x, w, nullptr)->getOutput();
+        g->dataMalloc();
+        x->setData(IncrementalGenerator());
+        w->setData(OneGenerator());
+        g->protectWeights();
+        // reading the weights still works, writing them crashes
+        runtime->run(g);
+        EXPECT_TRUE(o->equalData(vector<float>{0, 1, 2, 3}));
+        EXPECT_DEATH(w->setData(ZeroGenerator()), "");
+        g->protectWeights(false);
+        w->setData(ZeroGenerator());
+        runtime->run(g);
+        EXPECT_TRUE(o->equalData(vector<float>{0, 0, 0, 0}));
+    }
+}
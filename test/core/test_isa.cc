@@ -0,0 +1,64 @@
+#include "core/isa.h"
+#include "core/kernel.h"
+
+#include "test.h"
+
+namespace infini {
+
+TEST(Isa, Select) {
+    for (auto isa : {Isa::Baseline, Isa::SSE42, Isa::AVX2, Isa::AVX512})
+        EXPECT_EQ(parseIsa(toString(isa)), isa);
+    EXPECT_FALSE(parseIsa("avx3"));
+    EXPECT_LE(getIsa(), getHostIsa());
+}
+
+class IsaKernel : public Kernel {
+  public:
+    void compute(const Operator &op, const RuntimeObj *context) const override {
+    }
+};
+
+TEST(Isa, Register) {
+    KernelRegistry registry;
+    const KernelAttrs key{Device::CPU, OpType::Relu};
+    const auto make = []() -> Kernel * { return new IsaKernel(); };
+    // the best variant not above the selected ISA is kept, in any order
+    EXPECT_TRUE(registry.registerKernel(key, getIsa(), make, "relu"));
+    EXPECT_ANY_THROW(registry.registerKernel(key, getIsa(), make, "relu"));
+    if (getIsa() != Isa::Baseline) {
+        EXPECT_FALSE(
+            registry.registerKernel(key, Isa::Baseline, make, "relu"));
+    }
+    if (getIsa() != Isa::AVX512) {
+        EXPECT_FALSE(registry.registerKernel(key, Isa::AVX512, make, "relu"));
+    }
+    const auto &[kernel, name, id, isa] = registry.getKernelItem(key);
+    EXPECT_EQ(isa, getIsa());
+    EXPECT_EQ(name, getIsa() == Isa::Baseline
+                        ? "relu"
+                        : string("relu_") + toString(getIsa()));
+
+    const KernelAttrs other{Device::CPU, OpType::Add};
+    EXPECT_TRUE(registry.registerKernel(other, Isa::Baseline, make, "add"));
+    if (getIsa() != Isa::Baseline) {
+        EXPECT_TRUE(registry.registerKernel(other, Isa::SSE42, make, "add"));
+        EXPECT_EQ(std::get<3>(registry.getKernelItem(other)), Isa::SSE42);
+    }
+}
+
+TEST(Isa, Kernels) {
+    // the kernels with variants run the one of the selected ISA
+    auto &registry = KernelRegistry::getInstance();
+    auto isa = std::get<3>(
+        registry.getKernelItem(KernelAttrs{Device::CPU, OpType::MatMul}));
+#if BUILD_ISA_VARIANTS
+    EXPECT_EQ(isa, getIsa());
+#else
+    EXPECT_EQ(isa, Isa::Baseline);
+#endif
+    EXPECT_EQ(std::get<3>(registry.getKernelItem(
+                  KernelAttrs{Device::CPU, OpType::Transpose})),
+              Isa::Baseline);
+}
+
+} // namespace infini
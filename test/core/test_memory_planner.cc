@@ -0,0 +1,198 @@
+#include "core/graph.h"
+#include "core/memory_planner.h"
+#include "core/runtime.h"
+#include "operators/concat.h"
+#include "operators/element_wise.h"
+#include "operators/matmul.h"
+#include "operators/unary.h"
+
+#include "test.h"
+#include <numeric>
+#include <random>
+
+namespace infini {
+
+using Buffer = MemoryPlanner::Buffer;
+
+// no two buffers alive at the same step overlap in memory
+static bool isValid(const vector<Buffer> &buffers,
+                    const MemoryPlanner::Result &result) {
+    for (size_t i = 0; i < buffers.size(); ++i)
+        for (size_t j = 0; j < i; ++j) {
+            const auto &a = buffers[i], &b = buffers[j];
+            auto oa = result.offsets[i], ob = result.offsets[j];
+            if (a.first <= b.last && b.first <= a.last && oa < ob + b.size &&
+                ob < oa + a.size)
+                return false;
+            if (std::max(oa + a.size, ob + b.size) > result.peak)
+                return false;
+        }
+    return true;
+}
+
+TEST(MemoryPlanner, Strategies) {
+    // replaying the steps leaves a hole at 0 after A is freed, which is too
+    // small for D, while placing D first lets A reuse its memory
+    vector<Buffer> buffers = {{64, 0, 1}, {64, 0, 2}, {64, 1, 3}, {128, 2, 3}};
+    vector<vector<size_t>> steps = {{0, 1}, {0, 2}, {1, 3}, {2, 3}};
+    MemoryPlanner planner(buffers, steps, 64);
+    EXPECT_EQ(planner.lowerBound(), 256u);
+
+    const auto simulation = planner.plan(MemoryStrategy::Simulation);
+    const auto bySize = planner.plan(MemoryStrategy::GreedyBySize);
+    const auto byBreadth = planner.plan(MemoryStrategy::GreedyByBreadth);
+    const auto best = planner.plan(MemoryStrategy::BestOf);
+    for (const auto &r : {simulation, bySize, byBreadth, best}) {
+        EXPECT_TRUE(isValid(buffers, r));
+        EXPECT_GE(r.peak, planner.lowerBound());
+    }
+    EXPECT_EQ(bySize.peak, planner.lowerBound());
+    EXPECT_GT(simulation.peak, bySize.peak);
+    EXPECT_NE(best.strategy, MemoryStrategy::BestOf);
+    EXPECT_EQ(best.peak,
+              std::min({simulation.peak, bySize.peak, byBreadth.peak}));
+    EXPECT_NE(planner.report().find("GreedyByBreadth"), string::npos);
+}
+
+TEST(MemoryPlanner, Random) {
+    std::mt19937 rng(0);
+    for (int round = 0; round < 20; ++round) {
+        size_t n = 1 + rng() % 30;
+        vector<Buffer> buffers;
+        vector<vector<size_t>> steps(n);
+        for (size_t i = 0; i < 2 * n; ++i) {
+            size_t first = rng() % n, last = first + rng() % (n + 1 - first);
+            steps[first].emplace_back(i);
+            if (last < n && last != first)
+                steps[last].emplace_back(i);
+            buffers.push_back({8 * (1 + rng() % 100), first, last});
+        }
+        MemoryPlanner planner(buffers, steps, 8);
+        for (auto strategy :
+             {MemoryStrategy::Simulation, MemoryStrategy::GreedyBySize,
+              MemoryStrategy::GreedyByBreadth, MemoryStrategy::BestOf}) {
+            auto result = planner.plan(strategy);
+            EXPECT_TRUE(isValid(buffers, result)) << toString(strategy);
+            EXPECT_GE(result.peak, planner.lowerBound());
+        }
+    }
+}
+
+TEST(MemoryPlanner, Graph) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    auto build = [&](MemoryStrategy strategy) {
+        // x -> relu -> a (large) -> add b -> ... fan-out of different sizes
+        Graph g = make_ref<GraphObj>(runtime);
+        auto x = g->addTensor({4, 64}, DataType::Float32);
+        auto y = g->addTensor({64}, DataType::Float32);
+        auto a = g->addOp<ReluObj>(x, nullptr)->getOutput();
+        auto b = g->addOp<AddObj>(a, y, nullptr)->getOutput();
+        auto c = g->addOp<ReluObj>(y, nullptr)->getOutput();
+        auto d = g->addOp<MulObj>(b, c, nullptr)->getOutput();
+        auto e = g->addOp<ReluObj>(c, nullptr)->getOutput();
+        g->addOp<SubObj>(d, e, nullptr);
+        g->setMemoryStrategy(strategy);
+        g->dataMalloc();
+        x->setData(IncrementalGenerator());
+        y->setData(OneGenerator());
+        runtime->run(g);
+        return g;
+    };
+    auto reference = build(MemoryStrategy::Simulation);
+    EXPECT_EQ(reference->getPlannedStrategy(), MemoryStrategy::Simulation);
+    for (auto strategy :
+         {MemoryStrategy::GreedyBySize, MemoryStrategy::GreedyByBreadth,
+          MemoryStrategy::BestOf}) {
+        auto g = build(strategy);
+        EXPECT_TRUE(g->getOutputs()[0]->equalData(reference->getOutputs()[0]));
+        if (strategy == MemoryStrategy::BestOf) {
+            EXPECT_NE(g->getPlannedStrategy(), MemoryStrategy::BestOf);
+            EXPECT_LE(g->getArenaSize(), reference->getArenaSize());
+        } else {
+            EXPECT_EQ(g->getPlannedStrategy(), strategy);
+        }
+    }
+    EXPECT_NE(reference->memoryReport().find("LowerBound"), string::npos);
+}
+
+TEST(MemoryScheduler, Exact) {
+    std::mt19937 rng(0);
+    for (int round = 0; round < 20; ++round) {
+        // random DAGs of 6 ops, every op writing one buffer and reading
+        // earlier ones or a graph input
+        const size_t n = 6;
+        vector<size_t> sizes = {8};
+        vector<MemoryScheduler::Op> ops(n);
+        for (size_t i = 0; i < n; ++i) {
+            for (int k = 0; k < 2; ++k)
+                ops[i].inputs.emplace_back(rng() % sizes.size());
+            ops[i].outputs = {sizes.size()};
+            ops[i].workspace = rng() % 2 * 8;
+            sizes.emplace_back(8 * (1 + rng() % 10));
+        }
+        MemoryScheduler scheduler(sizes, ops);
+
+        // the best of all the topological orders
+        vector<size_t> order(n);
+        std::iota(order.begin(), order.end(), 0);
+        size_t best = SIZE_MAX;
+        do {
+            vector<bool> done(sizes.size(), false);
+            done[0] = true;
+            bool valid = true;
+            for (auto i : order) {
+                for (auto b : ops[i].inputs)
+                    valid = valid && done[b];
+                done[ops[i].outputs[0]] = true;
+            }
+            if (valid)
+                best = std::min(best, scheduler.peak(order));
+        } while (std::next_permutation(order.begin(), order.end()));
+        EXPECT_EQ(scheduler.peak(scheduler.schedule()), best);
+    }
+}
+
+TEST(MemoryScheduler, Graph) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    // branches expanding x into a large tensor, then reducing it to a
+    // scalar, concatenated: running each branch to its end keeps one large
+    // tensor live at a time
+    const int branches = 10;
+    Graph g = make_ref<GraphObj>(runtime);
+    auto x = g->addTensor({1, 64}, DataType::Float32);
+    TensorVec ends;
+    for (int b = 0; b < branches; ++b) {
+        auto w = g->addTensor({64, 256}, DataType::Float32);
+        auto v = g->addTensor({256, 1}, DataType::Float32);
+        w->setWeight();
+        v->setWeight();
+        auto big = g->addOp<MatmulObj>(x, w, nullptr)->getOutput();
+        ends.emplace_back(g->addOp<MatmulObj>(big, v, nullptr)->getOutput());
+    }
+    auto o = g->addOp<ConcatObj>(ends, nullptr, 1)->getOutput();
+    auto run = [&] {
+        g->dataMalloc();
+        x->setData(IncrementalGenerator());
+        for (auto &t : g->getTensors())
+            if (t->isWeight())
+                t->setData(OneGenerator());
+        runtime->run(g);
+        return vector<float>(o->getRawDataPtr<float *>(),
+                             o->getRawDataPtr<float *>() + o->size());
+    };
+    auto expected = run();
+    const auto before = g->getArenaSize();
+
+    // the current order fits in a large enough budget
+    EXPECT_TRUE(g->scheduleMemory(before));
+    EXPECT_EQ(run(), expected);
+    EXPECT_EQ(g->getArenaSize(), before);
+    // the graph is larger than the exact limit, so it is scheduled greedily
+    EXPECT_GT(g->getOperators().size(), MemoryScheduler::maxExactOps);
+    EXPECT_TRUE(g->scheduleMemory());
+    EXPECT_EQ(run(), expected);
+    EXPECT_LT(g->getArenaSize() * 4, before);
+    EXPECT_FALSE(g->scheduleMemory(64));
+}
+
+} // namespace infini
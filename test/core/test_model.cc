@@ -0,0 +1,254 @@
+#include "core/graph.h"
+#include "core/model.h"
+#include "core/runtime.h"
+#include "operators/concat.h"
+#include "operators/element_wise.h"
+#include "operators/matmul.h"
+#include "operators/transpose.h"
+#include "operators/unary.h"
+
+#include "test.h"
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace infini {
+
+// the header of a model file, as documented with `modelVersion`
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t metaOffset, metaSize;
+    uint64_t dataOffset, dataSize;
+    // since version 2
+    uint64_t planOffset, planSize;
+    uint64_t key;
+    uint32_t engine;
+    uint32_t reserved;
+};
+
+static string tempPath(const string &name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+static string readFile(const string &path) {
+    std::ifstream in(path, std::ios::binary);
+    return string((std::istreambuf_iterator<char>(in)),
+                  std::istreambuf_iterator<char>());
+}
+
+static void writeFile(const string &path, const string &bytes) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), bytes.size());
+}
+
+static vector<float> data(const Tensor &t) {
+    auto ptr = t->getRawDataPtr<float *>();
+    return vector<float>(ptr, ptr + t->size());
+}
+
+TEST(Model, SaveLoad) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph g = make_ref<GraphObj>(runtime);
+    auto x = g->addTensor({2, 3, 4}, DataType::Float32);
+    auto w = g->addTensor({1, 5, 4}, DataType::Float32);
+    auto b = g->addTensor({5}, DataType::Float32);
+    w->setTensorType(TensorType::Weight);
+    b->setTensorType(TensorType::Constant);
+    auto t = g->addOp<MatmulObj>(x, w, nullptr, false, true)->getOutput();
+    t = g->addOp<AddObj>(t, b, nullptr)->getOutput();
+    auto r = g->addOp<ReluObj>(t, nullptr)->getOutput();
+    auto c = g->addOp<ClipObj>(t, nullptr, 2.f, std::nullopt)->getOutput();
+    t = g->addOp<ConcatObj>(TensorVec{r, c}, nullptr, 1)->getOutput();
+    g->addOp<TransposeObj>(t, nullptr, Shape{0, 2, 1});
+    g->dataMalloc();
+    x->setData(IncrementalGenerator());
+    w->setData(IncrementalGenerator());
+    b->setData(OneGenerator());
+    runtime->run(g);
+    auto expected = data(g->getOutputs()[0]);
+
+    auto path = tempPath("test_model_save_load.itm");
+    saveModel(g, path);
+    Graph h = loadModel(path, runtime);
+    std::remove(path.c_str());
+    ASSERT_EQ(h->getTensors().size(), g->getTensors().size());
+    ASSERT_EQ(h->getOperators().size(), g->getOperators().size());
+    for (size_t i = 0; i < g->getOperators().size(); ++i)
+        EXPECT_EQ(h->getOperators()[i]->getOpType(),
+                  g->getOperators()[i]->getOpType());
+
+    // the weights point into the mapping, aligned and with their data
+    auto w2 = h->getTensors()[1], b2 = h->getTensors()[2];
+    EXPECT_EQ(w2->getTensorType(), TensorType::Weight);
+    EXPECT_EQ(b2->getTensorType(), TensorType::Constant);
+    for (auto &tensor : {w2, b2}) {
+        auto ptr = tensor->getRawDataPtr<void *>();
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % modelAlignment, 0u);
+    }
+    EXPECT_EQ(data(w2), data(w));
+    EXPECT_EQ(data(b2), data(b));
+
+    // only the activations are allocated
+    h->dataMalloc();
+    EXPECT_EQ(h->getWeightsSize(), 0u);
+    EXPECT_EQ(data(w2), data(w));
+    h->getInputs()[0]->setData(IncrementalGenerator());
+    runtime->run(h);
+    EXPECT_EQ(data(h->getOutputs()[0]), expected);
+}
+
+TEST(Model, Compiled) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph g = make_ref<GraphObj>(runtime);
+    auto x = g->addTensor({2, 3, 4}, DataType::Float32);
+    auto w = g->addTensor({1, 5, 4}, DataType::Float32);
+    w->setTensorType(TensorType::Weight);
+    // a transposed matmul needs a workspace
+    auto t = g->addOp<MatmulObj>(x, w, nullptr, false, true)->getOutput();
+    t = g->addOp<ReluObj>(t, nullptr)->getOutput();
+    g->addOp<TransposeObj>(t, nullptr, Shape{0, 2, 1});
+    g->dataMalloc();
+    w->setData(IncrementalGenerator());
+    auto key = hashGraph(g);
+    x->setData(IncrementalGenerator());
+    runtime->run(g);
+    auto expected = data(g->getOutputs()[0]);
+
+    auto path = tempPath("test_model_compiled.itm");
+    std::remove(path.c_str());
+    EXPECT_EQ(loadCompiled(path, runtime, key), nullptr);
+    saveCompiled(g, path, key);
+    EXPECT_EQ(loadCompiled(path, runtime, key + 1), nullptr);
+    // a compiled model is still a model
+    EXPECT_EQ(loadModel(path, runtime)->getOperators().size(), 3u);
+
+    // allocated with the saved layout, weights left in the file
+    Graph h = loadCompiled(path, runtime, key);
+    ASSERT_NE(h, nullptr);
+    EXPECT_EQ(h->getArenaSize(), g->getArenaSize());
+    EXPECT_EQ(h->getWeightsSize(), 0u);
+    auto before = g->getMemoryLayout(), after = h->getMemoryLayout();
+    for (size_t i = 0; i < g->getTensors().size(); ++i) {
+        auto t1 = g->getTensors()[i].get(), t2 = h->getTensors()[i].get();
+        EXPECT_EQ(before.offsets.count(t1), after.offsets.count(t2));
+        if (before.offsets.count(t1)) {
+            EXPECT_EQ(before.offsets.at(t1), after.offsets.at(t2));
+        }
+    }
+    EXPECT_EQ(after.workspaceBytes.size(), 1u);
+    EXPECT_EQ(h->getOperators()[0]->getWorkspaceSize(),
+              g->getOperators()[0]->getWorkspaceSize());
+    h->getInputs()[0]->setData(IncrementalGenerator());
+    runtime->run(h);
+    EXPECT_EQ(data(h->getOutputs()[0]), expected);
+    EXPECT_EQ(hashGraph(h), key);
+
+    // other weights, another key
+    w->setData(OneGenerator());
+    EXPECT_NE(hashGraph(g), key);
+
+    // compiled by another engine version
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    uint32_t engine = engineVersion + 1;
+    file.seekp(offsetof(Header, engine));
+    file.write(reinterpret_cast<const char *>(&engine), sizeof(engine));
+    file.close();
+    EXPECT_EQ(loadCompiled(path, runtime, key), nullptr);
+    std::remove(path.c_str());
+}
+
+TEST(Model, Version1) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph g = make_ref<GraphObj>(runtime);
+    auto x = g->addTensor({2, 3}, DataType::Float32);
+    auto b = g->addTensor({3}, DataType::Float32);
+    b->setTensorType(TensorType::Constant);
+    g->addOp<AddObj>(x, b, nullptr);
+    g->dataMalloc();
+    b->setData(IncrementalGenerator());
+    auto path = tempPath("test_model_version1.itm");
+    saveModel(g, path);
+
+    // the same metadata and data behind the shorter header of version 1
+    auto content = readFile(path);
+    Header header;
+    std::memcpy(&header, content.data(), sizeof(header));
+    auto meta = content.substr(header.metaOffset, header.metaSize);
+    auto blobs = content.substr(header.dataOffset, header.dataSize);
+    header.version = 1;
+    header.metaOffset = offsetof(Header, planOffset);
+    auto end = header.metaOffset + header.metaSize + modelAlignment - 1;
+    header.dataOffset = end / modelAlignment * modelAlignment;
+    string v1(reinterpret_cast<const char *>(&header), header.metaOffset);
+    v1 += meta;
+    v1.resize(header.dataOffset, '\0');
+    v1 += blobs;
+    writeFile(path, v1);
+
+    Graph h = loadModel(path, runtime);
+    std::remove(path.c_str());
+    ASSERT_EQ(h->getOperators().size(), 1u);
+    EXPECT_EQ(h->getOperators()[0]->getOpType(), OpType::Add);
+    auto b2 = h->getTensors()[1];
+    EXPECT_EQ(b2->getTensorType(), TensorType::Constant);
+    EXPECT_EQ(data(b2), data(b));
+}
+
+TEST(Model, BadFiles) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph g = make_ref<GraphObj>(runtime);
+    auto x = g->addTensor({32}, DataType::Float32);
+    auto w = g->addTensor({32}, DataType::Float32);
+    w->setTensorType(TensorType::Weight);
+    g->addOp<AddObj>(x, w, nullptr);
+    g->dataMalloc();
+    w->setData(OneGenerator());
+    auto path = tempPath("test_model_bad_files.itm");
+    saveModel(g, path);
+
+    auto content = readFile(path);
+    const auto write = [&](const string &bytes) { writeFile(path, bytes); };
+    auto loaded = loadModel(path, runtime);
+    EXPECT_EQ(loaded->getOperators().size(), 1u);
+    // not a model
+    write("not a model file, not a model file, not a model file");
+    EXPECT_ANY_THROW(loadModel(path, runtime));
+    // a newer version
+    auto newer = content;
+    newer[offsetof(Header, version)] = char(modelVersion + 1);
+    write(newer);
+    EXPECT_ANY_THROW(loadModel(path, runtime));
+    // truncated metadata
+    write(content.substr(0, content.size() - 8));
+    EXPECT_ANY_THROW(loadModel(path, runtime));
+    // a section wrapping around the end of the address space
+    Header header;
+    std::memcpy(&header, content.data(), sizeof(header));
+    auto wrapped = content;
+    const uint64_t metaOffset = UINT64_MAX - 7, metaSize = 16;
+    std::memcpy(&wrapped[offsetof(Header, metaOffset)], &metaOffset, 8);
+    std::memcpy(&wrapped[offsetof(Header, metaSize)], &metaSize, 8);
+    write(wrapped);
+    EXPECT_ANY_THROW(loadModel(path, runtime));
+    // a weight wrapping around: the tensors are (dtype, type, rank, dims,
+    // offset), w the second one, of rank 1
+    const size_t tensorBytes = 4 * sizeof(uint32_t) + sizeof(uint64_t);
+    auto at = header.metaOffset + sizeof(uint32_t) + 2 * tensorBytes -
+              sizeof(uint64_t);
+    uint64_t offset;
+    std::memcpy(&offset, &content[at], sizeof(offset));
+    ASSERT_EQ(offset, 0u);
+    wrapped = content;
+    offset = UINT64_MAX - modelAlignment + 1;
+    std::memcpy(&wrapped[at], &offset, sizeof(offset));
+    write(wrapped);
+    EXPECT_ANY_THROW(loadModel(path, runtime));
+    std::remove(path.c_str());
+    EXPECT_ANY_THROW(loadModel(path, runtime));
+}
+
+} // namespace infini
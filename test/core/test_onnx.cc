@@ -0,0 +1,269 @@
+#include "core/graph.h"
+#include "core/onnx.h"
+#include "core/runtime.h"
+
+#include "test.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+namespace infini {
+
+// A minimal protobuf encoder, enough to write ONNX models
+namespace proto {
+
+static string varint(uint64_t value) {
+    string ret;
+    do {
+        ret.push_back(char((value & 0x7f) | (value > 0x7f ? 0x80 : 0)));
+        value >>= 7;
+    } while (value);
+    return ret;
+}
+
+static string integer(uint32_t field, int64_t value) {
+    return varint(field << 3) + varint(value);
+}
+
+static string fixed32(uint32_t field, float value) {
+    string ret = varint(field << 3 | 5);
+    ret.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    return ret;
+}
+
+static string bytes(uint32_t field, const string &value) {
+    return varint(field << 3 | 2) + varint(value.size()) + value;
+}
+
+static string raw(const vector<float> &values) {
+    return string(reinterpret_cast<const char *>(values.data()),
+                  values.size() * sizeof(float));
+}
+
+} // namespace proto
+
+static string node(const string &type, const vector<string> &inputs,
+                   const string &output, const string &attributes = "") {
+    string ret;
+    for (const auto &input : inputs)
+        ret += proto::bytes(1, input);
+    ret += proto::bytes(2, output) + proto::bytes(4, type) + attributes;
+    return proto::bytes(1, ret);
+}
+
+static string intAttribute(const string &name, int64_t value) {
+    return proto::bytes(5, proto::bytes(1, name) + proto::integer(3, value));
+}
+
+// `dims` are values, or symbolic dimensions when negative; float by default
+static string valueInfo(uint32_t field, const string &name, const Shape &dims,
+                        int64_t elemType = 1) {
+    string shape;
+    for (auto d : dims)
+        shape += proto::bytes(
+            1, d >= 0 ? proto::integer(1, d) : proto::bytes(2, "N"));
+    auto tensorType = proto::integer(1, elemType) + proto::bytes(2, shape);
+    auto type = proto::bytes(1, tensorType);
+    return proto::bytes(field, proto::bytes(1, name) + proto::bytes(2, type));
+}
+
+static string initializer(const string &name, const Shape &dims,
+                          const string &data, int64_t dataType = 1) {
+    string ret;
+    for (auto d : dims)
+        ret += proto::integer(1, d);
+    return proto::bytes(5, ret + proto::integer(2, dataType) +
+                               proto::bytes(8, name) + data);
+}
+
+static string externalData(const string &location, const string &offset,
+                           const string &length = "") {
+    const auto entry = [](const string &key, const string &value) {
+        return proto::bytes(13, proto::bytes(1, key) + proto::bytes(2, value));
+    };
+    auto ret = entry("location", location) + entry("offset", offset);
+    if (!length.empty())
+        ret += entry("length", length);
+    return ret + proto::integer(14, 1);
+}
+
+static vector<float> data(const Tensor &t) {
+    auto ptr = t->getRawDataPtr<float *>();
+    return vector<float>(ptr, ptr + t->size());
+}
+
+TEST(Onnx, Load) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    auto directory = std::filesystem::temp_directory_path();
+    auto modelPath = (directory / "test_onnx_load.onnx").string();
+    auto weightsPath = (directory / "test_onnx_load.bin").string();
+
+    const int n = 2;
+    vector<float> w(4 * 3), b = {1, -20, 3}, v(3 * 2);
+    for (size_t i = 0; i < w.size(); ++i)
+        w[i] = float(i) - 5;
+    for (size_t i = 0; i < v.size(); ++i)
+        v[i] = float(i);
+    // the weights of the Gemm live in an external file, at an aligned offset
+    {
+        std::ofstream out(weightsPath, std::ios::binary | std::ios::trunc);
+        out << string(64, '\0') << proto::raw(w);
+    }
+
+    // x[N, 4] -> Gemm(w, b) -> Relu -> Clip(min = 2) -> y[N, 3]
+    // z[2, N, 3] -> MatMul(v[3, 2]) -> Transpose -> u[2, 2, N]
+    string packedV;
+    for (auto f : v)
+        packedV += proto::fixed32(0, f).substr(1);
+    string graph =
+        node("Gemm", {"x", "w", "b"}, "g", intAttribute("transB", 0)) +
+        node("Relu", {"g"}, "r") + node("Clip", {"r", "lo"}, "y") +
+        node("MatMul", {"z", "v"}, "m") +
+        node("Transpose", {"m"}, "u",
+             proto::bytes(5, proto::bytes(1, "perm") +
+                                 proto::bytes(8, proto::varint(0) +
+                                                     proto::varint(2) +
+                                                     proto::varint(1)))) +
+        initializer("w", {4, 3}, externalData("test_onnx_load.bin", "64")) +
+        initializer("b", {3}, proto::bytes(9, proto::raw(b))) +
+        initializer("lo", {}, proto::fixed32(4, 2)) +
+        initializer("v", {3, 2}, proto::bytes(4, packedV)) +
+        valueInfo(11, "x", {-1, 4}) + valueInfo(11, "z", {2, -1, 3}) +
+        valueInfo(12, "y", {-1, 3}) + valueInfo(12, "u", {2, 2, -1});
+    {
+        std::ofstream out(modelPath, std::ios::binary | std::ios::trunc);
+        out << proto::integer(1, 8) << proto::bytes(7, graph);
+    }
+
+    EXPECT_ANY_THROW(loadOnnx(modelPath, runtime));
+    auto model = loadOnnx(modelPath, runtime, {{"N", n}});
+    std::remove(modelPath.c_str());
+    std::remove(weightsPath.c_str());
+    auto g = model.graph;
+    ASSERT_EQ(model.inputs.size(), 2u);
+    ASSERT_EQ(model.outputs.size(), 2u);
+    EXPECT_EQ(model.inputs[0]->getDims(), (Shape{n, 4}));
+    EXPECT_EQ(model.outputs[0]->getDims(), (Shape{n, 3}));
+    EXPECT_EQ(model.outputs[1]->getDims(), (Shape{2, 2, n}));
+    // the scalar bound of the Clip is folded into the op
+    EXPECT_EQ(g->getOperators().size(), 6u);
+    EXPECT_FALSE(model.tensors.count("lo"));
+    EXPECT_TRUE(g->checkValid());
+
+    auto weight = model.tensors.at("w");
+    EXPECT_EQ(weight->getTensorType(), TensorType::Weight);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(weight->getRawDataPtr<void *>()) %
+                  RuntimeObj::alignment,
+              0u);
+    EXPECT_EQ(data(weight), w);
+    EXPECT_EQ(data(model.tensors.at("b")), b);
+
+    // the initializers are not copied into the weight arena
+    g->dataMalloc();
+    EXPECT_EQ(g->getWeightsSize(), 0u);
+    vector<float> x(n * 4), z(2 * n * 3);
+    for (size_t i = 0; i < x.size(); ++i)
+        x[i] = float(i % 5);
+    for (size_t i = 0; i < z.size(); ++i)
+        z[i] = float(i) / 2;
+    std::memcpy(model.inputs[0]->getRawDataPtr<void *>(), x.data(),
+                x.size() * sizeof(float));
+    std::memcpy(model.inputs[1]->getRawDataPtr<void *>(), z.data(),
+                z.size() * sizeof(float));
+    runtime->run(g);
+
+    vector<float> y(n * 3), u(2 * 2 * n);
+    for (int i = 0; i < n; ++i)
+        for (int j = 0; j < 3; ++j) {
+            float sum = b[j];
+            for (int k = 0; k < 4; ++k)
+                sum += x[i * 4 + k] * w[k * 3 + j];
+            y[i * 3 + j] = std::max(std::max(sum, 0.f), 2.f);
+        }
+    for (int s = 0; s < 2; ++s)
+        for (int i = 0; i < n; ++i)
+            for (int j = 0; j < 2; ++j) {
+                float sum = 0;
+                for (int k = 0; k < 3; ++k)
+                    sum += z[(s * n + i) * 3 + k] * v[k * 2 + j];
+                u[(s * 2 + j) * n + i] = sum;
+            }
+    EXPECT_EQ(data(model.outputs[0]), y);
+    EXPECT_EQ(data(model.outputs[1]), u);
+}
+
+TEST(Onnx, Unsupported) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    auto path =
+        (std::filesystem::temp_directory_path() / "test_onnx_bad.onnx")
+            .string();
+    const auto write = [&](const string &graph) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out << proto::bytes(7, graph);
+    };
+    write(node("Softmax", {"x"}, "y") + valueInfo(11, "x", {2, 3}) +
+          valueInfo(12, "y", {2, 3}));
+    EXPECT_ANY_THROW(loadOnnx(path, runtime));
+    // truncated
+    write(node("Relu", {"x"}, "y") + valueInfo(11, "x", {2, 3}));
+    std::ofstream(path, std::ios::binary | std::ios::app) << "\x3a\x7f";
+    EXPECT_ANY_THROW(loadOnnx(path, runtime));
+    // element types without kernels: missing, string, complex64, float8 and
+    // out of range
+    for (int64_t type : {0, 8, 14, 17, 1000}) {
+        write(node("Relu", {"x"}, "y") + valueInfo(11, "x", {2, 3}, type) +
+              valueInfo(12, "y", {2, 3}, type));
+        EXPECT_ANY_THROW(loadOnnx(path, runtime));
+        write(node("Add", {"x", "w"}, "y") +
+              initializer("w", {3}, proto::bytes(9, string(12, '\0')), type) +
+              valueInfo(11, "x", {3}) + valueInfo(12, "y", {3}));
+        EXPECT_ANY_THROW(loadOnnx(path, runtime));
+        write(node("Cast", {"x"}, "y", intAttribute("to", type)) +
+              valueInfo(11, "x", {3}) + valueInfo(12, "y", {3}));
+        EXPECT_ANY_THROW(loadOnnx(path, runtime));
+    }
+    // external data out of the file, even with wrapping offsets, or with
+    // malformed numbers
+    auto weightsPath =
+        (std::filesystem::temp_directory_path() / "test_onnx_bad.bin")
+            .string();
+    std::ofstream(weightsPath, std::ios::binary) << string(64, '\0');
+    const vector<std::pair<string, string>> bounds = {
+        {"32", "64"}, {"18446744073709551552", "128"}, {"-64", ""},
+        {"", ""},     {"1x", ""},                      {"0", " 12"}};
+    for (const auto &[offset, length] : bounds) {
+        write(node("Add", {"x", "w"}, "y") +
+              initializer("w", {3},
+                          externalData("test_onnx_bad.bin", offset, length)) +
+              valueInfo(11, "x", {3}) + valueInfo(12, "y", {3}));
+        EXPECT_ANY_THROW(loadOnnx(path, runtime));
+    }
+    std::remove(weightsPath.c_str());
+    std::remove(path.c_str());
+}
+
+TEST(Onnx, Outputs) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    auto path =
+        (std::filesystem::temp_directory_path() / "test_onnx_outputs.onnx")
+            .string();
+    // the output has a symbolic dimension the caller does not bind and an
+    // unknown one, as exporters write them
+    auto shape = proto::bytes(1, proto::bytes(2, "relu_dim_0")) +
+                 proto::bytes(1, "");
+    auto type =
+        proto::bytes(1, proto::integer(1, 1) + proto::bytes(2, shape));
+    auto output =
+        proto::bytes(12, proto::bytes(1, "y") + proto::bytes(2, type));
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out << proto::bytes(7, node("Relu", {"x"}, "y") +
+                                   valueInfo(11, "x", {-1, 3}) + output);
+    }
+    auto model = loadOnnx(path, runtime, {{"N", 2}});
+    std::remove(path.c_str());
+    ASSERT_EQ(model.outputs.size(), 1u);
+    EXPECT_EQ(model.outputs[0]->getDims(), (Shape{2, 3}));
+}
+
+} // namespace infini
@@ -0,0 +1,144 @@
+#include "core/context.h"
+#include "core/graph.h"
+#include "core/plan.h"
+#include "core/runtime.h"
+#include "operators/concat.h"
+#include "operators/element_wise.h"
+#include "operators/matmul.h"
+#include "operators/transpose.h"
+#include "operators/unary.h"
+
+#include "test.h"
+
+namespace infini {
+
+TEST(Plan, MatchesGraphRun) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph g = make_ref<GraphObj>(runtime);
+    auto i0 = g->addTensor({2, 3, 4}, DataType::Float32);
+    auto i1 = g->addTensor({3, 1}, DataType::Float32);
+    auto t0 = g->addOp<TransposeObj>(i0, nullptr, Shape{0, 2, 1})->getOutput();
+    auto t1 = g->addOp<SubObj>(t0, i1, nullptr)->getOutput();
+    auto t2 = g->addOp<ReluObj>(t1, nullptr)->getOutput();
+    auto t3 = g->addOp<ClipObj>(t0, nullptr, 2.f, 9.f)->getOutput();
+    auto o = g->addOp<ConcatObj>(TensorVec{t2, t3}, nullptr, 1)->getOutput();
+    g->dataMalloc();
+    i0->setData(IncrementalGenerator());
+    i1->setData(IncrementalGenerator());
+
+    runtime->run(g);
+    vector<float> expected(o->getRawDataPtr<float *>(),
+                           o->getRawDataPtr<float *>() + o->size());
+    o->setData(ZeroGenerator());
+
+    auto plan = runtime->compile(g);
+    EXPECT_EQ(plan->getSteps().size(), 5u);
+    runtime->run(plan);
+    EXPECT_TRUE(o->equalData(expected));
+
+    // the plan reads the current content of the bound tensors
+    i0->setData(OneGenerator());
+    runtime->run(plan);
+    EXPECT_FALSE(o->equalData(expected));
+    runtime->run(g);
+    vector<float> ones(o->getRawDataPtr<float *>(),
+                       o->getRawDataPtr<float *>() + o->size());
+    runtime->run(plan);
+    EXPECT_TRUE(o->equalData(ones));
+}
+
+TEST(Plan, Workspaces) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph g = make_ref<GraphObj>(runtime);
+    auto x = g->addTensor({4, 8}, DataType::Float32);
+    auto w0 = g->addTensor({16, 8}, DataType::Float32);
+    auto w1 = g->addTensor({8, 16}, DataType::Float32);
+    w0->setWeight();
+    w1->setWeight();
+    // transposed weights are packed into the workspaces of the matmuls
+    auto m0 = g->addOp<MatmulObj>(x, w0, nullptr, false, true);
+    auto m1 = g->addOp<MatmulObj>(m0->getOutput(), w1, nullptr, false, true);
+    auto o = g->addOp<ReluObj>(m1->getOutput(), nullptr)->getOutput();
+    g->dataMalloc();
+    x->setData(IncrementalGenerator());
+    w0->setData(OneGenerator());
+    w1->setData(IncrementalGenerator());
+
+    size_t total = 0;
+    for (auto &t : g->getTensors())
+        total += t->isWeight() ? 0 : t->getBytes();
+    auto arena = reinterpret_cast<char *>(g->getArena());
+    for (auto &op : {m0, m1}) {
+        EXPECT_EQ(op->getWorkspaceSize(), op->getInputs(1)->getBytes());
+        auto ws = reinterpret_cast<char *>(op->getWorkspace());
+        EXPECT_TRUE(ws >= arena &&
+                    ws + op->getWorkspaceSize() <= arena + g->getArenaSize());
+        total += op->getWorkspaceSize();
+    }
+    // workspaces only live during their op, so memory is reused
+    EXPECT_LT(g->getArenaSize(), total);
+
+    runtime->run(g);
+    vector<float> expected(o->getRawDataPtr<float *>(),
+                           o->getRawDataPtr<float *>() + o->size());
+    o->setData(ZeroGenerator());
+    auto plan = runtime->compile(g);
+    runtime->run(plan);
+    EXPECT_TRUE(o->equalData(expected));
+
+    // contexts have their own copy of the workspaces
+    auto context = make_ref<ContextObj>(plan);
+    context->setData(x, IncrementalGenerator());
+    runtime->run(context);
+    auto ptr = context->getRawDataPtr<float *>(o);
+    EXPECT_EQ(vector<float>(ptr, ptr + o->size()), expected);
+}
+
+TEST(Plan, DynamicShapes) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    auto build = [&](int len) {
+        Graph g = make_ref<GraphObj>(runtime);
+        auto x = g->addTensor({2, len, 4}, DataType::Float32);
+        auto w = g->addTensor({4}, DataType::Float32);
+        auto t = g->addOp<SubObj>(x, w, nullptr)->getOutput();
+        auto r = g->addOp<ReluObj>(t, nullptr)->getOutput();
+        g->addOp<TransposeObj>(r, nullptr, Shape{1, 0, 2});
+        return std::make_tuple(g, x, w);
+    };
+
+    auto [g, x, w] = build(4);
+    g->setShapeBucket(x, 1, 8);
+    g->dataMalloc();
+    w->setData(IncrementalGenerator());
+    PlanCache cache(g, runtime.get());
+
+    void *arena = nullptr;
+    bool grown = false;
+    for (int len : {3, 5, 8, 3, 11, 16, 5}) {
+        auto plan = cache.get({{x, {2, len, 4}}});
+        EXPECT_EQ(g->getOutputs()[0]->getDims(), (Shape{len, 2, 4}));
+        // shapes of one bucket share the layout, so the arena only moves
+        // when a larger bucket is first seen
+        grown = grown || len > 8;
+        if (!grown) {
+            if (arena) {
+                EXPECT_EQ(g->getArena(), arena);
+            }
+            arena = g->getArena();
+        }
+        // the weight keeps its data across layouts
+        EXPECT_TRUE(w->equalData(vector<float>{0, 1, 2, 3}));
+        x->setData(IncrementalGenerator());
+        runtime->run(plan);
+
+        auto [ref, refX, refW] = build(len);
+        ref->dataMalloc();
+        refX->setData(IncrementalGenerator());
+        refW->setData(IncrementalGenerator());
+        runtime->run(ref);
+        EXPECT_TRUE(g->getOutputs()[0]->equalData(ref->getOutputs()[0]));
+    }
+    EXPECT_EQ(cache.size(), 5u);
+}
+
+} // namespace infini
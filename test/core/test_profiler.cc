@@ -0,0 +1,71 @@
+#include "core/graph.h"
+#include "core/plan.h"
+#include "core/profiler.h"
+#include "core/runtime.h"
+#include "operators/element_wise.h"
+#include "operators/matmul.h"
+#include "operators/transpose.h"
+#include "operators/unary.h"
+
+#include "test.h"
+
+namespace infini {
+
+TEST(Profiler, RecordsOps) {
+    auto runtime = make_ref<NativeCpuRuntimeObj>();
+    Graph g = make_ref<GraphObj>(runtime);
+    auto i0 = g->addTensor({2, 3, 4}, DataType::Float32);
+    auto i1 = g->addTensor({2, 4, 3}, DataType::Float32);
+    auto t0 = g->addOp<TransposeObj>(i1, nullptr, Shape{0, 2, 1})->getOutput();
+    auto t1 = g->addOp<AddObj>(i0, t0, nullptr)->getOutput();
+    auto t2 = g->addOp<ReluObj>(i0, nullptr)->getOutput();
+    g->addOp<MulObj>(t1, t2, nullptr);
+    g->dataMalloc();
+    i0->setData(IncrementalGenerator());
+    i1->setData(IncrementalGenerator());
+
+    Graph mg = make_ref<GraphObj>(runtime);
+    auto m = mg->addOp<MatmulObj>(mg->addTensor({2, 3, 4}),
+                                  mg->addTensor({2, 4, 5}), nullptr);
+    EXPECT_EQ(Profiler::estimateFlops(m), 2u * 2 * 3 * 5 * 4);
+    EXPECT_EQ(Profiler::estimateBytes(g->getOperators()[0]),
+              2 * i1->getBytes());
+
+    // profiling is off by default
+    runtime->run(g);
+    auto profiler = make_ref<Profiler>();
+    runtime->setProfiler(profiler);
+    runtime->run(g);
+    EXPECT_EQ(profiler->getRecords().size(), 4u);
+    auto plan = runtime->compile(g);
+    runtime->run(plan);
+    runtime->setParallelConfig({2, 1});
+    runtime->run(plan);
+    runtime->setProfiler(nullptr);
+    runtime->run(plan);
+
+    auto records = profiler->getRecords();
+    ASSERT_EQ(records.size(), 12u);
+    for (const auto &r : records) {
+        EXPECT_GE(r.duration, 0);
+        EXPECT_GE(r.start, 0);
+        if (r.type == OpType::Add) {
+            EXPECT_EQ(r.inputs, "[[2,3,4],[2,3,4]]");
+            EXPECT_EQ(r.outputs, "[[2,3,4]]");
+            EXPECT_EQ(r.bytes, 3 * i0->getBytes());
+            EXPECT_EQ(r.flops, i0->size());
+        }
+    }
+
+    auto summary = profiler->summary();
+    for (auto name : {"Transpose", "Add", "Relu", "Mul", "Total"})
+        EXPECT_NE(summary.find(name), string::npos) << summary;
+    auto trace = profiler->toChromeTrace();
+    EXPECT_EQ(trace.rfind("{\"traceEvents\":[", 0), 0u);
+    EXPECT_EQ(std::count(trace.begin(), trace.end(), '\n'), 14);
+
+    profiler->clear();
+    EXPECT_TRUE(profiler->getRecords().empty());
+}
+
+} // namespace infini
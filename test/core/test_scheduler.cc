@@ -0,0 +1,71 @@
+#include "core/graph.h"
+#include "core/plan.h"
+#include "core/runtime.h"
+#include "operators/concat.h"
+#include "operators/element_wise.h"
+#include "operators/unary.h"
+
+#include "test.h"
+
+namespace infini {
+
+// `width` independent branches of `depth` ops, concatenated at the end
+static Graph buildBranches(Runtime runtime, int width, int depth) {
+    Graph g = make_ref<GraphObj>(runtime);
+    auto input = g->addTensor({4, 8}, DataType::Float32);
+    TensorVec outs;
+    for (int b = 0; b < width; ++b) {
+        auto bias = g->addTensor({8}, DataType::Float32);
+        auto t = g->addOp<AddObj>(input, bias, nullptr)->getOutput();
+        for (int d = 0; d < depth; ++d) {
+            t = g->addOp<MulObj>(t, bias, nullptr)->getOutput();
+            t = g->addOp<ReluObj>(t, nullptr)->getOutput();
+        }
+        outs.emplace_back(t);
+    }
+    g->addOp<ConcatObj>(outs, nullptr, 0);
+    g->dataMalloc();
+    for (auto &t : g->getInputs())
+        t->setData(IncrementalGenerator());
+    return g;
+}
+
+TEST(Scheduler, Split) {
+    auto config = ParallelConfig::split(8, 2);
+    EXPECT_EQ(config.interOp, 2);
+    EXPECT_EQ(config.intraOp, 4);
+    config = ParallelConfig::split(4, 16);
+    EXPECT_EQ(config.interOp, 4);
+    EXPECT_EQ(config.intraOp, 1);
+}
+
+TEST(Scheduler, MatchesSequentialRun) {
+    auto runtime = make_ref<NativeCpuRuntimeObj>();
+    Graph g = buildBranches(runtime, 6, 5);
+    auto output = g->getOutputs()[0];
+    auto plan = runtime->compile(g);
+    EXPECT_EQ(plan->getWidth(), 6u);
+
+    runtime->run(plan);
+    vector<float> expected(output->getRawDataPtr<float *>(),
+                           output->getRawDataPtr<float *>() + output->size());
+
+    runtime->setParallelConfig({4, 1});
+    for (int i = 0; i < 20; ++i) {
+        output->setData(ZeroGenerator());
+        runtime->run(plan);
+        EXPECT_TRUE(output->equalData(expected));
+    }
+}
+
+TEST(Scheduler, ReusedBuffersAreOrdered) {
+    // in a chain every buffer is reused, so the steps must stay ordered
+    auto runtime = make_ref<NativeCpuRuntimeObj>();
+    Graph g = buildBranches(runtime, 1, 10);
+    auto plan = runtime->compile(g);
+    EXPECT_EQ(plan->getWidth(), 1u);
+    for (size_t i = 0; i + 1 < plan->getSteps().size(); ++i)
+        EXPECT_GE(plan->getDependencies(i + 1), 1u);
+}
+
+} // namespace infini
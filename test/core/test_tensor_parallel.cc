@@ -0,0 +1,133 @@
+#include "core/communicator.h"
+#include "core/graph.h"
+#include "core/runtime.h"
+#include "core/tensor_parallel.h"
+#include "operators/element_wise.h"
+#include "operators/matmul.h"
+#include "operators/transpose.h"
+#include "operators/unary.h"
+
+#include "test.h"
+
+namespace infini {
+
+static void fill(const Tensor &t, float scale) {
+    auto ptr = t->getRawDataPtr<float *>();
+    for (size_t i = 0; i < t->size(); ++i)
+        ptr[i] = float(int(i * 7 % 13) - 6) * scale;
+}
+
+// x[4, 8] -> MatMul(w1[8, 16]) -> Add(b1[16]) -> Relu -> MatMul(w2^T[8, 16])
+// -> Add(b2[8]) -> y[4, 8]
+static Graph build(Runtime runtime) {
+    Graph g = make_ref<GraphObj>(runtime);
+    auto x = g->addTensor({4, 8});
+    auto w1 = g->addTensor({8, 16}), b1 = g->addTensor(Shape{16});
+    auto w2 = g->addTensor({8, 16}), b2 = g->addTensor(Shape{8});
+    for (auto &w : {w1, b1, w2, b2})
+        w->setWeight();
+    auto h = g->addOp<MatmulObj>(x, w1, nullptr)->getOutput();
+    h = g->addOp<AddObj>(h, b1, nullptr)->getOutput();
+    h = g->addOp<ReluObj>(h, nullptr)->getOutput();
+    h = g->addOp<MatmulObj>(h, w2, nullptr, false, true)->getOutput();
+    g->addOp<AddObj>(h, b2, nullptr);
+    g->dataMalloc();
+    fill(w1, 0.25f);
+    fill(b1, 0.5f);
+    fill(w2, 0.125f);
+    fill(b2, 1.f);
+    return g;
+}
+
+// x[4, 8] -> MatMul(w[8, 16]) -> Add(b[16]) -> h -> Relu -> r[4, 16]
+//                                           h -> Transpose -> t[16, 4]
+// r is an output sharded along its last axis, and the Transpose cannot read
+// a shard, so both are gathered across rows
+static Graph buildGathered(Runtime runtime) {
+    Graph g = make_ref<GraphObj>(runtime);
+    auto x = g->addTensor({4, 8});
+    auto w = g->addTensor({8, 16}), b = g->addTensor(Shape{16});
+    w->setWeight();
+    b->setWeight();
+    auto h = g->addOp<MatmulObj>(x, w, nullptr)->getOutput();
+    h = g->addOp<AddObj>(h, b, nullptr)->getOutput();
+    g->addOp<ReluObj>(h, nullptr);
+    g->addOp<TransposeObj>(h, nullptr, Shape{1, 0});
+    g->dataMalloc();
+    fill(w, 0.25f);
+    fill(b, 0.5f);
+    return g;
+}
+
+// run by the processes `TensorParallel.Run` starts
+TEST(TensorParallel, Worker) {
+    auto comm = CommunicatorObj::fromEnvironment();
+    if (!comm)
+        GTEST_SKIP() << "Not started by launchWorkers";
+    const int rank = comm->getRank(), ranks = comm->getWorldSize();
+
+    // more than the capacity of a slot, so that both run in chunks
+    vector<float> data(200);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = float(rank * 1000 + i);
+    vector<float> gathered(data.size() * ranks);
+    comm->allGather(data.data(), gathered.data(), data.size() * 4);
+    comm->allReduceSum(data.data(), data.size(), DataType::Float32);
+    for (size_t i = 0; i < data.size(); ++i) {
+        EXPECT_EQ(data[i], float(ranks * (ranks - 1) / 2 * 1000 + ranks * i));
+        for (int r = 0; r < ranks; ++r)
+            EXPECT_EQ(gathered[r * data.size() + i], float(r * 1000 + i));
+    }
+
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    auto g = build(runtime);
+    auto x = g->getInputs()[0];
+    fill(x, 1.f);
+    runtime->run(g);
+
+    auto sharded = shardGraph(g, comm);
+    ASSERT_EQ(sharded.inputs.size(), 1u);
+    ASSERT_EQ(sharded.outputs.size(), 1u);
+    int reduces = 0, gathers = 0;
+    for (const auto &op : sharded.graph->getOperators()) {
+        reduces += op->getOpType() == OpType::AllReduceSum;
+        gathers += op->getOpType() == OpType::AllGather;
+    }
+    EXPECT_EQ(reduces, 1);
+    EXPECT_EQ(gathers, 0);
+    sharded.graph->dataMalloc();
+    fill(sharded.inputs[0], 1.f);
+    runtime->run(sharded.graph);
+    EXPECT_TRUE(sharded.outputs[0]->equalData(g->getOutputs()[0], 1e-5));
+
+    g = buildGathered(runtime);
+    fill(g->getInputs()[0], 1.f);
+    runtime->run(g);
+    sharded = shardGraph(g, comm);
+    ASSERT_EQ(sharded.outputs.size(), 2u);
+    sharded.graph->dataMalloc();
+    gathers = 0;
+    for (const auto &op : sharded.graph->getOperators()) {
+        if (op->getOpType() != OpType::AllGather)
+            continue;
+        ++gathers;
+        // interleaved through a workspace, the gathered rows being split
+        EXPECT_EQ(op->getWorkspaceSize(), op->getOutput()->getBytes());
+    }
+    EXPECT_EQ(gathers, 2);
+    fill(sharded.inputs[0], 1.f);
+    runtime->run(sharded.graph);
+    for (size_t i = 0; i < 2; ++i)
+        EXPECT_TRUE(
+            sharded.outputs[i]->equalData(g->getOutputs()[i], 1e-5));
+}
+
+TEST(TensorParallel, Run) {
+    const vector<string> argv = {"/proc/self/exe",
+                                 "--gtest_filter=TensorParallel.Worker"};
+    EXPECT_TRUE(launchWorkers(2, argv, true, 256));
+    EXPECT_TRUE(launchWorkers(4, argv, false, 256));
+    EXPECT_FALSE(launchWorkers(2, {"/bin/false"}));
+}
+
+} // namespace infini
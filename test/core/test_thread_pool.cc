@@ -0,0 +1,104 @@
+#include "core/graph.h"
+#include "core/runtime.h"
+#include "core/thread_pool.h"
+
+#include "test.h"
+#include <cstdlib>
+#include <new>
+
+// counts the allocations of the test binary
+static std::atomic<size_t> allocations{0};
+
+void *operator new(size_t size) {
+    allocations++;
+    if (auto ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+// gcc cannot tell that the replaced operator new allocates with malloc
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+#pragma GCC diagnostic pop
+
+namespace infini {
+
+TEST(ThreadPool, CoversRange) {
+    ThreadPool pool(ThreadPoolConfig{4, {}, 100, 16});
+    EXPECT_EQ(pool.getThreads(), 4);
+    for (size_t n : {0, 1, 15, 16, 17, 100, 1000}) {
+        vector<int> hits(n, 0);
+        std::atomic<int> calls{0};
+        pool.parallelFor(0, n, 0, [&](size_t begin, size_t end) {
+            calls++;
+            for (auto i = begin; i < end; ++i)
+                hits[i]++;
+        });
+        EXPECT_EQ(std::count(hits.begin(), hits.end(), 1), (long)n);
+        // at most one chunk per thread and per grain
+        EXPECT_LE(calls, std::min<int>(4, (n + 15) / 16) + (n == 0 ? 0 : 1));
+    }
+}
+
+TEST(ThreadPool, SmallRangesRunInline) {
+    ThreadPool pool(ThreadPoolConfig{4, {}, 0, 1024});
+    auto caller = std::this_thread::get_id();
+    pool.parallelFor(0, 1000, 0, [&](size_t begin, size_t end) {
+        EXPECT_EQ(begin, 0u);
+        EXPECT_EQ(end, 1000u);
+        EXPECT_EQ(std::this_thread::get_id(), caller);
+    });
+}
+
+TEST(ThreadPool, NestedAndErrors) {
+    ThreadPool pool(ThreadPoolConfig{3, {0}, 0, 1});
+    std::atomic<int> sum{0};
+    pool.parallelFor(0, 6, 1, [&](size_t begin, size_t end) {
+        pool.parallelFor(begin * 10, end * 10, 1, [&](size_t b, size_t e) {
+            sum += e - b;
+        });
+    });
+    EXPECT_EQ(sum, 60);
+    EXPECT_THROW(pool.parallelFor(0, 6, 1,
+                                  [&](size_t begin, size_t end) {
+                                      if (begin == 0)
+                                          IT_TODO_HALT();
+                                  }),
+                 Exception);
+    // the pool is still usable after a failure
+    sum = 0;
+    pool.parallelFor(0, 6, 1, [&](size_t b, size_t e) { sum += e - b; });
+    EXPECT_EQ(sum, 6);
+}
+
+TEST(ThreadPool, NoAllocation) {
+    ThreadPool pool(ThreadPoolConfig{4, {}, 0, 1});
+    vector<float> a(64, 1.f), b(64, 2.f), c(64);
+    float scale = 3.f;
+    // captures more than fits the small buffer of std::function
+    const auto run = [&] {
+        pool.parallelFor(0, c.size(), 16, [&](size_t begin, size_t end) {
+            for (auto i = begin; i < end; ++i)
+                c[i] = a[i] * b[i] * scale;
+        });
+    };
+    run();
+    auto before = allocations.load();
+    for (int i = 0; i < 100; ++i)
+        run();
+    EXPECT_EQ(allocations - before, 0u);
+    EXPECT_EQ(c, vector<float>(64, 6.f));
+}
+
+TEST(ThreadPool, Runtime) {
+    auto runtime = make_ref<NativeCpuRuntimeObj>();
+    runtime->setParallelConfig({1, 2});
+    EXPECT_EQ(runtime->getThreadPool().getThreads(), 2);
+    std::atomic<size_t> sum{0};
+    runtime->parallelFor(0, 1 << 16, 0,
+                         [&](size_t b, size_t e) { sum += e - b; });
+    EXPECT_EQ(sum, 1u << 16);
+}
+
+} // namespace infini
@@ -0,0 +1,40 @@
+#include "core/graph.h"
+#include "core/kernel.h"
+#include "core/runtime.h"
+#include "operators/matmul.h"
+
+#include "test.h"
+
+namespace infini {
+
+TEST(Matmul, NativeCpu) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    {
+        // B is broadcast over the batch
+        Graph g = make_ref<GraphObj>(runtime);
+        auto a = g->addTensor({2, 2, 3}, DataType::Float32);
+        auto b = g->addTensor({1, 3, 2}, DataType::Float32);
+        auto op = g->addOp<MatmulObj>(a, b, nullptr);
+        g->dataMalloc();
+        a->setData(IncrementalGenerator());
+        b->setData(IncrementalGenerator());
+        runtime->run(g);
+        EXPECT_TRUE(op->getOutput()->equalData(
+            vector<float>{10, 13, 28, 40, 46, 67, 64, 94}));
+    }
+    {
+        // the same product with both operands stored transposed
+        Graph g = make_ref<GraphObj>(runtime);
+        auto a = g->addTensor({2, 3, 2}, DataType::UInt32);
+        auto b = g->addTensor({1, 2, 3}, DataType::UInt32);
+        auto op = g->addOp<MatmulObj>(a, b, nullptr, true, true);
+        g->dataMalloc();
+        a->setData(IncrementalGenerator());
+        b->setData(IncrementalGenerator());
+        runtime->run(g);
+        EXPECT_TRUE(op->getOutput()->equalData(
+            vector<uint32_t>{10, 28, 13, 40, 28, 100, 31, 112}));
+    }
+}
+
+} // namespace infini
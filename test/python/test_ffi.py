@@ -0,0 +1,105 @@
+import array
+import threading
+import time
+import unittest
+
+import pyinfinitensor as it
+
+
+def build():
+    g = it.Graph()
+    x = g.tensor([2, 3])
+    w = g.tensor([3, 4], weight=True)
+    y = g.relu(g.matmul(x, w))
+    g.data_malloc()
+    return g, x, w, y
+
+
+class TestFfi(unittest.TestCase):
+    def test_buffers(self):
+        g, x, w, y = build()
+        self.assertEqual(x.shape, (2, 3))
+        self.assertEqual(y.dtype, "float32")
+        self.assertEqual(len(g.inputs), 2)
+        self.assertEqual(len(g.outputs), 1)
+        # views write and read the arena in place
+        mx, mw = memoryview(x), memoryview(w)
+        self.assertEqual((mx.format, mx.shape), ("f", (2, 3)))
+        mx.cast("B").cast("f")[:] = array.array("f", range(6))
+        mw.cast("B").cast("f")[:] = array.array("f", [1, -1, 0, 2] * 3)
+        g.run()
+        out = memoryview(y).tolist()
+        self.assertEqual(out, [[3, 0, 0, 6], [12, 0, 0, 24]])
+        # the arena cannot move while viewed
+        with self.assertRaises(BufferError):
+            g.data_malloc()
+        mx.release(), mw.release()
+        g.data_malloc()
+
+    def test_bind(self):
+        g, x, w, y = build()
+        memoryview(w).cast("B").cast("f")[:] = array.array("f", [1] * 12)
+        data = array.array("f", [1, 2, 3, 4, 5, 6])
+        out = array.array("f", [0] * 8)
+        x.bind(memoryview(data).cast("B").cast("f", [2, 3]))
+        y.bind(memoryview(out).cast("B").cast("f", [2, 4]))
+        g.run()
+        self.assertEqual(out.tolist(), [6] * 4 + [15] * 4)
+        # the input is read in place, not copied
+        data[0] = 4
+        g.run()
+        self.assertEqual(out.tolist(), [9] * 4 + [15] * 4)
+
+        with self.assertRaises(ValueError):
+            x.bind(array.array("f", [0] * 6))
+        with self.assertRaises(ValueError):
+            x.bind(memoryview(array.array("i", [0] * 6)).cast("B").cast("i", [2, 3]))
+        # outputs need a writable buffer
+        with self.assertRaises(BufferError):
+            y.bind(memoryview(bytes(32)).cast("f", [2, 4]))
+
+    def test_run_releases_gil(self):
+        g = it.Graph()
+        g.matmul(g.tensor([256, 256]), g.tensor([256, 256]))
+        g.data_malloc()
+        stop = threading.Event()
+
+        def loop():
+            while not stop.is_set():
+                g.run()
+
+        runner = threading.Thread(target=loop)
+        runner.start()
+        try:
+            # this thread only sees the graph running if it gets the GIL
+            # while another thread is inside run, which refuses to share
+            # the arena
+            deadline = time.monotonic() + 30
+            while True:
+                try:
+                    g.data_malloc()
+                except RuntimeError:
+                    break
+                self.assertLess(time.monotonic(), deadline)
+        finally:
+            stop.set()
+            runner.join()
+        g.data_malloc()
+
+    def test_errors(self):
+        g = it.Graph()
+        a = g.tensor([2, 3])
+        g.relu(a)
+        # not allocated
+        with self.assertRaises(RuntimeError):
+            g.run()
+        with self.assertRaises(RuntimeError):
+            g.tensor([2], dtype="string")
+        with self.assertRaises(RuntimeError):
+            it.Graph().relu(a)
+        with self.assertRaises(BufferError):
+            memoryview(a)
+
+
+if __name__ == "__main__":
+    unittest.main()